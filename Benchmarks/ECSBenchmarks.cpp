@@ -0,0 +1,521 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+// Headless microbenchmarks of the ECS and the collision broadphases. Only the ECS, the game
+// component headers and the broadphases are used, so the benchmarks build and run without SDL or
+// OpenGL.
+//
+// Every benchmark is run at 1k, 10k, 100k and 1M entities, and the results are written as CSV or
+// JSON so that they can be compared between builds. Every broadphase is run on the same scene, so
+// that they can be compared with each other.
+//
+// Usage: ECSBenchmarks [--format csv|json] [--output <path>] [--max-entities <count>]
+
+#include "ECS/ECS.h"
+#include "ECS/ECSTypedSystem.h"
+#include "GameComponentSystem/TransformComponent.h"
+#include "GameComponentSystem/MotionComponentSystem.h"
+#include "Physics/Broadphase/DynamicAABBTreeBroadphase.h"
+#include "Physics/Broadphase/OctreeBroadphase.h"
+#include "Physics/Broadphase/SpatialHashGridBroadphase.h"
+#include "Physics/Broadphase/SweepAndPruneBroadphase.h"
+
+#include <algorithm> // std::sort, std::shuffle, std::min, std::max
+#include <chrono>
+#include <cmath> // std::cbrt
+#include <cstdlib> // std::strtoull
+#include <cstring> // std::strcmp
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// The entity counts every benchmark is run at
+static const size_t ENTITY_COUNTS[] = { 1000, 10000, 100000, 1000000 };
+
+// The number of listeners notified of every entity in the listener dispatch benchmark
+static const unsigned int NUM_LISTENERS = 8;
+
+// The number of entities per unit of volume in the broadphase benchmarks; with entities of size 1,
+// every entity intersects a few others on average, regardless of the entity count
+static const float BROADPHASE_DENSITY = 0.1f;
+
+// Written to by benchmarks which would otherwise have no observable effect, so that the compiler
+// cannot remove the work being measured
+static volatile float sink = 0.0f;
+
+/** @brief The timings of a single benchmark at a single entity count. */
+struct BenchmarkResult
+{
+	std::string name;
+	size_t numEntities;
+
+	// Duration of every repetition, in seconds
+	std::vector<double> times;
+};
+
+/** @brief System which only works with a single component type. */
+class TranslateSystem : public TypedSystem<TranslateSystem, Write<TransformComponent>>
+{
+public:
+	void Update(float deltaTime, TransformComponent& transform)
+	{
+		transform.transform.GetPosition() += glm::vec3(0.0f, deltaTime, 0.0f);
+	}
+};
+
+/** @brief Listener which counts the entities it is notified of. */
+class CountingListener : public ECSListener
+{
+public:
+	CountingListener()
+	{
+		AddComponentID(TransformComponent::ID);
+	}
+
+	virtual void OnMakeEntity(EntityHandle handle)
+	{
+		numMade++;
+	}
+
+	virtual void OnRemoveEntity(EntityHandle handle)
+	{
+		numRemoved++;
+	}
+
+	size_t numMade = 0;
+	size_t numRemoved = 0;
+};
+
+/** @brief Entities moving around a cube, for the broadphase benchmarks. */
+struct BroadphaseScene
+{
+	std::vector<EntityHandle> handles;
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> velocities;
+
+	/** @brief Gets the bounding box of an entity, a cube of size 1 around it's position. */
+	AABB GetAABB(size_t i) const
+	{
+		return AABB(positions[i] - glm::vec3(0.5f), positions[i] + glm::vec3(0.5f));
+	}
+};
+
+/** @brief Gets the current time in seconds, for measuring durations. */
+static double GetTime()
+{
+	return std::chrono::duration<double>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Gets the number of times to repeat a benchmark, so that small entity counts are repeated often
+ * enough to give a stable minimum without large entity counts taking too long.
+ */
+static unsigned int GetNumRepetitions(size_t numEntities)
+{
+	return (unsigned int)std::max<size_t>(3, std::min<size_t>(100, 10000000 / numEntities));
+}
+
+/** @brief Makes entities with a transform and motion component, for benchmarks which need some. */
+static std::vector<EntityHandle> MakeMovingEntities(ECS& ecs, size_t numEntities)
+{
+	TransformComponent transformComponent;
+	MotionComponent motionComponent;
+	motionComponent.velocity = glm::vec3(1.0f, 0.0f, 0.0f);
+
+	return ecs.MakeEntities(numEntities, transformComponent, motionComponent);
+}
+
+/**
+ * Makes a scene of entities spread randomly around a cube, each moving in a random direction. The
+ * scene is always the same for the same entity count, so that every broadphase is given the same
+ * work.
+ */
+static BroadphaseScene MakeBroadphaseScene(size_t numEntities)
+{
+	const float size = std::cbrt(numEntities / BROADPHASE_DENSITY);
+
+	std::mt19937 random(54321);
+	std::uniform_real_distribution<float> position(0.0f, size);
+	std::uniform_real_distribution<float> velocity(-1.0f, 1.0f);
+
+	BroadphaseScene scene;
+	scene.handles.reserve(numEntities);
+	scene.positions.reserve(numEntities);
+	scene.velocities.reserve(numEntities);
+
+	for (size_t i = 0; i < numEntities; i++)
+	{
+		// The handles are never given to an ECS, so they only need to be unique
+		scene.handles.emplace_back((uint32_t)i, 1);
+		scene.positions.emplace_back(position(random), position(random), position(random));
+		scene.velocities.emplace_back(velocity(random), velocity(random), velocity(random));
+	}
+
+	return scene;
+}
+
+/** @brief Makes entities one at a time. */
+static double BenchmarkMakeEntity(size_t numEntities)
+{
+	ECS* ecs = new ECS();
+	TransformComponent transformComponent;
+	MotionComponent motionComponent;
+
+	double start = GetTime();
+	for (size_t i = 0; i < numEntities; i++)
+	{
+		ecs->MakeEntity(transformComponent, motionComponent);
+	}
+	double time = GetTime() - start;
+
+	delete ecs;
+	return time;
+}
+
+/** @brief Makes every entity with a single call. */
+static double BenchmarkMakeEntities(size_t numEntities)
+{
+	ECS* ecs = new ECS();
+
+	double start = GetTime();
+	MakeMovingEntities(*ecs, numEntities);
+	double time = GetTime() - start;
+
+	delete ecs;
+	return time;
+}
+
+/** @brief Removes entities one at a time, in the order they were made. */
+static double BenchmarkRemoveEntity(size_t numEntities)
+{
+	ECS* ecs = new ECS();
+	std::vector<EntityHandle> handles = MakeMovingEntities(*ecs, numEntities);
+
+	double start = GetTime();
+	for (EntityHandle handle : handles)
+	{
+		ecs->RemoveEntity(handle);
+	}
+	double time = GetTime() - start;
+
+	delete ecs;
+	return time;
+}
+
+/** @brief Updates a system working with a single component type. */
+static double BenchmarkUpdateSingle(ECS& ecs, ECSSystemList& systems)
+{
+	double start = GetTime();
+	ecs.UpdateSystems(systems, 0.01f);
+	return GetTime() - start;
+}
+
+/** @brief Updates a system working with two component types, on a thread pool. */
+static double BenchmarkUpdateParallel(ECS& ecs, ECSSystemList& systems, ECSThreadPool& threadPool)
+{
+	double start = GetTime();
+	ecs.UpdateSystems(systems, 0.01f, threadPool);
+	return GetTime() - start;
+}
+
+/** @brief Looks up the component of every entity, in a random order. */
+static double BenchmarkGetComponent(ECS& ecs, const std::vector<EntityHandle>& handles)
+{
+	float sum = 0.0f;
+
+	double start = GetTime();
+	for (EntityHandle handle : handles)
+	{
+		sum += ecs.GetComponent<TransformComponent>(handle)->transform.GetPosition().x;
+	}
+	double time = GetTime() - start;
+
+	sink = sum;
+	return time;
+}
+
+/** @brief Makes and removes entities one at a time, notifying several listeners of each. */
+static double BenchmarkListenerDispatch(size_t numEntities)
+{
+	ECS* ecs = new ECS();
+	CountingListener listeners[NUM_LISTENERS];
+	for (CountingListener& listener : listeners)
+	{
+		ecs->AddListener(&listener);
+	}
+
+	TransformComponent transformComponent;
+	MotionComponent motionComponent;
+	std::vector<EntityHandle> handles(numEntities);
+
+	double start = GetTime();
+	for (size_t i = 0; i < numEntities; i++)
+	{
+		handles[i] = ecs->MakeEntity(transformComponent, motionComponent);
+	}
+	for (EntityHandle handle : handles)
+	{
+		ecs->RemoveEntity(handle);
+	}
+	double time = GetTime() - start;
+
+	sink = (float)(listeners[0].numMade + listeners[0].numRemoved);
+
+	delete ecs;
+	return time;
+}
+
+/** @brief Moves every entity in the scene, then finds the pairs of entities which may collide. */
+static double BenchmarkBroadphase(IBroadphase& broadphase, BroadphaseScene& scene,
+	std::vector<std::pair<EntityHandle, EntityHandle>>& pairs)
+{
+	double start = GetTime();
+	for (size_t i = 0; i < scene.handles.size(); i++)
+	{
+		scene.positions[i] += scene.velocities[i] * 0.01f;
+		broadphase.Update(scene.handles[i], scene.GetAABB(i));
+	}
+
+	pairs.clear();
+	broadphase.FindPairs(pairs);
+	double time = GetTime() - start;
+
+	sink = (float)pairs.size();
+	return time;
+}
+
+/** @brief Runs every benchmark at a single entity count. */
+static void RunBenchmarks(size_t numEntities, ECSThreadPool& threadPool,
+	std::vector<BenchmarkResult>& results)
+{
+	unsigned int numRepetitions = GetNumRepetitions(numEntities);
+
+	auto addResult = [&results, numEntities](const char* name) -> BenchmarkResult&
+	{
+		std::cerr << "Running " << name << " with " << numEntities << " entities" << std::endl;
+
+		results.push_back({ name, numEntities, {} });
+		return results.back();
+	};
+
+	// Benchmarks which make their own ECS every repetition
+	BenchmarkResult* result = &addResult("make_entity");
+	for (unsigned int i = 0; i < numRepetitions; i++)
+	{
+		result->times.push_back(BenchmarkMakeEntity(numEntities));
+	}
+
+	result = &addResult("make_entities");
+	for (unsigned int i = 0; i < numRepetitions; i++)
+	{
+		result->times.push_back(BenchmarkMakeEntities(numEntities));
+	}
+
+	result = &addResult("remove_entity");
+	for (unsigned int i = 0; i < numRepetitions; i++)
+	{
+		result->times.push_back(BenchmarkRemoveEntity(numEntities));
+	}
+
+	result = &addResult("listener_dispatch");
+	for (unsigned int i = 0; i < numRepetitions; i++)
+	{
+		result->times.push_back(BenchmarkListenerDispatch(numEntities));
+	}
+
+	// Benchmarks which share a single ECS between repetitions
+	ECS ecs;
+	std::vector<EntityHandle> handles = MakeMovingEntities(ecs, numEntities);
+
+	TranslateSystem translateSystem;
+	ECSSystemList singleSystems;
+	singleSystems.AddSystem(translateSystem);
+
+	result = &addResult("update_single");
+	for (unsigned int i = 0; i < numRepetitions; i++)
+	{
+		result->times.push_back(BenchmarkUpdateSingle(ecs, singleSystems));
+	}
+
+	MotionSystem motionSystem;
+	ECSSystemList multiSystems;
+	multiSystems.AddSystem(motionSystem);
+
+	result = &addResult("update_multi");
+	for (unsigned int i = 0; i < numRepetitions; i++)
+	{
+		result->times.push_back(BenchmarkUpdateSingle(ecs, multiSystems));
+	}
+
+	result = &addResult("update_multi_parallel");
+	for (unsigned int i = 0; i < numRepetitions; i++)
+	{
+		result->times.push_back(BenchmarkUpdateParallel(ecs, multiSystems, threadPool));
+	}
+
+	// Always the same order, so that results are comparable between runs
+	std::mt19937 random(12345);
+	std::shuffle(handles.begin(), handles.end(), random);
+
+	result = &addResult("get_component_random");
+	for (unsigned int i = 0; i < numRepetitions; i++)
+	{
+		result->times.push_back(BenchmarkGetComponent(ecs, handles));
+	}
+
+	// Broadphases, which are each given the same scene
+	OctreeBroadphase octreeBroadphase;
+	DynamicAABBTreeBroadphase dynamicAABBTreeBroadphase;
+	SweepAndPruneBroadphase sweepAndPruneBroadphase;
+	SpatialHashGridBroadphase spatialHashGridBroadphase(2.0f);
+
+	const std::pair<const char*, IBroadphase*> broadphases[] = {
+		{ "broadphase_octree", &octreeBroadphase },
+		{ "broadphase_dynamic_aabb_tree", &dynamicAABBTreeBroadphase },
+		{ "broadphase_sweep_and_prune", &sweepAndPruneBroadphase },
+		{ "broadphase_spatial_hash_grid", &spatialHashGridBroadphase },
+	};
+
+	std::vector<std::pair<EntityHandle, EntityHandle>> pairs;
+
+	for (const auto& [name, broadphase] : broadphases)
+	{
+		BroadphaseScene scene = MakeBroadphaseScene(numEntities);
+		for (size_t i = 0; i < numEntities; i++)
+		{
+			broadphase->Add(scene.handles[i], scene.GetAABB(i));
+		}
+
+		// The first frame after adding every entity is not what is being measured
+		broadphase->FindPairs(pairs);
+
+		result = &addResult(name);
+		for (unsigned int i = 0; i < numRepetitions; i++)
+		{
+			result->times.push_back(BenchmarkBroadphase(*broadphase, scene, pairs));
+		}
+
+		broadphase->Clear();
+	}
+}
+
+/** @brief Gets the fastest repetition of a benchmark, in seconds. */
+static double GetMinTime(const BenchmarkResult& result)
+{
+	return *std::min_element(result.times.begin(), result.times.end());
+}
+
+/** @brief Gets the median repetition of a benchmark, in seconds. */
+static double GetMedianTime(const BenchmarkResult& result)
+{
+	std::vector<double> times = result.times;
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+/** @brief Writes the results as CSV, with a header row. */
+static void WriteCSV(std::ostream& out, const std::vector<BenchmarkResult>& results)
+{
+	out << "name,entities,repetitions,min_seconds,median_seconds,ns_per_entity,entities_per_second"
+		<< std::endl;
+
+	for (const BenchmarkResult& result : results)
+	{
+		double minTime = GetMinTime(result);
+
+		out << result.name << ',' << result.numEntities << ',' << result.times.size() << ','
+			<< minTime << ',' << GetMedianTime(result) << ','
+			<< minTime * 1e9 / result.numEntities << ',' << result.numEntities / minTime
+			<< std::endl;
+	}
+}
+
+/** @brief Writes the results as a JSON object with an array of benchmarks. */
+static void WriteJSON(std::ostream& out, const std::vector<BenchmarkResult>& results)
+{
+	out << "{" << std::endl << "\t\"benchmarks\": [" << std::endl;
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& result = results[i];
+		double minTime = GetMinTime(result);
+
+		out << "\t\t{ \"name\": \"" << result.name << "\", \"entities\": " << result.numEntities
+			<< ", \"repetitions\": " << result.times.size() << ", \"min_seconds\": " << minTime
+			<< ", \"median_seconds\": " << GetMedianTime(result) << ", \"ns_per_entity\": "
+			<< minTime * 1e9 / result.numEntities << ", \"entities_per_second\": "
+			<< result.numEntities / minTime << " }" << (i + 1 < results.size() ? "," : "")
+			<< std::endl;
+	}
+
+	out << "\t]" << std::endl << "}" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	bool isJSON = false;
+	std::string outputPath;
+	size_t maxEntities = ENTITY_COUNTS[sizeof(ENTITY_COUNTS) / sizeof(ENTITY_COUNTS[0]) - 1];
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+		{
+			isJSON = std::strcmp(argv[++i], "json") == 0;
+		}
+		else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+		{
+			outputPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--max-entities") == 0 && i + 1 < argc)
+		{
+			maxEntities = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0]
+				<< " [--format csv|json] [--output <path>] [--max-entities <count>]" << std::endl;
+			return 1;
+		}
+	}
+
+	ECSThreadPool threadPool;
+	std::vector<BenchmarkResult> results;
+
+	for (size_t numEntities : ENTITY_COUNTS)
+	{
+		if (numEntities <= maxEntities)
+		{
+			RunBenchmarks(numEntities, threadPool, results);
+		}
+	}
+
+	// Results go to standard output unless a file is given; progress always goes to standard
+	// error, so that it never mixes with the results
+	std::ofstream file;
+	if (!outputPath.empty())
+	{
+		file.open(outputPath);
+		if (!file.is_open())
+		{
+			std::cerr << "Failed to open " << outputPath << " for writing." << std::endl;
+			return 1;
+		}
+	}
+
+	std::ostream& out = outputPath.empty() ? std::cout : file;
+	out.precision(9);
+
+	if (isJSON)
+	{
+		WriteJSON(out, results);
+	}
+	else
+	{
+		WriteCSV(out, results);
+	}
+
+	return 0;
+}
@@ -68,9 +68,29 @@ bool AABB::Intersects(const AABB& other) const
 	);
 }
 
+bool AABB::Contains(const AABB& other) const
+{
+	return
+		extents[0].x <= other.extents[0].x &&
+		extents[0].y <= other.extents[0].y &&
+		extents[0].z <= other.extents[0].z &&
+		extents[1].x >= other.extents[1].x &&
+		extents[1].y >= other.extents[1].y &&
+		extents[1].z >= other.extents[1].z;
+}
 
 AABB AABB::Translate(const glm::vec3& translation) const
 {
 	// Apply translation to min and max extents
 	return AABB(extents[0] + translation, extents[1] + translation);
 }
+
+AABB AABB::Expand(float distance) const
+{
+	return AABB(extents[0] - glm::vec3(distance), extents[1] + glm::vec3(distance));
+}
+
+AABB AABB::Combine(const AABB& other) const
+{
+	return AABB(glm::min(extents[0], other.extents[0]), glm::max(extents[1], other.extents[1]));
+}
@@ -71,6 +71,14 @@ public:
 	 */
 	bool Intersects(const AABB& other) const;
 
+	/**
+	 * Determines if another AABB lies entirely inside of the AABB.
+	 * 
+	 * @param other The other AABB to compare against.
+	 * @return Whether or not the other AABB is contained.
+	 */
+	[[nodiscard]] bool Contains(const AABB& other) const;
+
 	/**
 	 * Translates a copy of the AABB. No rotation or scaling is applied.
 	 * 
@@ -79,11 +87,34 @@ public:
 	 */
 	[[nodiscard]] AABB Translate(const glm::vec3& translation) const;
 
+	/**
+	 * Grows a copy of the AABB by the same distance in every direction.
+	 * 
+	 * @param distance The distance to move every face of the AABB outwards by.
+	 * @return The grown copy of the AABB.
+	 */
+	[[nodiscard]] AABB Expand(float distance) const;
+
+	/**
+	 * Finds the smallest AABB which contains both the AABB and another AABB.
+	 * 
+	 * @param other The other AABB to contain.
+	 * @return The combined AABB.
+	 */
+	[[nodiscard]] AABB Combine(const AABB& other) const;
+
 	// Getter methods...
 	[[nodiscard]] glm::vec3 GetCenter() const { return (extents[0] + extents[1]) * 0.5f; }
 	[[nodiscard]] glm::vec3 GetMinExtents() const { return extents[0]; }
 	[[nodiscard]] glm::vec3 GetMaxExtents() const { return extents[1]; }
 
+	/** @brief Gets the total area of the faces of the AABB. */
+	[[nodiscard]] float GetSurfaceArea() const
+	{
+		const glm::vec3 size = extents[1] - extents[0];
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
 private:
 	glm::vec3 extents[2];
 };
\ No newline at end of file
@@ -0,0 +1,437 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#pragma once
+
+#include "AABB.h"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace Algorithm
+{
+	/**
+	 * @brief Bounding volume hierarchy which is updated incrementally as objects move, rather than
+	 * being rebuilt. Used for efficient broadphase collision detection.
+	 *
+	 * Every object is stored in a leaf, with a fat bounding box which is larger than the object's
+	 * actual bounding box by a margin. As long as an object stays inside of it's fat bounding box,
+	 * moving it does not change the tree at all. Leaves are inserted next to the sibling which
+	 * grows the tree's surface area the least, and the tree is kept balanced with rotations.
+	 *
+	 * Nodes are stored in a single array and refer to each other by index; freed nodes are reused,
+	 * so inserting and removing objects does not allocate once the array has grown large enough.
+	 *
+	 * @tparam Handle Handle used for identifying the objects stored in the tree.
+	 */
+	template<typename Handle>
+	class DynamicAABBTree
+	{
+	public:
+		// Index used in place of a node which does not exist
+		static constexpr int NULL_NODE = -1;
+
+		/**
+		 * @param margin The distance by which the fat bounding box of every object is larger than
+		 *		the object's actual bounding box.
+		 */
+		DynamicAABBTree(float margin = 0.1f) : margin(margin) {}
+
+		/**
+		 * @brief Inserts an object into the tree.
+		 * @param handle Handle of the object.
+		 * @param objectBounds The bounding box of the object.
+		 * @return The proxy of the object; the index of it's leaf, which identifies the object in
+		 *		other methods until it is removed.
+		 */
+		int Insert(const Handle& handle, const AABB& objectBounds)
+		{
+			int proxy = AllocateNode();
+			nodes[proxy].aabb = objectBounds.Expand(margin);
+			nodes[proxy].handle = handle;
+			nodes[proxy].height = 0;
+
+			InsertLeaf(proxy);
+			return proxy;
+		}
+
+		/**
+		 * @brief Removes an object from the tree. The proxy may be reused by objects inserted
+		 * afterwards.
+		 * @param proxy The proxy returned when the object was inserted.
+		 */
+		void Remove(int proxy)
+		{
+			assert(IsLeaf(proxy));
+
+			RemoveLeaf(proxy);
+			FreeNode(proxy);
+		}
+
+		/**
+		 * @brief Updates the bounding box of an object. The object is only reinserted if the new
+		 * bounding box is no longer inside of it's fat bounding box.
+		 * @param proxy The proxy returned when the object was inserted.
+		 * @param objectBounds The new bounding box of the object.
+		 * @return Whether or not the object was reinserted, changing it's fat bounding box.
+		 */
+		bool Move(int proxy, const AABB& objectBounds)
+		{
+			assert(IsLeaf(proxy));
+
+			if (nodes[proxy].aabb.Contains(objectBounds))
+			{
+				return false;
+			}
+
+			RemoveLeaf(proxy);
+			nodes[proxy].aabb = objectBounds.Expand(margin);
+			InsertLeaf(proxy);
+			return true;
+		}
+
+		/**
+		 * @brief Finds every object whose fat bounding box intersects a bounding box.
+		 * @param bounds The bounding box to test against.
+		 * @param callback Called with the proxy of every object found.
+		 */
+		template<typename Callback>
+		void Query(const AABB& bounds, Callback callback)
+		{
+			if (root == NULL_NODE)
+			{
+				return;
+			}
+
+			queryStack.clear();
+			queryStack.push_back(root);
+
+			while (!queryStack.empty())
+			{
+				int index = queryStack.back();
+				queryStack.pop_back();
+
+				const Node& node = nodes[index];
+				if (!node.aabb.Intersects(bounds))
+				{
+					continue;
+				}
+
+				if (node.IsLeaf())
+				{
+					callback(index);
+				}
+				else
+				{
+					queryStack.push_back(node.child1);
+					queryStack.push_back(node.child2);
+				}
+			}
+		}
+
+		/** @brief Gets the fat bounding box of an object. */
+		[[nodiscard]] const AABB& GetFatAABB(int proxy) const { return nodes[proxy].aabb; }
+
+		/** @brief Gets the handle of an object. */
+		[[nodiscard]] const Handle& GetHandle(int proxy) const { return nodes[proxy].handle; }
+
+		/** @brief Determines if a proxy refers to an object currently stored in the tree. */
+		[[nodiscard]] bool IsLeaf(int proxy) const
+		{
+			return proxy >= 0 && proxy < (int)nodes.size() && nodes[proxy].height == 0;
+		}
+
+		/** @brief Gets the number of levels of the tree, or 0 if the tree is empty. */
+		[[nodiscard]] int GetHeight() const
+		{
+			return root == NULL_NODE ? 0 : nodes[root].height + 1;
+		}
+
+	private:
+		/** @brief A leaf storing an object, or an internal node with exactly two children. */
+		struct Node
+		{
+			// The fat bounding box of the object if the node is a leaf, otherwise the bounding box
+			// of both children
+			AABB aabb;
+
+			Handle handle;
+
+			// The parent of the node, or the next free node if the node is free
+			int parent = NULL_NODE;
+
+			int child1 = NULL_NODE;
+			int child2 = NULL_NODE;
+
+			// 0 for leaves, -1 for free nodes
+			int height = -1;
+
+			[[nodiscard]] bool IsLeaf() const { return child1 == NULL_NODE; }
+		};
+
+		std::vector<Node> nodes;
+		int root = NULL_NODE;
+
+		// Free nodes form a linked list through their parent index
+		int freeList = NULL_NODE;
+
+		float margin;
+
+		// Reused by every query, so that querying does not allocate
+		std::vector<int> queryStack;
+
+		/** @brief Takes a node from the free list, or grows the node array if there is none. */
+		int AllocateNode()
+		{
+			if (freeList == NULL_NODE)
+			{
+				nodes.emplace_back();
+				return (int)nodes.size() - 1;
+			}
+
+			int index = freeList;
+			freeList = nodes[index].parent;
+
+			nodes[index].parent = NULL_NODE;
+			nodes[index].child1 = NULL_NODE;
+			nodes[index].child2 = NULL_NODE;
+			return index;
+		}
+
+		/** @brief Returns a node to the free list. */
+		void FreeNode(int index)
+		{
+			nodes[index].parent = freeList;
+			nodes[index].height = -1;
+			freeList = index;
+		}
+
+		/** @brief Links a leaf into the tree, next to the sibling which costs the least. */
+		void InsertLeaf(int leaf)
+		{
+			if (root == NULL_NODE)
+			{
+				root = leaf;
+				nodes[root].parent = NULL_NODE;
+				return;
+			}
+
+			// Walk down the tree, following the child whose bounding box grows the least, until
+			// linking the leaf here is cheaper than descending further
+			const AABB leafAABB = nodes[leaf].aabb;
+			int index = root;
+
+			while (!nodes[index].IsLeaf())
+			{
+				const Node& node = nodes[index];
+				const float area = node.aabb.GetSurfaceArea();
+				const float combinedArea = node.aabb.Combine(leafAABB).GetSurfaceArea();
+
+				// Cost of making a new parent of this node and the leaf
+				const float cost = 2.0f * combinedArea;
+
+				// Minimum cost of pushing the leaf further down the tree
+				const float inheritanceCost = 2.0f * (combinedArea - area);
+
+				const float cost1 = GetDescendCost(node.child1, leafAABB) + inheritanceCost;
+				const float cost2 = GetDescendCost(node.child2, leafAABB) + inheritanceCost;
+
+				if (cost < cost1 && cost < cost2)
+				{
+					break;
+				}
+
+				index = cost1 < cost2 ? node.child1 : node.child2;
+			}
+
+			// Make a new parent of the sibling and the leaf
+			const int sibling = index;
+			const int oldParent = nodes[sibling].parent;
+			const int newParent = AllocateNode();
+
+			nodes[newParent].parent = oldParent;
+			nodes[newParent].aabb = leafAABB.Combine(nodes[sibling].aabb);
+			nodes[newParent].height = nodes[sibling].height + 1;
+			nodes[newParent].child1 = sibling;
+			nodes[newParent].child2 = leaf;
+			nodes[sibling].parent = newParent;
+			nodes[leaf].parent = newParent;
+
+			if (oldParent == NULL_NODE)
+			{
+				root = newParent;
+			}
+			else if (nodes[oldParent].child1 == sibling)
+			{
+				nodes[oldParent].child1 = newParent;
+			}
+			else
+			{
+				nodes[oldParent].child2 = newParent;
+			}
+
+			// Walk back up the tree, fixing the heights and bounding boxes of the ancestors
+			RefitAncestors(nodes[leaf].parent);
+		}
+
+		/**
+		 * @brief Used internally for finding the cost of inserting a leaf below a given child.
+		 * @param child The child to descend into.
+		 * @param leafAABB The bounding box of the leaf being inserted.
+		 * @return The increase in surface area caused by descending into the child.
+		 */
+		[[nodiscard]] float GetDescendCost(int child, const AABB& leafAABB) const
+		{
+			const AABB combined = leafAABB.Combine(nodes[child].aabb);
+
+			if (nodes[child].IsLeaf())
+			{
+				return combined.GetSurfaceArea();
+			}
+
+			return combined.GetSurfaceArea() - nodes[child].aabb.GetSurfaceArea();
+		}
+
+		/** @brief Unlinks a leaf from the tree, replacing it's parent with it's sibling. */
+		void RemoveLeaf(int leaf)
+		{
+			if (leaf == root)
+			{
+				root = NULL_NODE;
+				return;
+			}
+
+			const int parent = nodes[leaf].parent;
+			const int grandParent = nodes[parent].parent;
+			const int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 :
+				nodes[parent].child1;
+
+			if (grandParent == NULL_NODE)
+			{
+				root = sibling;
+				nodes[sibling].parent = NULL_NODE;
+				FreeNode(parent);
+				return;
+			}
+
+			if (nodes[grandParent].child1 == parent)
+			{
+				nodes[grandParent].child1 = sibling;
+			}
+			else
+			{
+				nodes[grandParent].child2 = sibling;
+			}
+
+			nodes[sibling].parent = grandParent;
+			FreeNode(parent);
+
+			RefitAncestors(grandParent);
+		}
+
+		/**
+		 * @brief Rebalances and recomputes the height and bounding box of a node and every
+		 * ancestor of it.
+		 */
+		void RefitAncestors(int index)
+		{
+			while (index != NULL_NODE)
+			{
+				index = Balance(index);
+
+				Node& node = nodes[index];
+				node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+				node.aabb = nodes[node.child1].aabb.Combine(nodes[node.child2].aabb);
+
+				index = node.parent;
+			}
+		}
+
+		/**
+		 * @brief Performs a left or right rotation if a node is imbalanced, so that the heights of
+		 * it's children differ by at most one.
+		 * @param a The node to balance.
+		 * @return The node which took the place of the node in the tree.
+		 */
+		int Balance(int a)
+		{
+			if (nodes[a].IsLeaf() || nodes[a].height < 2)
+			{
+				return a;
+			}
+
+			const int b = nodes[a].child1;
+			const int c = nodes[a].child2;
+			const int balance = nodes[c].height - nodes[b].height;
+
+			// Rotate c up
+			if (balance > 1)
+			{
+				return Rotate(a, c, b);
+			}
+
+			// Rotate b up
+			if (balance < -1)
+			{
+				return Rotate(a, b, c);
+			}
+
+			return a;
+		}
+
+		/**
+		 * @brief Used internally for rotating the taller child of a node up in it's place.
+		 * @param a The imbalanced node.
+		 * @param up The taller child of a, which takes a's place.
+		 * @param other The other child of a.
+		 * @return The node which took the place of a; always up.
+		 */
+		int Rotate(int a, int up, int other)
+		{
+			const int f = nodes[up].child1;
+			const int g = nodes[up].child2;
+
+			// Swap a and up
+			nodes[up].child1 = a;
+			nodes[up].parent = nodes[a].parent;
+			nodes[a].parent = up;
+
+			if (nodes[up].parent == NULL_NODE)
+			{
+				root = up;
+			}
+			else if (nodes[nodes[up].parent].child1 == a)
+			{
+				nodes[nodes[up].parent].child1 = up;
+			}
+			else
+			{
+				nodes[nodes[up].parent].child2 = up;
+			}
+
+			// The taller grandchild stays with up; the other one replaces up below a
+			const int taller = nodes[f].height > nodes[g].height ? f : g;
+			const int shorter = taller == f ? g : f;
+
+			nodes[up].child2 = taller;
+
+			if (nodes[a].child1 == up)
+			{
+				nodes[a].child1 = shorter;
+			}
+			else
+			{
+				nodes[a].child2 = shorter;
+			}
+			nodes[shorter].parent = a;
+
+			nodes[a].aabb = nodes[other].aabb.Combine(nodes[shorter].aabb);
+			nodes[a].height = 1 + std::max(nodes[other].height, nodes[shorter].height);
+
+			nodes[up].aabb = nodes[a].aabb.Combine(nodes[taller].aabb);
+			nodes[up].height = 1 + std::max(nodes[a].height, nodes[taller].height);
+
+			return up;
+		}
+	};
+}
@@ -4,15 +4,22 @@
 
 #include "AABB.h"
 
-#include <unordered_map>
+#include <cstdint>
+#include <utility>
+#include <vector>
 #include <GLM/glm.hpp>
 #include <cassert>
-#include <iostream>
 
 namespace Algorithm
 {
 	/**
 	 * @brief Octree data structure. Used for efficient space partitioning.
+	 *
+	 * Every node is stored in a single array, with the 8 children of a node stored next to each
+	 * other, and objects are stored in a single array as well. Clearing the octree keeps the
+	 * capacity of both arrays, so an octree which is cleared and rebuilt every frame stops
+	 * allocating once it has grown to fit.
+	 *
 	 * @tparam Handle Handle used for uniquely identifying bounding boxes.
 	 */
 	template<typename Handle>
@@ -22,9 +29,36 @@ namespace Algorithm
 		/**
 		 * @param boundingBox Represents the bounds of the octree node
 		 */
-		Octree(const AABB& boundingBox) : boundingBox(boundingBox) {}
+		Octree(const AABB& boundingBox)
+		{
+			Clear(boundingBox);
+		}
 		virtual ~Octree() = default;
 
+		/**
+		 * @brief Removes every object from the octree, keeping the memory used for the next
+		 * objects to be inserted.
+		 * @param boundingBox The new bounds of the octree.
+		 */
+		void Clear(const AABB& boundingBox)
+		{
+			nodes.clear();
+			objects.clear();
+			sortedObjects.clear();
+			isSorted = false;
+
+			nodes.push_back({ boundingBox, NULL_INDEX, NULL_INDEX, 0, 0, 0 });
+		}
+
+		/**
+		 * @brief Removes every object from the octree, keeping it's bounds and the memory used
+		 * for the next objects to be inserted.
+		 */
+		void Clear()
+		{
+			Clear(nodes[0].boundingBox);
+		}
+
 		/**
 		 * @brief Performs insertion of some object so that it can be kept track of by the octree.
 		 * @param handle Uniquely identifying handle for the object being inserted. This is what
@@ -33,176 +67,296 @@ namespace Algorithm
 		 */
 		void Insert(const Handle& handle, const AABB& objectBounds)
 		{
-			// This node already has children
-			if (hasSplit)
+			const uint32_t object = (uint32_t)objects.size();
+			objects.push_back({ handle, objectBounds, NULL_INDEX });
+			isSorted = false;
+
+			// Descend until reaching a leaf node, or a node with no child which fits the object
+			uint32_t node = 0;
+			while (nodes[node].firstChild != NULL_INDEX)
 			{
-				if (!InsertToChildren(handle, objectBounds))
+				const uint32_t child = FindChild(node, objectBounds);
+				if (child == NULL_INDEX)
 				{
-					objects.insert({ handle, objectBounds });
+					break;
 				}
+				node = child;
 			}
-			// If this node is a leaf node
-			else
+
+			AddToNode(node, object);
+
+			if (nodes[node].firstChild == NULL_INDEX && nodes[node].numObjects > MAX_CAPACITY)
 			{
-				objects.insert({ handle, objectBounds });
-				if (objects.size() > MAX_CAPACITY)
-				{
-					Split();
-				}
+				Split(node);
 			}
 		}
 
 		/**
-		 * @brief Checks whether or not two objects are in a similar region of the octree.
-		 * @param a The first object to compare.
-		 * @param b The second object to compare.
-		 * @return true if the two objects are in a similar region of the octree.
-		 * @see AreRelatedInternal
+		 * @brief Finds every pair of objects whose bounding boxes intersect, with a single
+		 * traversal of the octree. An object can only intersect objects of the same node, or of
+		 * the node's ancestors and descendants, so only those are tested against each other.
+		 * @param pairs Array which the pairs are appended to. Every pair is only appended once, in
+		 *		no particular order.
 		 */
-		[[nodiscard]] bool AreRelated(const Handle& a, const Handle& b)
+		void FindPairs(std::vector<std::pair<Handle, Handle>>& pairs)
 		{
-			return AreRelatedInternal(a, b, false, false);
+			SortObjects();
+
+			candidates.clear();
+			FindPairsInternal(0, 0, pairs);
 		}
 
 	private:
 		static constexpr unsigned int MAX_CAPACITY = 5;
 
+		// Nodes at this depth are never split, so that many objects at the same position do not
+		// split the octree forever
+		static constexpr unsigned int MAX_DEPTH = 16;
+
+		static constexpr uint32_t NULL_INDEX = UINT32_MAX;
+
+		struct Node
+		{
+			AABB boundingBox;
+
+			// The first of the 8 children of the node, which are stored next to each other, or
+			// NULL_INDEX if the node has not been split
+			uint32_t firstChild;
+
+			// The first of the node's objects in the objects array, with the rest linked through
+			// Object::next
+			uint32_t firstObject;
+			uint32_t numObjects;
+
+			// Where the node's objects start in the sorted objects array
+			uint32_t objectsBegin;
+
+			uint32_t depth;
+		};
+
+		struct Object
+		{
+			Handle handle;
+			AABB bounds;
+
+			// The next object of the same node, or NULL_INDEX
+			uint32_t next;
+		};
+
 		/**
-		 * @brief Creates 8 octree children.
+		 * @brief Creates 8 octree children, and moves every object of the node which fits in a
+		 * single child into that child.
 		 */
-		void Split()
+		void Split(uint32_t node)
 		{
-			hasSplit = true;
+			if (nodes[node].depth >= MAX_DEPTH)
+			{
+				return;
+			}
 
-			const glm::vec3 center = boundingBox.GetCenter();
-			const glm::vec3 minExtents = boundingBox.GetMinExtents();
-			const glm::vec3 maxExtents = boundingBox.GetMaxExtents();
+			const uint32_t firstChild = (uint32_t)nodes.size();
 
-			// Reserve vector size for each of the 8 subdivisions
-			children.reserve(8);
+			const glm::vec3 center = nodes[node].boundingBox.GetCenter();
+			const glm::vec3 minExtents = nodes[node].boundingBox.GetMinExtents();
+			const glm::vec3 maxExtents = nodes[node].boundingBox.GetMaxExtents();
 
-			// Loops over every vertex of the bounding box which are used to generate split bounding
-			// boxes
-			for (const float x : { minExtents.x, maxExtents.x })
+			// Each child spans from the center to one of the corners of the node's bounding box
+			for (unsigned int i = 0; i < 8; i++)
 			{
-				for (const float y : { minExtents.y, maxExtents.y })
-				{
-					for (const float z : {minExtents.z, maxExtents.z})
-					{
-						children.emplace_back(AABB(std::vector{ glm::vec3(x, y, z), center }));
-					}
-				}
+				const glm::vec3 corner(
+					(i & 4) ? maxExtents.x : minExtents.x,
+					(i & 2) ? maxExtents.y : minExtents.y,
+					(i & 1) ? maxExtents.z : minExtents.z);
+
+				nodes.push_back({ AABB(glm::min(corner, center), glm::max(corner, center)),
+					NULL_INDEX, NULL_INDEX, 0, 0, nodes[node].depth + 1 });
 			}
 
+			nodes[node].firstChild = firstChild;
+
 			// Reinsert all the objects into the child nodes
-			for (auto it = objects.cbegin(); it != objects.cend(); )
+			uint32_t object = nodes[node].firstObject;
+			nodes[node].firstObject = NULL_INDEX;
+			nodes[node].numObjects = 0;
+
+			while (object != NULL_INDEX)
 			{
-				if (InsertToChildren(it->first, it->second))
-				{
-					it = objects.erase(it);
-				}
-				else
+				const uint32_t next = objects[object].next;
+				const uint32_t child = FindChild(node, objects[object].bounds);
+
+				AddToNode(child != NULL_INDEX ? child : node, object);
+				object = next;
+			}
+
+			// Children which received too many objects are split as well
+			for (uint32_t child = firstChild; child < firstChild + 8; child++)
+			{
+				if (nodes[child].numObjects > MAX_CAPACITY)
 				{
-					it = std::next(it);
+					Split(child);
 				}
 			}
 		}
 
 		/**
-		 * @brief Inserts an object into the octree given that the octree has been previously split.
-		 * @param handle Uniquely identifying handle for the object being inserted. This is what
-		 *		will be used to search for the object in other methods.
-		 * @param objectBounds The bounding box of the object being inserted.
-		 * @return Returns whether or not a child was found that completely encompasses the object.
+		 * @brief Finds the child of a node which an object fits in.
+		 * @param node The node, which must have been split.
+		 * @param objectBounds The bounding box of the object.
+		 * @return The only child which intersects the object, or NULL_INDEX if more than one
+		 *		child intersects the object.
 		 */
-		bool InsertToChildren(const Handle& handle, const AABB& objectBounds)
+		uint32_t FindChild(uint32_t node, const AABB& objectBounds) const
 		{
-			assert(hasSplit);
+			assert(nodes[node].firstChild != NULL_INDEX);
 
 			unsigned int numIntersections = 0;
-			unsigned int subtreeIndex = 0;
+			uint32_t child = NULL_INDEX;
 
 			// Loop over all child octrees
-			for (unsigned int i = 0; i < 8; i++)
+			for (uint32_t i = nodes[node].firstChild; i < nodes[node].firstChild + 8; i++)
 			{
-				// If we find a subtree which contains the bounding box
-				if (objectBounds.Intersects(children[i].boundingBox))
+				if (objectBounds.Intersects(nodes[i].boundingBox))
 				{
 					numIntersections++;
-					// If there is more than one child which overlaps the bounding box, add it
-					// to the parent
+					// If there is more than one child which overlaps the bounding box, it stays
+					// in the parent
 					if (numIntersections > 1)
 					{
-						return false;
+						return NULL_INDEX;
 					}
-					subtreeIndex = i;
+					child = i;
 				}
 			}
 
 			// Object is outside of the octree?
 			assert(numIntersections != 0);
 
-			// If the bounding box entirely fits in one child, insert the bounding box into that
-			// child and remove it from the parent if it exits
-			children[subtreeIndex].Insert(handle, objectBounds);
-			return true;
+			return child;
+		}
+
+		/** @brief Used internally for adding an object to the front of a node's objects. */
+		void AddToNode(uint32_t node, uint32_t object)
+		{
+			objects[object].next = nodes[node].firstObject;
+			nodes[node].firstObject = object;
+			nodes[node].numObjects++;
 		}
 
 		/**
-		 * @brief Used internally for checking if two objects are in a similar region of the octree.
-		 * @param a The first object to compare.
-		 * @param b The second object to compare.
-		 * @param aFound Indicates whether or not a has been found in a parent octree.
-		 * @param bFound Indicates whether or not b has been found in a parent octree.
-		 * @return true if the two objects are in a similar region of the octree.
-		 * @see AreRelated
+		 * @brief Copies the objects into the sorted objects array, so that the objects of every
+		 * node are next to each other. Only needed after objects have been inserted.
 		 */
-		[[nodiscard]] bool AreRelatedInternal(const Handle& a, const Handle& b, bool aFound,
-			bool bFound) const
+		void SortObjects()
 		{
-			const bool containsA = objects.count(a);
-			const bool containsB = objects.count(b);
-
-			// If this node contains both handle's they are definitely related
-			if (containsA && containsB) return true;
-
-			// If we previously found handle b and just found handle a, a and b are related
-			if (containsA && bFound) return true;
+			if (isSorted)
+			{
+				return;
+			}
 
-			// If we previously found handle a and just found handle b, a and b are related
-			if (containsB && aFound) return true;
+			sortedObjects.resize(objects.size());
 
-			// If the current node contains a we should look for b
-			if (containsA)
+			uint32_t begin = 0;
+			for (Node& node : nodes)
 			{
-				for (const Octree& child : children)
+				node.objectsBegin = begin;
+
+				for (uint32_t object = node.firstObject; object != NULL_INDEX;
+					object = objects[object].next)
 				{
-					if (child.AreRelatedInternal(a, b, true, bFound)) return true;
+					sortedObjects[begin++] = { objects[object].handle, objects[object].bounds };
 				}
 			}
-			// If the current node contains b we should look for a
-			else if (containsB)
+
+			isSorted = true;
+		}
+
+		/**
+		 * @brief Used internally for finding every pair of intersecting objects of a node and
+		 * it's descendants.
+		 * @param node The node.
+		 * @param candidatesBegin The start of the objects of the node's ancestors which intersect
+		 *		the node, in the candidates array.
+		 * @param pairs Array which the pairs are appended to.
+		 * @see FindPairs
+		 */
+		void FindPairsInternal(uint32_t node, size_t candidatesBegin,
+			std::vector<std::pair<Handle, Handle>>& pairs)
+		{
+			const size_t candidatesEnd = candidates.size();
+			const uint32_t begin = nodes[node].objectsBegin;
+			const uint32_t end = begin + nodes[node].numObjects;
+
+			for (uint32_t i = begin; i < end; i++)
 			{
-				for (const Octree& child : children)
+				const auto& [handle, bounds] = sortedObjects[i];
+
+				// Test against the objects of the ancestors...
+				for (size_t j = candidatesBegin; j < candidatesEnd; j++)
 				{
-					if (child.AreRelatedInternal(a, b, aFound, true)) return true;
+					const auto& [otherHandle, otherBounds] = sortedObjects[candidates[j]];
+					if (bounds.Intersects(otherBounds))
+					{
+						pairs.emplace_back(otherHandle, handle);
+					}
+				}
+
+				// Test against the objects of this node which come after this object, so that
+				// every pair is only tested once
+				for (uint32_t j = i + 1; j < end; j++)
+				{
+					if (bounds.Intersects(sortedObjects[j].second))
+					{
+						pairs.emplace_back(handle, sortedObjects[j].first);
+					}
 				}
 			}
-			// Recursively search the child nodes for a and b
-			else
+
+			const uint32_t firstChild = nodes[node].firstChild;
+			if (firstChild == NULL_INDEX)
 			{
-				for (const Octree& child : children)
+				return;
+			}
+
+			for (uint32_t child = firstChild; child < firstChild + 8; child++)
+			{
+				const AABB& childBounds = nodes[child].boundingBox;
+				const size_t childCandidatesBegin = candidates.size();
+
+				// The objects of this node and it's ancestors are ancestors of the objects of
+				// every child, but objects outside of a child cannot intersect anything in it
+				for (size_t j = candidatesBegin; j < candidatesEnd; j++)
+				{
+					if (sortedObjects[candidates[j]].second.Intersects(childBounds))
+					{
+						candidates.push_back(candidates[j]);
+					}
+				}
+				for (uint32_t j = begin; j < end; j++)
 				{
-					if (child.AreRelatedInternal(a, b, aFound, bFound)) return true;
+					if (sortedObjects[j].second.Intersects(childBounds))
+					{
+						candidates.push_back(j);
+					}
 				}
-			}
 
-			return false;
+				FindPairsInternal(child, childCandidatesBegin, pairs);
+
+				candidates.resize(childCandidatesBegin);
+			}
 		}
 
-		bool hasSplit = false;
-		std::unordered_map<Handle, AABB> objects;
-		std::vector<Octree> children;
-		const AABB boundingBox;
+		// Every node, with the root first
+		std::vector<Node> nodes;
+
+		// Every object, in the order they were inserted
+		std::vector<Object> objects;
+
+		// Every object, with the objects of every node next to each other
+		std::vector<std::pair<Handle, AABB>> sortedObjects;
+		bool isSorted = false;
+
+		// Indices into the sorted objects array of the objects of the ancestors of each node being
+		// visited by FindPairs, which intersect that node
+		std::vector<uint32_t> candidates;
 	};
 }
@@ -24,526 +24,1513 @@
  *     SOFTWARE.
  */
 
+
 #include "ECS.h"
 #include <iostream>
-#include <algorithm> // std::max
-#include <cstring> // std::memcpy
+#include <algorithm> // std::sort, std::stable_sort, std::unique, std::min, std::max
+#include <chrono>
+#include <typeinfo>
 
 ECS::~ECS()
 {
-	// Iterate over all component types, and delete every component
-	for (auto it = components.begin(); it != components.end(); it++)
+	// Delete every archetype
+	// Archetypes free all of the components they store when they are deleted
+	for (ECSArchetype* archetype : archetypes)
+	{
+		delete archetype;
+	}
+
+	for (auto& query : queries)
+	{
+		delete query.second;
+	}
+
+	// Pools are deleted after the archetypes, which free the components stored in them
+	for (ECSComponentPool* pool : componentPools)
+	{
+		delete pool;
+	}
+
+	// Commands which were never played back are discarded
+	for (auto& commandBuffer : commandBuffers)
+	{
+		delete commandBuffer.second;
+	}
+}
+
+void ECS::AddListener(ECSListener* listener)
+{
+	listeners.push_back(listener);
+
+	// Component types are all registered before the ECS is used
+	componentListeners.resize(BaseECSComponent::GetNumTypes());
+
+	// Add the listener to the bucket of every component type it is interested in
+	for (unsigned int componentID = 0; componentID < componentListeners.size(); componentID++)
+	{
+		if (listener->ShouldNotifyOnAllComponentOperations() ||
+			(componentID < BaseECSComponent::MAX_TYPES && listener->GetSignature()[componentID]))
+		{
+			componentListeners[componentID].push_back(listener);
+		}
+	}
+
+	// Existing archetypes may now have one more listener interested in their entities
+	for (ECSArchetype* archetype : archetypes)
+	{
+		UpdateEntityListeners(archetype);
+	}
+}
+
+EntityHandle ECS::MakeEntity(BaseECSComponent** entityComponents, const unsigned int* componentIDs,
+	size_t numberOfComponents)
+{
+	// Check that the components can be added to the new entity
+	if (!ValidateComponentTypes(componentIDs, numberOfComponents))
+	{
+		// Abort; return a null entity handle
+		return nullptr;
+	}
+
+	// Find a slot for the new entity, and construct it in the archetype which stores entities
+	// with these component types
+	EntityHandle handle = AllocateEntity();
+	ConstructEntity(handle, FindOrCreateArchetype(componentTypesStorage), entityComponents,
+		componentIDs, numberOfComponents);
+
+	return handle;
+}
+
+bool ECS::ValidateComponentTypes(const unsigned int* componentIDs, size_t numberOfComponents)
+{
+	// The component types of the new entity, sorted to find the entity's archetype
+	std::vector<unsigned int>& componentTypes = componentTypesStorage;
+	componentTypes.assign(componentIDs, componentIDs + numberOfComponents);
+	std::sort(componentTypes.begin(), componentTypes.end());
+
+	// Iterate over all components specified and check if they can be added to the new entity
+	for (unsigned int i = 0; i < numberOfComponents; i++)
+	{
+		// Check if componentID is actually valid
+		if (!BaseECSComponent::IsTypeValid(componentTypes[i]))
+		{
+			std::cerr << "'" << componentTypes[i] << "' is not a valid component type." << std::endl;
+			return false;
+		}
+
+		// Entities can only have one component of a given type
+		if (i > 0 && componentTypes[i] == componentTypes[i - 1])
+		{
+			std::cerr << "Component type '" << componentTypes[i] << "' was specified more than "
+				"once." << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+EntityHandle ECS::ReserveEntity()
+{
+	std::lock_guard<std::mutex> lock(entitiesMutex);
+
+	// Reuse a free slot if there is one
+	if (!freeEntities.empty())
+	{
+		uint32_t index = freeEntities.back();
+		freeEntities.pop_back();
+		return EntityHandle(index, entities[index].generation);
+	}
+
+	// Otherwise, reserve a slot past the end of the table. The table itself is not grown here,
+	// since other threads may be reading it.
+	// Generation 0 is reserved for null handles
+	uint32_t index = (uint32_t)entities.size() + numReservedEntities;
+	numReservedEntities++;
+	return EntityHandle(index, 1);
+}
+
+EntityHandle ECS::AllocateEntity()
+{
+	std::lock_guard<std::mutex> lock(entitiesMutex);
+
+	// Reuse a free slot if there is one
+	if (!freeEntities.empty())
+	{
+		uint32_t index = freeEntities.back();
+		freeEntities.pop_back();
+		return EntityHandle(index, entities[index].generation);
+	}
+
+	// Otherwise grow the table, along with any slots reserved past the end of it
+	// Generation 0 is reserved for null handles
+	EntityInternal slot;
+	slot.archetype = nullptr;
+	slot.row = 0;
+	slot.generation = 1;
+	entities.resize(entities.size() + numReservedEntities + 1, slot);
+	numReservedEntities = 0;
+
+	return EntityHandle((uint32_t)entities.size() - 1, 1);
+}
+
+void ECS::ReleaseEntity(uint32_t index)
+{
+	EntityInternal& entity = entities[index];
+	entity.archetype = nullptr;
+
+	// Increment the generation so that any remaining handles to the entity become stale
+	// Generation 0 is reserved for null handles
+	entity.generation++;
+	if (entity.generation == 0)
+	{
+		entity.generation = 1;
+	}
+
+	// Allow the slot to be reused by the next entity made
+	std::lock_guard<std::mutex> lock(entitiesMutex);
+	freeEntities.push_back(index);
+}
+
+void ECS::ConstructEntity(EntityHandle handle, ECSArchetype* archetype,
+	BaseECSComponent** entityComponents, const unsigned int* componentIDs,
+	size_t numberOfComponents)
+{
+	EntityInternal& newEntity = HandleToEntity(handle);
+
+	// Add a row for the entity to the archetype
+	newEntity.archetype = archetype;
+	newEntity.row = archetype->AddRow(handle);
+
+	// Every component of a new entity counts as changed
+	uint32_t tick = changeTick;
+
+	// Iterate over all components specified and construct them in the archetype
+	for (unsigned int i = 0; i < numberOfComponents; i++)
+	{
+		// Construct the component in the archetype's chunk, passing in the entity handle so that
+		// the component knows what entity it belongs to, and the pointer to the component to copy
+		unsigned int column = archetype->GetColumn(componentIDs[i]);
+		archetype->ConstructComponent(newEntity.row, column, handle, entityComponents[i]);
+		archetype->MarkChanged(newEntity.row, column, tick);
+	}
+
+	// Now that the entity is created, dispatch the make entity event to all listeners
+	// in the ECS
+	NotifyMakeEntities(archetype, &handle, 1);
+}
+
+bool ECS::MakeEntities(size_t count, BaseECSComponent** prototypeComponents,
+	const unsigned int* componentIDs, size_t numberOfComponents, EntityHandle* handles)
+{
+	// Check that the components can be added to the new entities
+	if (!ValidateComponentTypes(componentIDs, numberOfComponents))
+	{
+		return false;
+	}
+
+	if (count == 0)
+	{
+		return true;
+	}
+
+	// Every entity shares the same archetype; reserve room for all of them at once
+	ECSArchetype* archetype = FindOrCreateArchetype(componentTypesStorage);
+	archetype->Reserve(archetype->size() + count);
+
+	// Used for storing the handles if the caller does not need them
+	std::vector<EntityHandle> handlesStorage;
+	if (handles == nullptr)
+	{
+		handlesStorage.resize(count);
+		handles = handlesStorage.data();
+	}
+
+	// Find slots for all entities. Free slots are reused first, and the entity table grows at
+	// most once for the rest.
+	{
+		std::lock_guard<std::mutex> lock(entitiesMutex);
+
+		size_t numReused = std::min(count, freeEntities.size());
+		for (size_t i = 0; i < numReused; i++)
+		{
+			uint32_t index = freeEntities.back();
+			freeEntities.pop_back();
+			handles[i] = EntityHandle(index, entities[index].generation);
+		}
+
+		// Generation 0 is reserved for null handles
+		EntityInternal slot;
+		slot.archetype = nullptr;
+		slot.row = 0;
+		slot.generation = 1;
+
+		size_t first = entities.size() + numReservedEntities;
+		entities.resize(first + (count - numReused), slot);
+		numReservedEntities = 0;
+
+		for (size_t i = numReused; i < count; i++)
+		{
+			handles[i] = EntityHandle((uint32_t)(first + i - numReused), 1);
+		}
+	}
+
+	// Add a row for every entity; they are next to each other in the archetype
+	unsigned int firstRow = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		EntityInternal& entity = HandleToEntity(handles[i]);
+		entity.archetype = archetype;
+		entity.row = archetype->AddRow(handles[i]);
+
+		if (i == 0)
+		{
+			firstRow = entity.row;
+		}
+	}
+
+	// Every component of a new entity counts as changed
+	uint32_t tick = changeTick;
+
+	// Construct the components one component type at a time, so that every column is filled in
+	// order
+	for (size_t i = 0; i < numberOfComponents; i++)
+	{
+		unsigned int column = (unsigned int)archetype->GetColumn(componentIDs[i]);
+
+		for (size_t j = 0; j < count; j++)
+		{
+			archetype->ConstructComponent(firstRow + (unsigned int)j, column, handles[j],
+				prototypeComponents[i]);
+			archetype->MarkChanged(firstRow + (unsigned int)j, column, tick);
+		}
+	}
+
+	// Now that the entities are created, dispatch a single make entity event for all of them
+	NotifyMakeEntities(archetype, handles, count);
+
+	return true;
+}
+
+void ECS::Reserve(size_t count, const unsigned int* componentIDs, size_t numberOfComponents)
+{
+	if (!ValidateComponentTypes(componentIDs, numberOfComponents))
+	{
+		return;
+	}
+
+	ECSArchetype* archetype = FindOrCreateArchetype(componentTypesStorage);
+	archetype->Reserve(count);
+
+	// Slots in the entity table are shared by all entities; make room for the entities which do
+	// not exist yet
+	if (count > archetype->size())
+	{
+		std::lock_guard<std::mutex> lock(entitiesMutex);
+		entities.reserve(entities.size() + numReservedEntities + (count - archetype->size()));
+	}
+}
+
+void ECS::NotifyMakeEntities(ECSArchetype* archetype, const EntityHandle* handles, size_t count)
+{
+	// The archetype knows which listeners are interested in it's entities
+	// The list is looked up every iteration, since listeners may add listeners
+	for (size_t i = 0; i < archetype->GetEntityListeners().size(); i++)
+	{
+		ECSListener* listener = archetype->GetEntityListeners()[i];
+
+		if (count == 1)
+		{
+			listener->OnMakeEntity(handles[0]);
+		}
+		else
+		{
+			listener->OnMakeEntities(handles, count);
+		}
+	}
+}
+
+void ECS::RemoveEntity(EntityHandle handle)
+{
+	// The entity has already been removed
+	if (!IsValid(handle))
+	{
+		std::cerr << "Attempted to remove an entity which does not exist." << std::endl;
+		return;
+	}
+
+	// Before removing the entity, dispatch the remove entity event to all listeners
+	// in the ECS which are interested in the entity's archetype
+	ECSArchetype* archetype = HandleToEntity(handle).archetype;
+
+	for (size_t i = 0; i < archetype->GetEntityListeners().size(); i++)
+	{
+		archetype->GetEntityListeners()[i]->OnRemoveEntity(handle);
+	}
+
+	// Proceed with removing the entity...
+
+	EntityInternal& entity = HandleToEntity(handle);
+
+	// Free all components attached to the entity and remove it's row from the archetype
+	// Another entity may be moved into the removed row; if so, update the row of that entity
+	EntityHandle movedEntity = entity.archetype->RemoveRow(entity.row, true);
+	if (movedEntity != nullptr)
+	{
+		HandleToEntity(movedEntity).row = entity.row;
+	}
+
+	// All components are gone; the entity's slot can now be freed
+	ReleaseEntity(handle.index);
+}
+
+void ECS::UpdateSystems(ECSSystemList& systems, float deltaTime)
+{
+	// Iterate over all systems in the system list
+	for (unsigned int i = 0; i < systems.size(); i++)
+	{
+		UpdateSystem(*systems[i], deltaTime, nullptr);
+	}
+
+	// Sync point; apply every change recorded by the systems
+	ClampChangeTicks();
+	PlaybackCommandBuffers();
+}
+
+void ECS::UpdateSystems(ECSSystemList& systems, float deltaTime, ECSThreadPool& threadPool)
+{
+	// Find the queries of all systems up front, since queries cannot be created while systems
+	// are being updated on multiple threads
+	for (unsigned int i = 0; i < systems.size(); i++)
+	{
+		FindOrCreateQuery(systems[i]->GetRequiredComponentTypes());
+	}
+
+	// Iterate over all phases of the schedule
+	// Systems in the same phase do not conflict with each other, and can be updated at the same
+	// time. Every phase must be finished before the next one starts.
+	for (const std::vector<unsigned int>& phase : systems.GetSchedule())
+	{
+		ECSTaskGroup group;
+
+		for (unsigned int index : phase)
+		{
+			BaseECSSystem* system = systems[index];
+
+			// Systems which must be updated on this thread are updated after submitting the
+			// rest of the phase to the thread pool
+			if (system->IsMainThreadOnly())
+			{
+				continue;
+			}
+
+			threadPool.Submit(group, [this, system, deltaTime, &threadPool]()
+			{
+				UpdateSystem(*system, deltaTime, &threadPool);
+			});
+		}
+
+		for (unsigned int index : phase)
+		{
+			if (systems[index]->IsMainThreadOnly())
+			{
+				UpdateSystem(*systems[index], deltaTime, &threadPool);
+			}
+		}
+
+		threadPool.Wait(group);
+	}
+
+	// Sync point; apply every change recorded by the systems
+	ClampChangeTicks();
+	PlaybackCommandBuffers();
+}
+
+ECSCommandBuffer& ECS::GetCommandBuffer()
+{
+	std::lock_guard<std::mutex> lock(commandBuffersMutex);
+
+	ECSCommandBuffer*& commandBuffer = commandBuffers[std::this_thread::get_id()];
+	if (commandBuffer == nullptr)
+	{
+		commandBuffer = new ECSCommandBuffer(*this);
+	}
+
+	return *commandBuffer;
+}
+
+void ECS::PlaybackCommandBuffers()
+{
+	// The commands and components of a command buffer, taken out of it before playing them back.
+	// Playing back a command may notify listeners which record more commands, which would move the
+	// command buffer's arrays while they are being played back.
+	struct TakenCommands
+	{
+		ECSCommandBuffer* commandBuffer;
+		std::vector<ECSCommandBuffer::Command> commands;
+		std::vector<std::pair<unsigned int, BaseECSComponent*>> components;
+	};
+
+	// A command along with the commands taken from the command buffer which recorded it
+	typedef std::pair<const TakenCommands*, const ECSCommandBuffer::Command*> RecordedCommand;
+
+	std::vector<TakenCommands> takenCommands;
+	std::vector<RecordedCommand> recordedCommands;
+
+	// Commands recorded while playing back are played back as well, in another round, until no
+	// command buffer has commands left
+	while (true)
+	{
+		takenCommands.clear();
+		recordedCommands.clear();
+
+		for (auto& commandBuffer : commandBuffers)
+		{
+			if (!commandBuffer.second->commands.empty())
+			{
+				TakenCommands& taken = takenCommands.emplace_back();
+				taken.commandBuffer = commandBuffer.second;
+				taken.commands.swap(commandBuffer.second->commands);
+				taken.components.swap(commandBuffer.second->components);
+			}
+		}
+
+		// Every array is taken before any pointers into them are kept
+		for (const TakenCommands& taken : takenCommands)
+		{
+			for (const ECSCommandBuffer::Command& command : taken.commands)
+			{
+				recordedCommands.emplace_back(&taken, &command);
+			}
+		}
+
+		if (recordedCommands.empty())
+		{
+			break;
+		}
+
+		// Add every slot reserved by the command buffers to the entity table
+		{
+			std::lock_guard<std::mutex> lock(entitiesMutex);
+
+			EntityInternal slot;
+			slot.archetype = nullptr;
+			slot.row = 0;
+			slot.generation = 1;
+			entities.resize(entities.size() + numReservedEntities, slot);
+			numReservedEntities = 0;
+		}
+
+		// Compares the component types of two commands making entities
+		auto compareComponentTypes = [](const RecordedCommand& a, const RecordedCommand& b)
+		{
+			auto aBegin = a.first->components.begin() + a.second->firstComponent;
+			auto bBegin = b.first->components.begin() + b.second->firstComponent;
+
+			return std::lexicographical_compare(aBegin, aBegin + a.second->numComponents, bBegin,
+				bBegin + b.second->numComponents,
+				[](const std::pair<unsigned int, BaseECSComponent*>& x,
+					const std::pair<unsigned int, BaseECSComponent*>& y)
+			{
+				return x.first < y.first;
+			});
+		};
+
+		// Sort the commands so that entities are made first, grouped by component types, then
+		// components are added and removed, grouped by entity, and entities are removed last.
+		// The sort is stable, so commands affecting the same entity stay in the order they were
+		// recorded.
+		std::stable_sort(recordedCommands.begin(), recordedCommands.end(),
+			[&compareComponentTypes](const RecordedCommand& a, const RecordedCommand& b)
+		{
+			int aOrder = a.second->type == ECSCommandBuffer::Command::MAKE_ENTITY ? 0 :
+				a.second->type == ECSCommandBuffer::Command::REMOVE_ENTITY ? 2 : 1;
+			int bOrder = b.second->type == ECSCommandBuffer::Command::MAKE_ENTITY ? 0 :
+				b.second->type == ECSCommandBuffer::Command::REMOVE_ENTITY ? 2 : 1;
+
+			if (aOrder != bOrder)
+			{
+				return aOrder < bOrder;
+			}
+
+			if (aOrder == 0)
+			{
+				return compareComponentTypes(a, b);
+			}
+
+			return a.second->entity.index < b.second->entity.index;
+		});
+
+		// Used for storing the components of an entity being made
+		std::vector<BaseECSComponent*> entityComponents;
+		std::vector<unsigned int> componentIDs;
+
+		// The archetype of the previous entity made; entities with the same component types are
+		// next to each other, so the archetype only needs to be found once per group
+		ECSArchetype* archetype = nullptr;
+		const RecordedCommand* previousMake = nullptr;
+
+		for (const RecordedCommand& recordedCommand : recordedCommands)
+		{
+			const TakenCommands& taken = *recordedCommand.first;
+			const ECSCommandBuffer::Command& command = *recordedCommand.second;
+
+			switch (command.type)
+			{
+			case ECSCommandBuffer::Command::MAKE_ENTITY:
+			{
+				entityComponents.clear();
+				componentIDs.clear();
+
+				for (unsigned int i = 0; i < command.numComponents; i++)
+				{
+					auto& component = taken.components[command.firstComponent + i];
+					componentIDs.push_back(component.first);
+					entityComponents.push_back(component.second);
+				}
+
+				// Find the archetype if the component types differ from those of the previous
+				// entity
+				if (previousMake == nullptr ||
+					compareComponentTypes(*previousMake, recordedCommand))
+				{
+					if (!ValidateComponentTypes(componentIDs.data(), componentIDs.size()))
+					{
+						// The reserved slot is never used; free it
+						ReleaseEntity(command.entity.index);
+						previousMake = nullptr;
+						break;
+					}
+
+					archetype = FindOrCreateArchetype(componentTypesStorage);
+					previousMake = &recordedCommand;
+				}
+
+				ConstructEntity(command.entity, archetype, entityComponents.data(),
+					componentIDs.data(), componentIDs.size());
+				break;
+			}
+			case ECSCommandBuffer::Command::ADD_COMPONENT:
+			{
+				auto& component = taken.components[command.firstComponent];
+				AddComponentByType(command.entity, component.first, component.second);
+				break;
+			}
+			case ECSCommandBuffer::Command::REMOVE_COMPONENT:
+				RemoveComponentByType(command.entity, command.componentID);
+				break;
+			case ECSCommandBuffer::Command::REMOVE_ENTITY:
+				// The entity may have been removed more than once
+				if (IsValid(command.entity))
+				{
+					RemoveEntity(command.entity);
+				}
+				break;
+			}
+		}
+
+		// Free the copies of the components; the memory they were copied into is kept until
+		// every round has been played back, since commands recorded since are stored there too
+		for (TakenCommands& taken : takenCommands)
+		{
+			for (const auto& component : taken.components)
+			{
+				BaseECSComponent::GetTypeFreeFunction(component.first)(component.second);
+			}
+
+			// Give the arrays back, so that the command buffer keeps their capacity
+			taken.commands.clear();
+			taken.components.clear();
+			if (taken.commandBuffer->commands.empty())
+			{
+				taken.commandBuffer->commands.swap(taken.commands);
+				taken.commandBuffer->components.swap(taken.components);
+			}
+		}
+	}
+
+	// Keep the memory for the next commands
+	for (auto& commandBuffer : commandBuffers)
+	{
+		commandBuffer.second->Clear();
+	}
+}
+
+void ECS::Snapshot(ECSSnapshot& snapshot, const ECSSnapshot* previous)
+{
+	if (&snapshot == previous)
+	{
+		std::cerr << "Attempted to take a snapshot relative to itself." << std::endl;
+		return;
+	}
+
+	// A previous snapshot which was never taken has nothing to share
+	if (previous != nullptr && previous->IsEmpty())
+	{
+		previous = nullptr;
+	}
+
+	snapshot.Clear();
+
+	// Every change made after the snapshot is marked with a later tick
+	snapshot.tick = AdvanceChangeTick();
+	snapshot.isTaken = true;
+
+	snapshot.entities.resize(entities.size());
+	for (size_t i = 0; i < entities.size(); i++)
+	{
+		snapshot.entities[i].archetype = entities[i].archetype;
+		snapshot.entities[i].row = entities[i].row;
+		snapshot.entities[i].generation = entities[i].generation;
+	}
+	snapshot.freeEntities = freeEntities;
+
+	snapshot.archetypes.resize(archetypes.size());
+	for (size_t i = 0; i < archetypes.size(); i++)
+	{
+		ECSArchetype& archetype = *archetypes[i];
+		ECSSnapshot::ArchetypeCopy& archetypeCopy = snapshot.archetypes[i];
+
+		archetypeCopy.numEntities = archetype.size();
+
+		// The archetype of the same index in the previous snapshot is the same archetype, since
+		// archetypes are never deleted
+		const ECSSnapshot::ArchetypeCopy* previousCopy = nullptr;
+		if (previous != nullptr && i < previous->archetypes.size())
+		{
+			previousCopy = &previous->archetypes[i];
+		}
+
+		// Only the chunks storing entities are copied
+		size_t numChunks = (archetype.size() + archetype.GetChunkCapacity() - 1) /
+			archetype.GetChunkCapacity();
+
+		for (size_t chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+		{
+			const ECSChunk& chunk = archetype.GetChunk(chunkIndex);
+
+			// The chunk is unchanged if it stores the same rows as when the previous snapshot
+			// was taken, and no component of it has been changed since
+			if (previousCopy != nullptr && chunkIndex < previousCopy->chunks.size() &&
+				previousCopy->chunks[chunkIndex]->version == chunk.version)
+			{
+				const uint32_t* columnTicks = archetype.GetColumnChangeTicks(chunk);
+				bool isChanged = false;
+
+				for (unsigned int column = 0; column < archetype.GetComponentTypes().size(); column++)
+				{
+					if (ECSIsTickNewer(columnTicks[column], previous->tick))
+					{
+						isChanged = true;
+						break;
+					}
+				}
+
+				if (!isChanged)
+				{
+					archetypeCopy.chunks.push_back(previousCopy->chunks[chunkIndex]);
+					continue;
+				}
+			}
+
+			archetypeCopy.chunks.push_back(
+				std::make_shared<ECSSnapshot::ChunkCopy>(archetype, chunkIndex));
+		}
+	}
+}
+
+bool ECS::Restore(const ECSSnapshot& snapshot)
+{
+	if (snapshot.IsEmpty())
+	{
+		std::cerr << "Attempted to restore a snapshot which has not been taken." << std::endl;
+		return false;
+	}
+
+	if (snapshot.archetypes.size() > archetypes.size())
+	{
+		std::cerr << "Attempted to restore a snapshot taken from another ECS." << std::endl;
+		return false;
+	}
+
+	// Recorded commands refer to entity handles which the snapshot knows nothing about
+	{
+		std::lock_guard<std::mutex> lock(commandBuffersMutex);
+
+		for (auto& commandBuffer : commandBuffers)
+		{
+			if (!commandBuffer.second->IsEmpty())
+			{
+				std::cerr << "Attempted to restore a snapshot before playing back command buffers."
+					<< std::endl;
+				return false;
+			}
+		}
+	}
+
+	if (numReservedEntities > 0)
+	{
+		std::cerr << "Attempted to restore a snapshot while entities are reserved." << std::endl;
+		return false;
+	}
+
+	// Dispatch the remove entity event for every current entity, then remove them all at once
+	for (uint32_t i = 0; i < entities.size(); i++)
+	{
+		ECSArchetype* archetype = entities[i].archetype;
+		if (archetype == nullptr)
+		{
+			continue;
+		}
+
+		for (size_t j = 0; j < archetype->GetEntityListeners().size(); j++)
+		{
+			archetype->GetEntityListeners()[j]->OnRemoveEntity(
+				EntityHandle(i, entities[i].generation));
+		}
+	}
+
+	for (ECSArchetype* archetype : archetypes)
 	{
-		// The first element of the pair is the component type ID
-		// The second element of the pair is the arbitrary memory for the component type
+		archetype->Clear();
+	}
+
+	// Restored components count as changed, so that systems only processing changed components
+	// see the restored state
+	uint32_t tick = changeTick;
 
-		// Find the memory size of the component type
-		size_t typeSize = BaseECSComponent::GetTypeSize(it->first);
+	for (size_t i = 0; i < snapshot.archetypes.size(); i++)
+	{
+		ECSArchetype* archetype = archetypes[i];
+		const ECSSnapshot::ArchetypeCopy& archetypeCopy = snapshot.archetypes[i];
 
-		// Get the component free function, which defines how to free the component at runtime
-		ECSComponentFreeFunction freeFunction = BaseECSComponent::GetTypeFreeFunction(it->first);
+		archetype->Reserve(archetypeCopy.numEntities);
 
-		// Iterate through the memory of the component
-		// Increment by type size; every component of the same type has the same size
-		// This has the result of iterating over every single component
-		for (unsigned int i = 0; i < it->second.size(); i+= typeSize)
+		for (const std::shared_ptr<ECSSnapshot::ChunkCopy>& chunkCopy : archetypeCopy.chunks)
 		{
-			// Call the free function on each component
-			// Casting to BaseECSComponent is safe; all components inherit from BaseECSComponent
-			freeFunction((BaseECSComponent*)&it->second[i]);
+			unsigned int firstRow = archetype->AppendChunk(chunkCopy->memory, chunkCopy->size);
+
+			// Copy construct every component which could not be restored by the block copy
+			for (const ECSSnapshot::ChunkCopy::DeepColumn& deepColumn : chunkCopy->deepColumns)
+			{
+				size_t componentSize = BaseECSComponent::GetTypeSize(deepColumn.componentID);
+
+				for (unsigned int row = 0; row < chunkCopy->size; row++)
+				{
+					BaseECSComponent* component =
+						(BaseECSComponent*)(deepColumn.components + row * componentSize);
+					archetype->ConstructComponent(firstRow + row, deepColumn.column,
+						component->entity, component);
+				}
+			}
+
+			const ECSChunk& chunk = archetype->GetChunk(firstRow / archetype->GetChunkCapacity());
+			for (unsigned int column = 0; column < archetype->GetComponentTypes().size(); column++)
+			{
+				archetype->MarkChanged(chunk, column, 0, chunk.size, tick);
+			}
 		}
 	}
 
-	// Iterate over all entities and delete them
-	for (auto& entity : entities)
+	// Restore the entity table. Slots of entities made after the snapshot are dropped or freed,
+	// and entities made again afterwards get the same handles as they did the first time.
+	entities.resize(snapshot.entities.size());
+	for (size_t i = 0; i < entities.size(); i++)
 	{
-		delete entity;
+		entities[i].archetype = snapshot.entities[i].archetype;
+		entities[i].row = snapshot.entities[i].row;
+		entities[i].generation = snapshot.entities[i].generation;
 	}
-}
-
-EntityHandle ECS::MakeEntity(BaseECSComponent** entityComponents, const unsigned int* componentIDs,
-	size_t numberOfComponents)
-{
-	// Initialize a new entity
-	std::pair<unsigned int, std::vector<std::pair<unsigned int, unsigned int>>>* newEntity =
-		new std::pair<unsigned int, std::vector<std::pair<unsigned int, unsigned int>>>();
-
-	// Create an entity handle for the new entity
-	EntityHandle handle = (EntityHandle)newEntity;
+	freeEntities = snapshot.freeEntities;
 
-	// Iterate over all components specified and add them to the new entity
-	for (unsigned int i = 0; i < numberOfComponents; i++)
+	// Dispatch the make entity event for every restored entity, once per archetype
+	std::vector<EntityHandle> handles;
+	for (size_t i = 0; i < snapshot.archetypes.size(); i++)
 	{
-		// Check if componentID is actually valid
-		if (!BaseECSComponent::IsTypeValid(componentIDs[i]))
+		ECSArchetype* archetype = archetypes[i];
+		if (archetype->size() == 0)
+		{
+			continue;
+		}
+
+		handles.resize(archetype->size());
+		for (unsigned int row = 0; row < archetype->size(); row++)
 		{
-			std::cerr << "'" << componentIDs[i] << "' is not a valid component type." << std::endl;
-			// Abort; delete the new entity and return a null entity handle
-			delete newEntity;
-			return nullptr;
+			handles[row] = archetype->GetEntity(row);
 		}
 
-		AddComponentInternal(handle, newEntity->second, componentIDs[i], entityComponents[i]);
+		NotifyMakeEntities(archetype, handles.data(), handles.size());
 	}
 
-	// The first element of the entity pair is it's index in the entities vector/array
-	// See declaration of entities for more info
-	newEntity->first = entities.size();
+	return true;
+}
 
-	// Add the new entity to the entities vector/array
-	entities.push_back(newEntity);
+ECSStats ECS::GetStats(const std::vector<ECSSystemList*>& systemLists)
+{
+	ECSStats stats;
+	stats.entityTableSize = entities.size();
+	stats.entityTableCapacity = entities.capacity();
 
-	// Now that the entity is created, dispatch the make entity event to all listeners
-	// in the ECS...
+	// Index corresponds to component ID; component types are added to the stats once they are
+	// found in an archetype
+	std::vector<ECSComponentTypeStats> componentTypeStats(BaseECSComponent::GetNumTypes());
+	std::vector<bool> isComponentTypeStored(componentTypeStats.size(), false);
 
-	std::vector<std::pair<unsigned int, unsigned int>>& entity = HandleToEntity(handle);
+	for (ECSArchetype* archetype : archetypes)
+	{
+		ECSArchetypeStats archetypeStats;
+		archetypeStats.componentTypes = archetype->GetComponentTypes();
+		archetypeStats.numEntities = archetype->size();
+		stats.numEntities += archetype->size();
+		archetypeStats.numChunks = archetype->GetNumChunks();
+		archetypeStats.chunkCapacity = archetype->GetChunkCapacity();
+		archetypeStats.bytesReserved = archetype->GetNumChunks() * archetype->GetChunkMemorySize();
+
+		stats.bytesReserved += archetypeStats.bytesReserved;
+		stats.archetypes.push_back(archetypeStats);
+
+		// The number of rows allocated across every chunk of the archetype, including unused ones
+		size_t numRows = archetype->GetNumChunks() * archetype->GetChunkCapacity();
+
+		const std::vector<unsigned int>& componentTypes = archetype->GetComponentTypes();
+		for (unsigned int column = 0; column < componentTypes.size(); column++)
+		{
+			unsigned int componentID = componentTypes[column];
+			ECSComponentTypeStats& typeStats = componentTypeStats[componentID];
+			isComponentTypeStored[componentID] = true;
+
+			// Every row of a column stores the component, or a pointer to it if the column is
+			// pooled, along with it's change tick
+			size_t rowSize = sizeof(uint32_t) + (archetype->IsColumnPooled(column) ?
+				sizeof(void*) : BaseECSComponent::GetTypeSize(componentID));
+			size_t componentSize = rowSize + (archetype->IsColumnPooled(column) ?
+				BaseECSComponent::GetTypeSize(componentID) : 0);
+
+			typeStats.numComponents += archetype->size();
+			typeStats.bytesUsed += archetype->size() * componentSize;
+			typeStats.bytesReserved += numRows * rowSize;
+			typeStats.numAllocations += archetype->GetNumChunks();
+		}
+	}
 
-	// Iterate over all listeners
-	for (unsigned int i = 0; i < listeners.size(); i++)
+	// Slots which are neither free nor storing an entity were reserved by a command buffer, as
+	// were the slots reserved past the end of the table
+	stats.numReservedEntities = entities.size() - freeEntities.size() - stats.numEntities +
+		numReservedEntities;
+
+	for (unsigned int componentID = 0; componentID < componentTypeStats.size(); componentID++)
 	{
-		// Get the component types which the listener is interested in
-		const std::vector<unsigned int>& listenerComponentIDs = listeners[i]->GetComponentIDs();
-		bool isValid = true;
+		if (!isComponentTypeStored[componentID])
+		{
+			continue;
+		}
 
-		// If the listener is interested in all entity operations, dispatch the event regardless
-		// of whether or not the listener is interested in the entity's component types
-		if (listeners[i]->ShouldNotifyOnAllEntityOperations())
+		ECSComponentTypeStats& typeStats = componentTypeStats[componentID];
+		typeStats.componentID = componentID;
+		typeStats.name = BaseECSComponent::GetTypeName(componentID);
+
+		// Pooled components take up memory in the pages of the pool as well
+		if (componentID < componentPools.size() && componentPools[componentID] != nullptr)
 		{
-			listeners[i]->OnMakeEntity(handle);
+			ECSComponentPool* pool = componentPools[componentID];
+			typeStats.bytesReserved += pool->GetMemorySize();
+			typeStats.numAllocations += pool->GetNumPages();
+
+			stats.bytesReserved += pool->GetMemorySize();
 		}
-		// Otherwise, check if the entity contains all component types which the listener is
-		// interested in
-		else
+
+		stats.componentTypes.push_back(typeStats);
+	}
+
+	for (ECSSystemList* systems : systemLists)
+	{
+		for (unsigned int i = 0; i < systems->size(); i++)
 		{
-			// Iterate over all component types the listener is interested in
-			for (unsigned int j = 0; j < listenerComponentIDs.size(); j++)
-			{
-				bool hasComponent = false;
-				// Iterate over all components in the entity
-				for (unsigned int k = 0; k < numberOfComponents; k++)
-				{
-					// If the component type is the component type which the listener is
-					// interested in
-					if (listeners[i]->GetComponentIDs()[j] == componentIDs[k])
-					{
-						// The entity has this particular component
-						hasComponent = true;
-						// Stop searching
-						break;
-					}
-				}
-				// If the entity does not have this component type, it does not have all component
-				// types which the listener is interested in
-				if (!hasComponent)
-				{
-					isValid = false;
-					// Stop searching; the entity can no longer be valid
-					break;
-				}
-			}
-			// If the entity has all component types which the listener is interested in
-			if (isValid)
-			{
-				// Dispatch the event
-				listeners[i]->OnMakeEntity(handle);
-			}
+			BaseECSSystem* system = (*systems)[i];
+
+			ECSSystemStats systemStats;
+			systemStats.name = ECSDemangleTypeName(typeid(*system).name());
+			systemStats.numMatchedEntities = system->GetNumMatchedEntities();
+			systemStats.lastUpdateTime = system->GetLastUpdateTime();
+			systemStats.lastRunTick = system->GetLastRunTick();
+
+			stats.systems.push_back(systemStats);
 		}
 	}
 
-	return handle;
+	return stats;
 }
 
-void ECS::RemoveEntity(EntityHandle handle)
+ECSQuery& ECS::GetQuery(std::vector<unsigned int> componentTypes)
 {
-	std::vector<std::pair<unsigned int, unsigned int>>& entity = HandleToEntity(handle);
+	std::sort(componentTypes.begin(), componentTypes.end());
+	componentTypes.erase(std::unique(componentTypes.begin(), componentTypes.end()),
+		componentTypes.end());
 
-	// Before removing the entity, dispatch the remove entity event to all listeners
-	// in the ECS...
+	return *FindOrCreateQuery(componentTypes);
+}
 
-	// Iterate over all listeners
-	for (unsigned int i = 0; i < listeners.size(); i++)
+void ECS::ClampChangeTicks()
+{
+	const uint32_t tick = changeTick;
+	if (tick - lastClampTick < CLAMP_CHANGE_TICKS_INTERVAL)
 	{
-		// Get the component types which the listener is interested in
-		const std::vector<unsigned int>& listenerComponentIDs = listeners[i]->GetComponentIDs();
-		bool isValid = true;
+		return;
+	}
 
-		// If the listener is interested in all entity operations, dispatch the event regardless
-		// of whether or not the listener is interested in the entity's component types
-		if (listeners[i]->ShouldNotifyOnAllEntityOperations())
+	lastClampTick = tick;
+
+	// Ticks older than the oldest tick are all treated the same; changed before any system or
+	// snapshot could have last looked at them
+	const uint32_t oldestTick = tick - MAX_CHANGE_TICK_AGE;
+	auto clamp = [oldestTick](uint32_t& tickToClamp)
+	{
+		if (!ECSIsTickNewer(tickToClamp, oldestTick))
 		{
-			listeners[i]->OnRemoveEntity(handle);
+			tickToClamp = oldestTick;
 		}
-		// Otherwise, check if the entity contains all component types which the listener is
-		// interested in
-		else
+	};
+
+	for (ECSArchetype* archetype : archetypes)
+	{
+		const unsigned int numColumns = (unsigned int)archetype->GetComponentTypes().size();
+
+		for (size_t i = 0; i < archetype->GetNumChunks(); i++)
 		{
-			// Iterate over all component types the listener is interested in
-			for (unsigned int j = 0; j < listenerComponentIDs.size(); j++)
+			const ECSChunk& chunk = archetype->GetChunk(i);
+
+			for (unsigned int column = 0; column < numColumns; column++)
 			{
-				bool hasComponent = false;
-				// Iterate over all components in the entity
-				for (unsigned int k = 0; k < entity.size(); k++)
-				{
-					// If the component type is the component type which the listener is
-					// interested in
-					if (listenerComponentIDs[j] == entity[k].first)
-					{
-						// The entity has this particular component
-						hasComponent = true;
-						// Stop searching
-						break;
-					}
-				}
-				// If the entity does not have this component type, it does not have all component
-				// types which the listener is interested in
-				if (!hasComponent)
+				clamp(archetype->GetColumnChangeTicks(chunk)[column]);
+
+				uint32_t* changeTicks = archetype->GetChangeTicks(chunk, column);
+				for (unsigned int row = 0; row < chunk.size; row++)
 				{
-					isValid = false;
-					// Stop searching; the entity can no longer be valid
-					break;
+					clamp(changeTicks[row]);
 				}
 			}
-			// If the entity has all component types which the listener is interested in
-			if (isValid)
-			{
-				// Dispatch the event
-				listeners[i]->OnRemoveEntity(handle);
-			}
 		}
 	}
+}
 
-	// Proceed with removing the entity...
+void ECS::UpdateSystem(BaseECSSystem& system, float deltaTime, ECSThreadPool* threadPool)
+{
+	// Measures how long the update takes, including waiting for other threads
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
 
-	// Make sure all components attached to the entity are deleted
-	for (unsigned int i = 0; i < entity.size(); i++)
+	// The archetypes which have every non-optional component type of the system
+	ECSQuery* query = FindOrCreateQuery(system.GetRequiredComponentTypes());
+	const std::vector<ECSArchetype*>& queryArchetypes = query->GetArchetypes();
+
+	// Counted before updating, since the system may make or remove entities
+	system.numMatchedEntities = 0;
+	for (ECSArchetype* archetype : queryArchetypes)
 	{
-		DeleteComponent(entity[i].first, entity[i].second);
+		system.numMatchedEntities += archetype->size();
 	}
 
-	// All components are gone; the entity can now be safely removed from the entities list...
-	//
-	// The naive way of removing the entity would be to remove it from the vector/array and
-	// to adjust it accordingly.
-	//
-	// However, because the order of the entities list is irrelevant, we can move the
-	// entity at the end of the list to the index of the entity being deleted. All that matters is
-	// that the entities list contains every entity. Performing this bypasses the need to shift
-	// elements of the array.
-
-	// The current index; the index of the entity being removed in the entities list
-	unsigned int destinationIndex = HandleToEntityIndex(handle);
+	// Components changed after the previous update of the system are changed for this update,
+	// and components the system changes are marked with a new tick
+	uint32_t tick = AdvanceChangeTick();
 
-	// The index of the last entity in the entities list
-	unsigned int sourceIndex = entities.size() - 1;
-
-	// Delete the entity being removed
-	delete entities[destinationIndex];
-
-	// Copy the last entity in the list to where the entity being deleted is
-	entities[destinationIndex] = entities[sourceIndex];
-	
-	// Update the index of the entity in the array
-	entities[destinationIndex]->first = destinationIndex;
-
-	// Remove the last element of the entities list
-	entities.pop_back();
-}
+	// A system which has never been updated, or not for longer than the age of the oldest change
+	// tick, treats every component as changed
+	uint32_t lastRunTick = system.lastRunTick;
+	// Change ticks are at most the age plus the clamping interval old, so a tick just before that
+	// is earlier than every change tick
+	if (!system.hasRun || !ECSIsTickNewer(lastRunTick, tick - MAX_CHANGE_TICK_AGE))
+	{
+		lastRunTick = tick - MAX_CHANGE_TICK_AGE - CLAMP_CHANGE_TICKS_INTERVAL - 1;
+	}
 
-void ECS::UpdateSystems(ECSSystemList& systems, float deltaTime)
-{
 	// Created in advance to avoid repeatedly allocating and deallocating for every
-	// single system updated; passed in by reference to UpdateSystemWithMultipleComponents
-	std::vector<BaseECSComponent*> componentStorage;
-	std::vector<std::vector<unsigned char>*> componentArrays;
+	// single chunk updated; passed in by reference to UpdateSystemWithChunk
+	std::vector<ECSComponentSpan> componentStorage;
 
-	// Iterate over all systems in the system list
-	for (unsigned int i = 0; i < systems.size(); i++)
+	// If the system is not parallel, iterate over all archetypes of the query, and update the
+	// system with the entities of each of them. Note that a system with a single component type
+	// is simply a special case of this.
+	if (threadPool == nullptr || !system.IsParallel())
 	{
-		const std::vector<unsigned int>& componentTypes = systems[i]->GetComponentTypes();
-
-		// If the system has only one component type
-		if (componentTypes.size() == 1)
+		// The number of archetypes and chunks is checked every iteration; the system may create
+		// entities, which may create archetypes
+		for (size_t i = 0; i < queryArchetypes.size(); i++)
 		{
-			// Find the memory size of the component type
-			size_t typeSize = BaseECSComponent::GetTypeSize(componentTypes[0]);
-
-			// Get the component type's memory array by reference
-			std::vector<unsigned char>& array = components[componentTypes[0]];
+			ECSArchetype* archetype = queryArchetypes[i];
 
-			// Iterate through the memory of the component
-			// Increment by type size; every component of the same type has the same size
-			// This has the result of iterating over every single component
-			for (unsigned int j = 0; j < array.size(); j += typeSize)
+			// Iterate over all chunks of the archetype
+			for (size_t j = 0; j < archetype->GetNumChunks(); j++)
 			{
-				// Casting to BaseECSComponent is safe; all components inherit from BaseECSComponent
-				BaseECSComponent* component = (BaseECSComponent*)&array[j];
-
-				// Update the component
-				systems[i]->UpdateComponents(deltaTime, &component);
+				UpdateSystemWithChunk(system, *archetype, archetype->GetChunk(j), deltaTime,
+					componentStorage, lastRunTick, tick);
 			}
 		}
-		else
+	}
+	// Otherwise, gather every chunk the system is working with, and split them up between the
+	// threads of the thread pool. A chunk is the smallest unit of work.
+	else
+	{
+		std::vector<std::pair<ECSArchetype*, ECSChunk*>> chunks;
+
+		for (ECSArchetype* archetype : queryArchetypes)
 		{
-			// Handle the more difficult case of updating a system with multiple components
-			UpdateSystemWithMultipleComponents(i, systems, deltaTime, componentTypes,
-				componentStorage, componentArrays);
+			for (size_t j = 0; j < archetype->GetNumChunks(); j++)
+			{
+				if (archetype->GetChunk(j).size > 0)
+				{
+					chunks.emplace_back(archetype, &archetype->GetChunk(j));
+				}
+			}
 		}
+
+		threadPool->ParallelFor(chunks.size(), 0, [this, &system, &chunks, deltaTime, lastRunTick,
+			tick](size_t begin, size_t end)
+		{
+			// Every range needs it's own storage
+			std::vector<ECSComponentSpan> rangeComponentStorage;
+
+			for (size_t i = begin; i < end; i++)
+			{
+				UpdateSystemWithChunk(system, *chunks[i].first, *chunks[i].second, deltaTime,
+					rangeComponentStorage, lastRunTick, tick);
+			}
+		});
 	}
+
+	system.lastRunTick = tick;
+	system.hasRun = true;
+	system.lastUpdateTime = std::chrono::duration<float>(std::chrono::steady_clock::now() -
+		startTime).count();
 }
 
-void ECS::UpdateSystemWithMultipleComponents(unsigned int index, ECSSystemList& systems,
-	float deltaTime, const std::vector<unsigned int>& componentTypes,
-	std::vector<BaseECSComponent*>& componentStorage,
-	std::vector<std::vector<unsigned char>*>& componentArrays)
+void ECS::UpdateSystemWithChunk(BaseECSSystem& system, ECSArchetype& archetype, ECSChunk& chunk,
+	float deltaTime, std::vector<ECSComponentSpan>& componentStorage, uint32_t lastRunTick,
+	uint32_t tick)
 {
-	const std::vector<unsigned int>& componentFlags = systems[index]->GetComponentFlags();
+	const std::vector<unsigned int>& componentTypes = system.GetComponentTypes();
+	const std::vector<unsigned int>& componentFlags = system.GetComponentFlags();
+
+	// Empty chunks have nothing to update
+	if (chunk.size == 0)
+	{
+		return;
+	}
 
-	// If the arrays are not large enough for all component types, resize them to the number of
+	// If the array is not large enough for all component types, resize it to the number of
 	// component types
 	componentStorage.resize(std::max(componentStorage.size(), componentTypes.size()));
-	componentArrays.resize(std::max(componentArrays.size(), componentTypes.size()));
 
-	// Iterate through all component types with which the system is working with
-	for (unsigned int i = 0; i < componentTypes.size(); i++)
-		// Save the location of the memory/data of the component
-		// This will reduce the number of times we have to lookup the component in the map
-		// (as we would otherwise be performing the lookup in a double for loop)
-		componentArrays[i] = &components[componentTypes[i]];
+	// If the system only processes changed components, and none of them changed anywhere in the
+	// chunk, the entire chunk can be skipped
+	const uint32_t* columnChangeTicks = archetype.GetColumnChangeTicks(chunk);
+	bool isOnlyChanged = false;
+	bool isChunkChanged = false;
 
-	// Find the least commonly occuring component type from the component types the system is 
-	// working with. This component type will be used to look up all possible entities which
-	// could have all the components with which the system is working with. Using the least 
-	// commonly occuring component will reduce the number of entities which we check.
-	unsigned int minSizeIndex = FindLeastCommonComponent(componentTypes, componentFlags);
+	// Every column of the chunk is a contiguous run of components, and row i of every column
+	// belongs to the same entity
+	// Optional component types which the archetype does not have are passed in as empty spans
+	for (unsigned int j = 0; j < componentTypes.size(); j++)
+	{
+		int column = archetype.GetColumn(componentTypes[j]);
 
-	// Find the memory size of the least common component type
-	size_t typeSize = BaseECSComponent::GetTypeSize(componentTypes[minSizeIndex]);
+		componentStorage[j] = column == -1 ? ECSComponentSpan() :
+			archetype.GetColumnSpan(chunk, column);
 
-	// Get the memory array for the component type, containing all components of that type
-	std::vector<unsigned char>& array = *componentArrays[minSizeIndex];
+		if (componentFlags[j] & BaseECSSystem::FLAG_ONLY_CHANGED)
+		{
+			isOnlyChanged = true;
+			isChunkChanged |= column != -1 &&
+				ECSIsTickNewer(columnChangeTicks[column], lastRunTick);
+		}
+	}
 
-	// Iterate through the memory of the component type
-	// Increment by type size; every component of the same type has the same size
-	// This has the result of iterating over every single component
-	for (unsigned int i = 0; i < array.size(); i += typeSize)
+	if (isOnlyChanged && !isChunkChanged)
 	{
-		// Save the component in the array
-		// The array of components will be passed into UpdateComponents if this entity contains
-		// all component types with which the system is working with
-		componentStorage[minSizeIndex] = (BaseECSComponent*)&array[i];
-
-		// Get the entity which the component at this index is attached to
-		// The entity contains all other component types attached
-		std::vector<std::pair<unsigned int, unsigned int>>& entityComponents =
-			HandleToEntity(componentStorage[minSizeIndex]->entity);
+		return;
+	}
 
-		// Check if the entity is missing one of the components the system is working with...
-		// If the entity is missing one of the components, then it should be ignored
+	// Updates the system with a run of rows of the chunk, and marks the components the system
+	// may have changed
+	auto updateRun = [&](unsigned int first, unsigned int count)
+	{
+		for (unsigned int j = 0; j < componentTypes.size(); j++)
+		{
+			componentStorage[j].Advance(first);
+		}
 
-		// Does the entity have all components
-		bool isValid = true;
+		// Call UpdateBatch on the system, once for the entire run
+		system.UpdateBatch(deltaTime, componentStorage.data(), count);
 
-		// Iterate over all components in the entity
 		for (unsigned int j = 0; j < componentTypes.size(); j++)
 		{
-			// Special case where it is already known that the component exists in this entity 
-			// because it was used to retrieve the entity
-			if (j == minSizeIndex)
+			componentStorage[j].Advance(-(std::ptrdiff_t)first);
+
+			int column = archetype.GetColumn(componentTypes[j]);
+			if (column != -1 && (componentFlags[j] & BaseECSSystem::FLAG_READ_ONLY) == 0)
 			{
-				continue;
+				archetype.MarkChanged(chunk, column, first, count, tick);
 			}
+		}
+	};
 
-			// Save the component in the array
-			componentStorage[j] = GetComponentInternal(entityComponents, *componentArrays[j],
-				componentTypes[j]);
+	if (!isOnlyChanged)
+	{
+		updateRun(0, chunk.size);
+		return;
+	}
 
-			// If GetComponentInternal returned nullptr, then the component was not found in
-			// the entity
-			// If the component type is not optional in this system, then this entity is not valid
-			// and should be ignored
-			if (componentStorage[j] == nullptr &&
-				((componentFlags[j] & BaseECSSystem::FLAG_OPTIONAL) == 0))
+	// Determines if any of the component types the system only processes when changed, changed
+	// for the entity at a row of the chunk
+	auto isRowChanged = [&](unsigned int row)
+	{
+		for (unsigned int j = 0; j < componentTypes.size(); j++)
+		{
+			int column = archetype.GetColumn(componentTypes[j]);
+			if ((componentFlags[j] & BaseECSSystem::FLAG_ONLY_CHANGED) && column != -1 &&
+				ECSIsTickNewer(archetype.GetChangeTicks(chunk, column)[row], lastRunTick))
 			{
-				isValid = false;
-				// The entity can no longer be valid; the rest of the components do not need
-				// to be checked
-				break;
+				return true;
 			}
 		}
+		return false;
+	};
 
-		// If the entity has all components
-		if (isValid)
-			// Call UpdateComponents on the system
-			// Pass in the array of components to update
-			systems[index]->UpdateComponents(deltaTime, componentStorage.data());
+	// Update the system with every run of changed rows
+	unsigned int row = 0;
+	while (row < chunk.size)
+	{
+		while (row < chunk.size && !isRowChanged(row))
+		{
+			row++;
+		}
+
+		unsigned int first = row;
+		while (row < chunk.size && isRowChanged(row))
+		{
+			row++;
+		}
+
+		if (row > first)
+		{
+			updateRun(first, row - first);
+		}
 	}
 }
 
-unsigned int ECS::FindLeastCommonComponent(const std::vector<unsigned int>& componentTypes,
-	const std::vector<unsigned int>& componentFlags)
+ECSArchetype* ECS::FindOrCreateArchetype(const std::vector<unsigned int>& componentTypes)
 {
-	// Set to integer limit; highest value possible; we are looking for the minimum value
-	unsigned int minSize = (unsigned int)-1;
-	unsigned int minIndex = (unsigned int)-1;
+	// If an archetype with these component types already exists, use it
+	auto it = archetypeLookup.find(componentTypes);
+	if (it != archetypeLookup.end())
+	{
+		return it->second;
+	}
 
-	// Iterate through all component types passed in
-	for (unsigned int i = 0; i < componentTypes.size(); i++)
+	// Component types with a stable address are stored in the pool of their component type
+	std::vector<ECSComponentPool*> pools(componentTypes.size(), nullptr);
+	for (size_t i = 0; i < componentTypes.size(); i++)
 	{
-		// If the component type is optional, ignore it
-		if ((componentFlags[i] & BaseECSSystem::FLAG_OPTIONAL) != 0)
-			continue;
+		if (BaseECSComponent::HasTypeStableAddress(componentTypes[i]))
+		{
+			pools[i] = GetComponentPool(componentTypes[i]);
+		}
+	}
+
+	// Otherwise, create the archetype
+	ECSArchetype* archetype = new ECSArchetype(componentTypes, pools);
+	archetypes.push_back(archetype);
+	archetypeLookup[componentTypes] = archetype;
+
+	// This is the only time the set of archetypes matching a query can change
+	for (auto& query : queries)
+	{
+		query.second->AddArchetypeIfMatches(archetype);
+	}
+
+	UpdateEntityListeners(archetype);
+
+	return archetype;
+}
+
+ECSComponentPool* ECS::GetComponentPool(unsigned int componentID)
+{
+	if (componentID >= componentPools.size())
+	{
+		componentPools.resize(componentID + 1, nullptr);
+	}
+
+	if (componentPools[componentID] == nullptr)
+	{
+		componentPools[componentID] = new ECSComponentPool(
+			BaseECSComponent::GetTypeSize(componentID));
+	}
+
+	return componentPools[componentID];
+}
 
-		// Find the memory size of the component type
-		size_t typeSize = BaseECSComponent::GetTypeSize(componentTypes[i]);
+void ECS::UpdateEntityListeners(ECSArchetype* archetype)
+{
+	std::vector<ECSListener*> entityListeners;
 
-		// Get the size of the memory array for the component type (bytes) and divide it by
-		// the size of the component type (bytes)
-		// This finds how many times the component occurs, or in other words, how common the
-		// component is
-		unsigned int size = components[componentTypes[i]].size() / typeSize;
-		// If this component type is less common, set the minSize and minIndex accordingly
-		if (size <= minSize)
+	// Iterate over all listeners
+	for (ECSListener* listener : listeners)
+	{
+		// If the listener is interested in all entity operations, or the archetype has every
+		// component type which the listener is interested in, it should be notified
+		if (listener->ShouldNotifyOnAllEntityOperations() ||
+			SignatureContains(archetype->GetSignature(), listener->GetSignature()))
 		{
-			minSize = size;
-			minIndex = i;
+			entityListeners.push_back(listener);
 		}
 	}
 
-	return minIndex;
+	archetype->SetEntityListeners(std::move(entityListeners));
+}
+
+ECSQuery* ECS::FindOrCreateQuery(const std::vector<unsigned int>& componentTypes)
+{
+	auto it = queries.find(componentTypes);
+	if (it != queries.end())
+	{
+		return it->second;
+	}
+
+	// Otherwise, create the query and match it against every existing archetype once
+	ECSQuery* query = new ECSQuery(componentTypes);
+	for (ECSArchetype* archetype : archetypes)
+	{
+		query->AddArchetypeIfMatches(archetype);
+	}
+	queries[componentTypes] = query;
+
+	return query;
 }
 
-void ECS::DeleteComponent(unsigned int componentID, unsigned int index)
+void ECS::MoveEntity(EntityInternal& entity, ECSArchetype* destination)
 {
-	// Component type memory/data
-	std::vector<unsigned char>& array = components[componentID];
+	ECSArchetype* source = entity.archetype;
+
+	// Add a row for the entity to the destination archetype
+	unsigned int row = destination->AddRow(source->GetEntity(entity.row));
 
-	// Get the component type's free function, which defines how to free the component at runtime
-	ECSComponentFreeFunction freeFunction = BaseECSComponent::GetTypeFreeFunction(componentID);
+	// Move every component shared by both archetypes
+	const std::vector<unsigned int>& componentTypes = source->GetComponentTypes();
+	for (unsigned int column = 0; column < componentTypes.size(); column++)
+	{
+		int destinationColumn = destination->GetColumn(componentTypes[column]);
+
+		// The component was removed, and is already freed
+		if (destinationColumn == -1)
+		{
+			continue;
+		}
 
-	// Get the component type's size, which will be used for deallocating the correct amount
-	// of memory from the component type's memory array
-	size_t typeSize = BaseECSComponent::GetTypeSize(componentID);
+		destination->RelocateComponent(row, destinationColumn, *source, entity.row, column);
 
-	// Index of the last element in array
-	unsigned int sourceIndex = array.size() - typeSize;
+		// Moving a component does not change it
+		destination->MarkChanged(row, destinationColumn, source->GetChangeTick(entity.row, column));
+	}
 
-	// Cast the memory to BaseECSComponent pointers
-	// This is a safe cast because all elements in the array are components that inherit from
-	// BaseECSComponent
-	BaseECSComponent* destinationComponent = (BaseECSComponent*)&array[index];
-	BaseECSComponent* sourceComponent = (BaseECSComponent*)&array[sourceIndex];
+	// Remove the entity's row from the source archetype without freeing the components; they
+	// were moved or already freed
+	EntityHandle movedEntity = source->RemoveRow(entity.row, false);
+	if (movedEntity != nullptr)
+	{
+		HandleToEntity(movedEntity).row = entity.row;
+	}
 
-	// Call the free function on the component being deleted
-	freeFunction(destinationComponent);
+	entity.archetype = destination;
+	entity.row = row;
+}
 
-	// Special case where the component being deleted is the final element of the array
-	if (index == sourceIndex)
+void ECS::AddComponentByType(EntityHandle entity, unsigned int componentID,
+	BaseECSComponent* component)
+{
+	// Stale handles are ignored
+	if (!IsValid(entity))
 	{
-		array.resize(sourceIndex);
 		return;
 	}
 
-	// Copy the last element of the array to the location of the deleted component
-	std::memcpy(destinationComponent, sourceComponent, typeSize);
+	AddComponentInternal(entity, componentID, component);
 
-	// Note that entities store components as a <type ID, index> pair, where the index represents 
-	// the location of the component in the component type's memory array. This means that if we 
-	// move the location of a component, we must also update the index in the entity.
+	// Now that the component is created, dispatch the add component event to all listeners
+	// in the ECS which are interested in the component type
+	for (size_t i = 0; componentID < componentListeners.size() &&
+		i < componentListeners[componentID].size(); i++)
+	{
+		componentListeners[componentID][i]->OnAddComponent(entity, componentID);
+	}
+}
 
-	// Get a reference to the entity which the component being copied is attached to
-	std::vector<std::pair<unsigned int, unsigned int>>& sourceComponents =
-		HandleToEntity(sourceComponent->entity);
+bool ECS::RemoveComponentByType(EntityHandle entity, unsigned int componentID)
+{
+	// Stale handles are ignored
+	if (!IsValid(entity))
+	{
+		return false;
+	}
 
-	// Search for the source component in the entity...
-	// Iterate over all components in the entity
-	for (unsigned int i = 0; i < sourceComponents.size(); i++)
+	// Before removing the component, dispatch the remove component event to all listeners
+	// in the ECS which are interested in the component type
+	for (size_t i = 0; componentID < componentListeners.size() &&
+		i < componentListeners[componentID].size(); i++)
 	{
-		// If we found the source component
-		if (componentID == sourceComponents[i].first && sourceIndex == sourceComponents[i].second)
-		{
-			// Update the index of the component in the component type's memory array
-			sourceComponents[i].second = index;
-			break;
-		}
+		componentListeners[componentID][i]->OnRemoveComponent(entity, componentID);
 	}
 
-	// Remove the last element from the array
-	array.resize(sourceIndex);
+	return RemoveComponentInternal(entity, componentID);
 }
 
 bool ECS::RemoveComponentInternal(EntityHandle handle, unsigned int componentID)
 {
 	// Get a reference to the entity which the component is being removed from
-	std::vector<std::pair<unsigned int, unsigned int>>& entityComponents = HandleToEntity(handle);
+	EntityInternal& entity = HandleToEntity(handle);
 
-	// Iterate over all components in the entity
-	for (unsigned int i = 0; i < entityComponents.size(); i++)
+	int column = entity.archetype->GetColumn(componentID);
+
+	// The component was not removed; the component ID was not found in the entity
+	if (column == -1)
 	{
-		// If the component ID matches the ID of the component to remove
-		if (componentID == entityComponents[i].first)
-		{
-			// Delete the component
-			// Note that this only deletes the component at it's index in the components array
-			// The component <type ID, index> pair still needs to be removed from the entity
-			DeleteComponent(entityComponents[i].first, entityComponents[i].second);
+		return false;
+	}
 
-			// Swap the component being removed with the final component in the vector/array,
-			// and then delete the final element
-			unsigned int sourceIndex = entityComponents.size() - 1;
-			unsigned int destinationIndex = i;
-			entityComponents[destinationIndex] = entityComponents[sourceIndex];
-			entityComponents.pop_back();
+	// Find the archetype of the entity without the component type
+	ECSArchetype* destination = entity.archetype->GetRemoveEdge(componentID);
+	if (destination == nullptr)
+	{
+		std::vector<unsigned int> componentTypes = entity.archetype->GetComponentTypes();
+		componentTypes.erase(componentTypes.begin() + column);
 
-			// Successfully removed the component from the entity
-			return true;
-		}
+		destination = FindOrCreateArchetype(componentTypes);
+
+		// Cache the edge in both directions
+		entity.archetype->SetRemoveEdge(componentID, destination);
+		destination->SetAddEdge(componentID, entity.archetype);
 	}
 
-	// The component was not removed; the component ID was not found in the entity
-	return false;
+	// Free the component being removed
+	entity.archetype->FreeComponent(entity.row, column);
+
+	// Move the rest of the components to the new archetype
+	MoveEntity(entity, destination);
+
+	// Successfully removed the component from the entity
+	return true;
 }
 
-void ECS::AddComponentInternal(EntityHandle handle, 
-	std::vector<std::pair<unsigned int,	unsigned int>>& entity, unsigned int componentID,
+void ECS::AddComponentInternal(EntityHandle handle, unsigned int componentID,
 	BaseECSComponent* component)
 {
-	// Get the component type's create function, which defines how to create the component
-	// at runtime
-	ECSComponentCreateFunction createFunction = BaseECSComponent::GetTypeCreateFunction(componentID);
+	// Get a reference to the entity which the component is being added to
+	EntityInternal& entity = HandleToEntity(handle);
+
+	int column = entity.archetype->GetColumn(componentID);
+
+	// Entities can only have one component of a given type; if the entity already has a component
+	// of this type, replace it
+	// Pools reuse the most recently freed slot, so a pooled component keeps it's address
+	if (column != -1)
+	{
+		entity.archetype->FreeComponent(entity.row, column);
+		entity.archetype->ConstructComponent(entity.row, column, handle, component);
+		entity.archetype->MarkChanged(entity.row, column, changeTick);
+		return;
+	}
+
+	// Find the archetype of the entity with the component type
+	ECSArchetype* destination = entity.archetype->GetAddEdge(componentID);
+	if (destination == nullptr)
+	{
+		std::vector<unsigned int> componentTypes = entity.archetype->GetComponentTypes();
+		componentTypes.insert(std::upper_bound(componentTypes.begin(), componentTypes.end(),
+			componentID), componentID);
 
-	// pair<component ID, index in components vector/array>
-	std::pair<unsigned int, unsigned int> newPair;
+		destination = FindOrCreateArchetype(componentTypes);
 
-	newPair.first = componentID;
+		// Cache the edge in both directions
+		entity.archetype->SetAddEdge(componentID, destination);
+		destination->SetRemoveEdge(componentID, entity.archetype);
+	}
 
-	// The create function returns the location/index of the component created in the memory array
-	// See ECSComponentCreate
-	//
-	// Pass in the components memory array, which is where we want the component to be created,
-	// the entity handle, so that the component knows what entity it belongs to, and the pointer
-	// to the component to create
-	newPair.second = createFunction(components[componentID], handle, component);
+	// Move the existing components to the new archetype
+	MoveEntity(entity, destination);
 
-	// Add the newly created component to our entity
-	entity.push_back(newPair);
+	// Construct the new component in the new archetype
+	int destinationColumn = destination->GetColumn(componentID);
+	destination->ConstructComponent(entity.row, destinationColumn, handle, component);
+	destination->MarkChanged(entity.row, destinationColumn, changeTick);
 }
 
-BaseECSComponent* ECS::GetComponentInternal(
-	std::vector<std::pair<unsigned int, unsigned int>>& entityComponents,
-	std::vector<unsigned char>& array, unsigned int componentID)
+uint32_t ECS::GetComponentChangeTickByType(EntityHandle entity, unsigned int componentID)
 {
-	// Iterate over all components in the entity
-	for (unsigned int i = 0; i < entityComponents.size(); i++)
+	if (!IsValid(entity))
 	{
-		// If the component ID matches the ID of the component to get
-		if (componentID == entityComponents[i].first)
-		{
-			// Retrieve and return the component
-			// This is a safe cast because all elements in the array are components that inherit
-			// from BaseECSComponent
-			return (BaseECSComponent*)&array[entityComponents[i].second];
-		}
+		return 0;
+	}
+
+	EntityInternal& entityInternal = HandleToEntity(entity);
+	int column = entityInternal.archetype->GetColumn(componentID);
+
+	// The component is not found
+	if (column == -1)
+	{
+		return 0;
+	}
+
+	return entityInternal.archetype->GetChangeTick(entityInternal.row, column);
+}
+
+BaseECSComponent* ECS::GetMutByType(EntityHandle entity, unsigned int componentID)
+{
+	if (!IsValid(entity))
+	{
+		return nullptr;
+	}
+
+	EntityInternal& entityInternal = HandleToEntity(entity);
+	int column = entityInternal.archetype->GetColumn(componentID);
+
+	// The component is not found
+	if (column == -1)
+	{
+		return nullptr;
+	}
+
+	entityInternal.archetype->MarkChanged(entityInternal.row, column, changeTick);
+	return entityInternal.archetype->GetComponent(entityInternal.row, column);
+}
+
+ECSComponentSpan ECS::GetMutSpanByType(EntityHandle entity, unsigned int componentID)
+{
+	if (!IsValid(entity))
+	{
+		return ECSComponentSpan();
+	}
+
+	EntityInternal& entityInternal = HandleToEntity(entity);
+	int column = entityInternal.archetype->GetColumn(componentID);
+
+	// The component is not found
+	if (column == -1)
+	{
+		return ECSComponentSpan();
 	}
+
+	entityInternal.archetype->MarkChanged(entityInternal.row, column, changeTick);
+	return entityInternal.archetype->GetComponentSpan(entityInternal.row, column);
+}
+
+BaseECSComponent* ECS::GetComponentInternal(EntityInternal& entity, unsigned int componentID)
+{
+	int column = entity.archetype->GetColumn(componentID);
+
 	// The component is not found
-	return nullptr;
-}
\ No newline at end of file
+	if (column == -1)
+	{
+		return nullptr;
+	}
+
+	// Retrieve and return the component
+	return entity.archetype->GetComponent(entity.row, column);
+}
@@ -28,7 +28,17 @@
 
 #include "ECSComponent.h"
 #include "ECSSystem.h"
-
+#include "ECSArchetype.h"
+#include "ECSCommandBuffer.h"
+#include "ECSQuery.h"
+#include "ECSSnapshot.h"
+#include "ECSStats.h"
+#include "ECSThreadPool.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -47,6 +57,24 @@ public:
 	 */
 	virtual void OnMakeEntity(EntityHandle handle) {}
 
+	/**
+	 * Called when the ECS makes many entities with the same component types at once, instead of
+	 * calling OnMakeEntity for every entity. The same filtering as OnMakeEntity applies. Can be
+	 * overridden in derived classes; calls OnMakeEntity for every entity by default.
+	 * 
+	 * @see ECS::MakeEntities
+	 * 
+	 * @param handles Handles to the newly created entities.
+	 * @param count The number of entities.
+	 */
+	virtual void OnMakeEntities(const EntityHandle* handles, size_t count)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			OnMakeEntity(handles[i]);
+		}
+	}
+
 	/**
 	 * Called any time the ECS is removing an entity. If the listener is not listening to all entity
 	 * operations, this will only be called if the entity contains all the components the listener 
@@ -80,6 +108,9 @@ public:
 	/** @brief Gets the IDs of all component types which the listener is interesed in. */
 	const std::vector<unsigned int>& GetComponentIDs() { return componentIDs; }
 
+	/** @brief Gets the component types which the listener is interested in as a signature. */
+	const ECSComponentSignature& GetSignature() { return signature; }
+
 	/**
 	 * @brief If false, component event methods should only be called if the component is of a type
 	 * which the listener is interested in.
@@ -117,11 +148,13 @@ protected:
 	void AddComponentID(unsigned int id)
 	{
 		componentIDs.push_back(id);
+		signature.set(id);
 	}
 
 private:
 	// The component types which the listener is interested in
 	std::vector<unsigned int> componentIDs;
+	ECSComponentSignature signature;
 	bool notifyOnAllComponentOperations = false;
 	bool notifyOnAllEntityOperations = false;
 };
@@ -143,33 +176,41 @@ private:
  *   components which define an object in the game. Entities can only have one component of a given
  *   type (duplicate components are not allowed).
  * 
+ * Entities which have the exact same set of component types share an archetype. The components
+ * of an archetype are stored in fixed-size chunks, one column per component type, so that systems
+ * can walk the components of all matching entities linearly.
+ * 
  * Internal versions of certain methods in ECS are used because the type name is not known at
  * compile time.
  */
 class ECS
 {
 public:
+	// Change ticks older than this many ticks before the current tick are clamped to it; ticks
+	// stay well within half of the range of ticks of each other, so ECSIsTickNewer stays correct
+	static constexpr uint32_t MAX_CHANGE_TICK_AGE = 1u << 30;
+
+	// How many ticks pass between clamping the change ticks
+	static constexpr uint32_t CLAMP_CHANGE_TICKS_INTERVAL = 1u << 28;
+
 	ECS() {}
 
-	// A destructor is used because we are
-	// - manually managing the memory of our components
-	// - dynamically allocating and removing entities
+	// A destructor is used because we are manually managing the memory of our components and
+	// archetypes
 	~ECS();
 
 	// ECSListener methods
 
 	/**
 	 * Adds a listener to the ECS. Each listener's event methods will be called by the ECS on
-	 * the corresponding events.
+	 * the corresponding events. The component types and notification settings of the listener
+	 * must not change once it has been added.
 	 * 
 	 * @see ECSListener
 	 * 
 	 * @param listener The listener to add.
 	 */
-	inline void AddListener(ECSListener* listener)
-	{
-		listeners.push_back(listener);
-	}
+	void AddListener(ECSListener* listener);
 
 	// Entity methods
 
@@ -185,12 +226,26 @@ public:
 		size_t numberOfComponents);
 
 	/**
-	 * Removes an entity from the ECS and deletes it.
+	 * Removes an entity from the ECS and deletes it. Nothing happens if the handle is stale.
 	 * 
 	 * @param handle Handle to the entity to delete.
 	 */
 	void RemoveEntity(EntityHandle handle);
 
+	/**
+	 * Checks if a handle refers to an entity which still exists. Handles to removed entities are
+	 * detected in constant time, even if the entity's slot has since been reused.
+	 * 
+	 * @param handle The entity handle.
+	 * @return If the entity exists or not.
+	 */
+	inline bool IsValid(EntityHandle handle) const
+	{
+		return handle.index < entities.size() &&
+			entities[handle.index].generation == handle.generation &&
+			entities[handle.index].archetype != nullptr;
+	}
+
 	// Use variadic template parameters to allow any number of components to be passed in.
 	template<class... Components>
 	/**
@@ -209,6 +264,72 @@ public:
 		return MakeEntity(components, componentIDs, sizeof...(Components));
 	}
 
+	/**
+	 * Makes many entities with the same components at once. Storage for all entities is reserved
+	 * up front, the components are constructed one component type at a time, and listeners are
+	 * notified once for all entities. Non-templated version.
+	 * 
+	 * @see ECSListener::OnMakeEntities
+	 * 
+	 * @param count The number of entities to make.
+	 * @param prototypeComponents The components which every entity gets a copy of.
+	 * @param componentIDs The types of the components being added.
+	 * @param numberOfComponents The number of components being added.
+	 * @param handles Array of at least count elements which receives the handles of the new
+	 *		entities, or nullptr if the handles are not needed.
+	 * @return If the entities were made or not.
+	 */
+	bool MakeEntities(size_t count, BaseECSComponent** prototypeComponents,
+		const unsigned int* componentIDs, size_t numberOfComponents, EntityHandle* handles);
+
+	template<class... Components>
+	/**
+	 * Makes many entities with the same components at once.
+	 * 
+	 * @see MakeEntities
+	 * 
+	 * @param count The number of entities to make.
+	 * @param ...prototypeComponents The components which every entity gets a copy of.
+	 * @return Handles to the new entities. Empty if the entities could not be made.
+	 */
+	std::vector<EntityHandle> MakeEntities(size_t count, Components&... prototypeComponents)
+	{
+		BaseECSComponent* components[] = { (&prototypeComponents)... };
+		unsigned int componentIDs[] = { (std::remove_reference_t<Components>::ID)... };
+
+		std::vector<EntityHandle> handles(count);
+		if (!MakeEntities(count, components, componentIDs, sizeof...(Components), handles.data()))
+		{
+			handles.clear();
+		}
+		return handles;
+	}
+
+	/**
+	 * Reserves storage for entities with the specified component types, so that making them
+	 * later does not allocate. Non-templated version.
+	 * 
+	 * @param count The total number of entities with these component types to reserve storage
+	 *		for, including the ones which already exist.
+	 * @param componentIDs The component types of the entities.
+	 * @param numberOfComponents The number of component types.
+	 */
+	void Reserve(size_t count, const unsigned int* componentIDs, size_t numberOfComponents);
+
+	template<class... Components>
+	/**
+	 * Reserves storage for entities with the specified component types. Components are stored
+	 * per set of component types, so the hint applies to entities with exactly these types.
+	 * 
+	 * @param count The total number of entities with these component types to reserve storage
+	 *		for, including the ones which already exist.
+	 */
+	inline void Reserve(size_t count)
+	{
+		unsigned int componentIDs[] = { (Components::ID)... };
+		Reserve(count, componentIDs, sizeof...(Components));
+	}
+
 	// Component methods
 
 	template<class Component>
@@ -220,42 +341,20 @@ public:
 	 */
 	inline void AddComponent(EntityHandle entity, Component* component)
 	{
-		AddComponentInternal(HandleToEntity(entity), Component::ID, component);
-
-		// Now that the component is created, dispatch the add component event to all listeners
-		// in the ECS...
-
-		// Iterate over all listeners
-		for (unsigned int i = 0; i < listeners.size(); i++)
-		{
-			// Get the component types which the listener is interested in
-			const std::vector<unsigned int>& componentIDs = listeners[i]->GetComponentIDs();
-
-			// If the listener is interested in all component operations, dispatch the event
-			// regardless of whether or not the listener is interested in the component type
-			if (listeners[i]->ShouldNotifyOnAllComponentOperations())
-			{
-				listeners[i]->OnAddComponent(entity, Component::ID);
-			}
-			// Otherwise, check if the listener is interested in this component type
-			else
-			{
-				// Iterate over all component types the listener is interested in
-				for (unsigned int componentID : componentIDs)
-				{
-					// If the component type being added is one the component types the listener
-					// is interested in
-					if (componentID == Component::ID)
-					{
-						// Dispatch the event
-						listeners[i]->OnAddComponent(entity, Component::ID);
-						break;
-					}
-				}
-			}
-		}
+		AddComponentByType(entity, Component::ID, component);
 	}
 
+	/**
+	 * Adds a component to an entity, based on component type ID. If the entity already has a
+	 * component of the type, it is replaced. Nothing happens if the handle is stale.
+	 * 
+	 * @param entity Handle to the entity which the component should be attached to.
+	 * @param componentID ID of the component type.
+	 * @param component Pointer to the component to attach.
+	 */
+	void AddComponentByType(EntityHandle entity, unsigned int componentID,
+		BaseECSComponent* component);
+
 	template<class Component>
 	/**
 	 * Removes a component from an entity, based on component type.
@@ -265,40 +364,42 @@ public:
 	 */
 	inline bool RemoveComponent(EntityHandle entity)
 	{
-		// Before removing the component, dispatch the remove component event to all listeners
-		// in the ECS...
+		return RemoveComponentByType(entity, Component::ID);
+	}
 
-		// Iterate over all listeners
-		for (unsigned int i = 0; i < listeners.size(); i++)
-		{
-			// Get the component types which the listener is interested in
-			const std::vector<unsigned int>& componentIDs = listeners[i]->GetComponentIDs();
-
-			// If the listener is interested in all component operations, dispatch the event
-			// regardless of whether or not the listener is interested in the component type
-			if (listeners[i]->ShouldNotifyOnAllComponentOperations())
-			{
-				listeners[i]->OnRemoveComponent(entity, Component::ID);
-			}
-			// Otherwise, check if the listener is interested in this component type
-			else
-			{
-				// Iterate over all component types the listener is interested in
-				for (unsigned int componentID : componentIDs)
-				{
-					// If the component type being removed is one the component types the listener
-					// is interested in
-					if (componentID == Component::ID)
-					{
-						// Dispatch the event
-						listeners[i]->OnRemoveComponent(entity, Component::ID);
-						break;
-					}
-				}
-			}
-		}
+	/**
+	 * Removes a component from an entity, based on component type ID.
+	 * 
+	 * @param entity Handle to the entity which the component will be removed from.
+	 * @param componentID ID of the component type.
+	 * @return If the component was sucessfully removed or not.
+	 */
+	bool RemoveComponentByType(EntityHandle entity, unsigned int componentID);
 
-		return RemoveComponentInternal(entity, Component::ID);
+	template<class Component>
+	/**
+	 * Determines if an entity has a component type.
+	 * 
+	 * @param entity Handle to the entity.
+	 * @return If the entity has the component type; false if the handle is stale.
+	 */
+	inline bool HasComponent(EntityHandle entity) const
+	{
+		return HasComponentByType(entity, Component::ID);
+	}
+
+	/**
+	 * Determines if an entity has a component type, based on component type ID. Unlike checking
+	 * the result of GetComponentByType, this also works for component types stored as a struct of
+	 * arrays.
+	 * 
+	 * @param entity Handle to the entity.
+	 * @param componentID ID of the component type.
+	 * @return If the entity has the component type; false if the handle is stale.
+	 */
+	inline bool HasComponentByType(EntityHandle entity, unsigned int componentID) const
+	{
+		return IsValid(entity) && entities[entity.index].archetype->HasComponentType(componentID);
 	}
 
 	template<class Component>
@@ -308,87 +409,457 @@ public:
 	 * @param entity Handle to the entity to get the component from.
 	 * 
 	 * @return Pointer to the component, of the specified component type, belonging to the
-	 *		specified entity.
+	 *		specified entity. Returns nullptr if the entity does not have the component type, or if
+	 *		the handle is stale.
 	 */
 	inline Component* GetComponent(EntityHandle entity)
 	{
-		return (Component*)GetComponentInternal(HandleToEntity(entity), components[Component::ID],
-			Component::ID);
+		static_assert(!ECSSoAFields<Component>::IS_SOA,
+			"Components stored as a struct of arrays are accessed through GetProxy.");
+
+		return (Component*)GetComponentByType(entity, Component::ID);
+	}
+
+	template<class Component>
+	/**
+	 * Gets a component from an entity for modifying it, and marks the component as changed.
+	 * Changes made through GetComponent are not seen by systems which only process changed
+	 * components.
+	 * 
+	 * @see BaseECSSystem::FLAG_ONLY_CHANGED
+	 * 
+	 * @param entity Handle to the entity to get the component from.
+	 * @return Pointer to the component, or nullptr if the entity does not have the component type
+	 *		or if the handle is stale.
+	 */
+	inline Component* GetMut(EntityHandle entity)
+	{
+		static_assert(!ECSSoAFields<Component>::IS_SOA,
+			"Components stored as a struct of arrays are accessed through GetProxy.");
+
+		return (Component*)GetMutByType(entity, Component::ID);
+	}
+
+	template<class Component>
+	/**
+	 * Gets a component stored as a struct of arrays from an entity for modifying it, and marks
+	 * the component as changed. The proxy holds a copy of the component, which is written back
+	 * when the proxy is destroyed.
+	 * 
+	 * @see ECSSoAFields
+	 * 
+	 * @param entity Handle to the entity to get the component from.
+	 * @return Proxy of the component, which converts to false if the entity does not have the
+	 *		component type or if the handle is stale. Must not outlive the next structural change
+	 *		of the ECS.
+	 */
+	inline ECSComponentProxy<Component> GetProxy(EntityHandle entity)
+	{
+		static_assert(ECSSoAFields<Component>::IS_SOA,
+			"Only components stored as a struct of arrays are accessed through GetProxy.");
+
+		return ECSComponentProxy<Component>(GetMutSpanByType(entity, Component::ID), 0, true);
 	}
 
+	/**
+	 * Gets the span of a single component from an entity for modifying it, based on component
+	 * type ID, and marks the component as changed. Works for every component type, including
+	 * ones stored as a struct of arrays.
+	 * 
+	 * @param entity Handle to the entity to get the component from.
+	 * @param componentID ID of the component type.
+	 * @return Span whose first element is the component, or an empty span if the entity does not
+	 *		have the component type or if the handle is stale.
+	 */
+	ECSComponentSpan GetMutSpanByType(EntityHandle entity, unsigned int componentID);
+
+	/**
+	 * Gets a component from an entity for modifying it, based on component type ID, and marks
+	 * the component as changed.
+	 * 
+	 * @see GetMut
+	 * 
+	 * @param entity Handle to the entity to get the component from.
+	 * @param componentID ID of the component type.
+	 * @return Pointer to the component, or nullptr if the entity does not have the component type,
+	 *		if the handle is stale, or if the component type is stored as a struct of arrays.
+	 */
+	BaseECSComponent* GetMutByType(EntityHandle entity, unsigned int componentID);
+
+	/**
+	 * Gets a component from an entity, based on component type ID.
+	 * 
+	 * @param entity Handle to the entity to get the component from.
+	 * @param componentID ID of the component type.
+	 * @return Pointer to the component, or nullptr if the entity does not have the component type,
+	 *		if the handle is stale, or if the component type is stored as a struct of arrays.
+	 */
 	BaseECSComponent* GetComponentByType(EntityHandle entity, unsigned int componentID)
 	{
-		return GetComponentInternal(HandleToEntity(entity), components[componentID], componentID);
+		if (!IsValid(entity))
+		{
+			return nullptr;
+		}
+
+		return GetComponentInternal(HandleToEntity(entity), componentID);
 	}
 
+	// Change tick methods
+
+	/**
+	 * Gets the current change tick, which changes made outside of systems are marked with. The
+	 * tick only advances when a system is updated, or when AdvanceChangeTick is called.
+	 */
+	inline uint32_t GetChangeTick() const { return changeTick; }
+
+	/**
+	 * Ends the current change tick. Every change made afterwards is marked with a later tick, so
+	 * the returned tick can be stored and compared against later with ECSIsTickNewer to find
+	 * what changed in between.
+	 * 
+	 * Ticks older than MAX_CHANGE_TICK_AGE are clamped at the end of UpdateSystems, so a stored
+	 * tick must be compared against at least that often.
+	 * 
+	 * @return The tick which was ended.
+	 */
+	inline uint32_t AdvanceChangeTick()
+	{
+		return changeTick++;
+	}
+
+	template<class Component>
+	/**
+	 * Gets the tick at which a component of an entity was last changed.
+	 * 
+	 * @param entity Handle to the entity to look in.
+	 * @return The change tick, or 0 if the entity does not have the component type or if the
+	 *		handle is stale.
+	 */
+	inline uint32_t GetComponentChangeTick(EntityHandle entity)
+	{
+		return GetComponentChangeTickByType(entity, Component::ID);
+	}
+
+	/**
+	 * Gets the tick at which a component of an entity was last changed, based on component type
+	 * ID.
+	 * 
+	 * @param entity Handle to the entity to look in.
+	 * @param componentID ID of the component type.
+	 * @return The change tick, or 0 if the entity does not have the component type or if the
+	 *		handle is stale.
+	 */
+	uint32_t GetComponentChangeTickByType(EntityHandle entity, unsigned int componentID);
+
 	// System methods
 
 	/**
-	 * Updates all systems in a specified system list. Should be called every frame.
+	 * Gets the query of the archetypes which have all of the specified component types. The
+	 * query is created the first time it is requested, and is kept up to date for as long as
+	 * the ECS exists.
+	 * 
+	 * @param componentTypes The IDs of the component types.
+	 * @return Reference to the query.
+	 */
+	ECSQuery& GetQuery(std::vector<unsigned int> componentTypes);
+
+	/**
+	 * Updates all systems in a specified system list. Should be called every frame. Command
+	 * buffers are played back once every system has been updated.
 	 * 
 	 * @param systems The systems to update.
 	 * @param deltaTime How much time has passed since the previous update.
 	 */
 	void UpdateSystems(ECSSystemList& systems, float deltaTime);
 
+	/**
+	 * Updates all systems in a specified system list, using a thread pool to update systems which
+	 * do not conflict with each other at the same time. The result is the same as updating the
+	 * systems one after another. Systems which are parallel additionally have their entities
+	 * split into ranges which are updated on the thread pool. Should be called every frame.
+	 * 
+	 * Entities and components must not be made or removed directly while the systems are being
+	 * updated. Systems should record those changes into the command buffer of their thread
+	 * instead, which is played back once every system has been updated.
+	 * 
+	 * @see GetCommandBuffer
+	 * 
+	 * @see ECSSystemList::GetSchedule
+	 * @see BaseECSSystem::IsParallel
+	 * 
+	 * @param systems The systems to update.
+	 * @param deltaTime How much time has passed since the previous update.
+	 * @param threadPool The thread pool to update the systems on.
+	 */
+	void UpdateSystems(ECSSystemList& systems, float deltaTime, ECSThreadPool& threadPool);
+
+	// Command buffer methods
+
+	/**
+	 * Gets the command buffer of the calling thread, which is created the first time it is
+	 * requested. Systems record changes to entities and components into the command buffer while
+	 * they are being updated, rather than applying them directly.
+	 * 
+	 * The lookup takes a lock; systems recording many commands should get the command buffer once
+	 * per batch rather than once per entity.
+	 * 
+	 * @return Reference to the command buffer.
+	 */
+	ECSCommandBuffer& GetCommandBuffer();
+
+	/**
+	 * Applies the commands of every command buffer, and clears them. Making entities is applied
+	 * first, grouped by component types, followed by adding and removing components, and
+	 * finally removing entities. Commands affecting the same entity are applied in the order they
+	 * were recorded. Called automatically at the end of UpdateSystems.
+	 * 
+	 * Commands recorded while playing back, such as by listeners notified of the changes, are
+	 * played back as well before returning, in further rounds until every command buffer is
+	 * empty. Listeners must therefore not record commands every time they are notified.
+	 * 
+	 * Must not be called while systems are being updated.
+	 */
+	void PlaybackCommandBuffers();
+
+	// Snapshot methods
+
+	/**
+	 * Copies the complete state of the ECS into a snapshot, which the ECS can be restored to
+	 * later. Any previous contents of the snapshot are released.
+	 * 
+	 * If a previous snapshot is given, every chunk which has not changed since the previous
+	 * snapshot was taken shares the previous snapshot's copy. Changes are detected through the
+	 * change ticks, so components modified through GetComponent rather than GetMut or a system
+	 * are not detected, and must not be modified between the two snapshots.
+	 * 
+	 * Must not be called while systems are being updated.
+	 * 
+	 * @param snapshot The snapshot to copy the state into.
+	 * @param previous A snapshot of this ECS taken earlier, or nullptr to copy every chunk. Must
+	 *		not be the same snapshot.
+	 */
+	void Snapshot(ECSSnapshot& snapshot, const ECSSnapshot* previous = nullptr);
+
+	/**
+	 * Restores the ECS to the state of a snapshot. Every current entity is removed, and every
+	 * entity of the snapshot is made again with the same handle and components. Listeners are
+	 * notified of both. Every restored component is marked as changed.
+	 * 
+	 * Pointers to components are invalidated. Must not be called while systems are being
+	 * updated, or while command buffers hold commands which have not been played back.
+	 * 
+	 * @param snapshot A snapshot taken from this ECS.
+	 * @return If the snapshot was restored or not.
+	 */
+	bool Restore(const ECSSnapshot& snapshot);
+
+	// Statistics methods
+
+	/**
+	 * Gathers the memory usage and occupancy of every component type and archetype, along with
+	 * the entity counts and update times of systems as of their last update.
+	 * 
+	 * Must not be called while systems are being updated.
+	 * 
+	 * @param systemLists The system lists whose systems should be included.
+	 * @return The statistics.
+	 */
+	ECSStats GetStats(const std::vector<ECSSystemList*>& systemLists = {});
+
 private:
-	// map<id, memory>
-	std::unordered_map<unsigned int, std::vector<unsigned char>> components;
+	/** @brief Used internally for referring to an entity. This is a slot in the entity table. */
+	struct EntityInternal
+	{
+		// The archetype which stores the entity's components
+		// nullptr if the slot is free
+		ECSArchetype* archetype;
+
+		// The row of the entity in the archetype
+		unsigned int row;
+
+		// Incremented every time the slot is freed, so that stale handles can be detected
+		uint32_t generation;
+	};
+
+	// Every archetype created by the ECS. Archetypes are never deleted while the ECS exists, even
+	// if they become empty, since entities with the same component types are likely to return.
+	std::vector<ECSArchetype*> archetypes;
+
+	// map<sorted component IDs, archetype>
+	// Used for finding the archetype of a set of component types
+	std::map<std::vector<unsigned int>, ECSArchetype*> archetypeLookup;
+
+	// Pools storing the components of component types with a stable address; index corresponds to
+	// component ID, and the value is nullptr until an archetype with the component type is created
+	std::vector<ECSComponentPool*> componentPools;
 
-	// vector<pair<index, entity>>
-	// The index is stored in the pair because it allows for efficient element removal
-	//
-	// An entity is an array of components; entity = vector<pair<componentType, componentIndex>>
-	// where componentType is the ID and componentIndex is the index in components (defined above)
-	std::vector<std::pair<unsigned int, std::vector<std::pair<unsigned int, unsigned int>>>*>
-		entities;
+	// Entity table; an EntityHandle's index is the index of the entity's slot in this table
+	// Slots are reused, so making and removing entities does not allocate once the table has
+	// grown large enough
+	std::vector<EntityInternal> entities;
+
+	// Indices of the free slots in the entity table
+	std::vector<uint32_t> freeEntities;
+
+	// Used for sorting the component types of a new entity, without allocating every time an
+	// entity is made
+	std::vector<unsigned int> componentTypesStorage;
+
+	// map<sorted component IDs, query>
+	// Every query is updated when an archetype is created
+	std::map<std::vector<unsigned int>, ECSQuery*> queries;
+
+	// Protects the free slots of the entity table, so that command buffers on multiple threads
+	// can reserve entities at the same time
+	std::mutex entitiesMutex;
+
+	// The number of slots reserved past the end of the entity table, which have not been added to
+	// the table yet
+	uint32_t numReservedEntities = 0;
+
+	// Incremented every time a system is updated, and by AdvanceChangeTick; components are
+	// marked with the tick at which they were last changed
+	// Starts after 0, so that every change is later than a tick of 0
+	std::atomic<uint32_t> changeTick{ 1 };
+
+	// The change tick when change ticks were last clamped
+	uint32_t lastClampTick = 0;
+
+	// Command buffer of every thread which has requested one
+	std::mutex commandBuffersMutex;
+	std::unordered_map<std::thread::id, ECSCommandBuffer*> commandBuffers;
 
 	// All listeners which should have the appropriate methods called on ECS events
 	std::vector<ECSListener*> listeners;
 
+	// Listeners bucketed by component type; index corresponds to component ID, and the value is
+	// every listener which should be notified when a component of that type is added or removed
+	// Listeners interested in all component operations are in every bucket
+	std::vector<std::vector<ECSListener*>> componentListeners;
+
 	/**
-	 * Used internally for casting an EntityHandle to an index-entity pair pointer.
+	 * Used internally for getting the entity for a given EntityHandle. The handle is assumed to
+	 * be valid. The reference is invalidated when an entity is made.
+	 * 
+	 * @see IsValid
 	 * 
 	 * @param handle The entity handle.
-	 * @return The index-entity pair pointer.
+	 * @return Reference to the entity.
 	 */
-	inline std::pair<unsigned int, std::vector<std::pair<unsigned int,
-		unsigned int>>>* HandleToRawType(EntityHandle handle)
+	inline EntityInternal& HandleToEntity(EntityHandle handle)
 	{
-		return (std::pair<unsigned int, std::vector<std::pair<unsigned int,
-			unsigned int>>>*)handle;
+		return entities[handle.index];
 	}
 
+	// Command buffers reserve entity handles when recording
+	friend class ECSCommandBuffer;
+
+	// Scene files read and replace the entity table and archetypes directly
+	friend class ECSSceneFile;
+
 	/**
-	 * Used internally for getting the index of an entity in the entities vector/array, given an
-	 * EntityHandle.
+	 * Used internally for reserving the slot of an entity which will be made later. The slot is
+	 * not added to the entity table until the next entity is made, or until command buffers are
+	 * played back. Safe to call from multiple threads at the same time.
 	 * 
-	 * @param handle The entity handle.
-	 * @return The index of the entity in the entities vector/array.
+	 * @return Handle to the reserved entity.
 	 */
-	inline unsigned int HandleToEntityIndex(EntityHandle handle)
-	{
-		return HandleToRawType(handle)->first;
-	}
+	EntityHandle ReserveEntity();
 
 	/**
-	 * Used internally for getting the entity for a given EntityHandle.
+	 * Used internally for finding a slot for a new entity in the entity table. Reuses a free slot
+	 * if there is one, otherwise grows the table.
 	 * 
-	 * @param handle The entity handle.
-	 * @return Reference to the entity. Note than an entity is an array of components.
+	 * @return Handle to the new entity. The entity has no archetype yet.
 	 */
-	inline std::vector<std::pair<unsigned int, unsigned int>>& HandleToEntity(EntityHandle handle)
-	{
-		return HandleToRawType(handle)->second;
-	}
+	EntityHandle AllocateEntity();
+
+	/**
+	 * Used internally for freeing the slot of an entity. The generation of the slot is
+	 * incremented, so that any remaining handles to the entity become stale.
+	 * 
+	 * @param index The index of the slot in the entity table.
+	 */
+	void ReleaseEntity(uint32_t index);
+
+	/**
+	 * Used internally for checking the component types of a new entity. On success, the sorted
+	 * component types are stored in componentTypesStorage.
+	 * 
+	 * @param componentIDs The types of the components of the entity.
+	 * @param numberOfComponents The number of components.
+	 * @return If the component types are valid or not.
+	 */
+	bool ValidateComponentTypes(const unsigned int* componentIDs, size_t numberOfComponents);
 
 	/**
-	 * Used internally for deleting a component given a component type and index.
+	 * Used internally for dispatching the make entity event for entities of the same archetype.
 	 * 
-	 * @param componentID The ID of the component type being deleted.
-	 * @param index The index of the component in the components vector/array.
+	 * @param archetype The archetype of the entities.
+	 * @param handles Handles to the new entities.
+	 * @param count The number of entities.
 	 */
-	void DeleteComponent(unsigned int componentID, unsigned int index);
+	void NotifyMakeEntities(ECSArchetype* archetype, const EntityHandle* handles, size_t count);
+
+	/**
+	 * Used internally for constructing an entity in a slot which has already been allocated, and
+	 * dispatching the make entity event.
+	 * 
+	 * @param handle Handle to the allocated slot.
+	 * @param archetype The archetype of the entity's component types.
+	 * @param entityComponents The components attached to the entity.
+	 * @param componentIDs The types of the components being added.
+	 * @param numberOfComponents The number of components being added.
+	 */
+	void ConstructEntity(EntityHandle handle, ECSArchetype* archetype,
+		BaseECSComponent** entityComponents, const unsigned int* componentIDs,
+		size_t numberOfComponents);
+
+	/**
+	 * Used internally for getting the pool of a component type with a stable address, creating
+	 * it if it does not exist yet.
+	 * 
+	 * @param componentID ID of the component type.
+	 * @return The component pool.
+	 */
+	ECSComponentPool* GetComponentPool(unsigned int componentID);
+
+	/**
+	 * Used internally for finding every listener which should be notified of entity events of an
+	 * archetype, and caching them in the archetype.
+	 * 
+	 * @param archetype The archetype to update.
+	 */
+	void UpdateEntityListeners(ECSArchetype* archetype);
+
+	/**
+	 * Used internally for finding the archetype of a set of component types. The archetype is
+	 * created if it does not exist yet.
+	 * 
+	 * @param componentTypes The IDs of the component types, sorted in ascending order.
+	 * @return The archetype.
+	 */
+	ECSArchetype* FindOrCreateArchetype(const std::vector<unsigned int>& componentTypes);
+
+	/**
+	 * Used internally for finding the query of a set of component types. The query is created,
+	 * and filled with every matching archetype, if it does not exist yet.
+	 * 
+	 * @param componentTypes The IDs of the component types, sorted in ascending order.
+	 * @return The query.
+	 */
+	ECSQuery* FindOrCreateQuery(const std::vector<unsigned int>& componentTypes);
+
+	/**
+	 * Used internally for moving an entity to another archetype. Components of the types shared
+	 * by both archetypes are moved to the new archetype. Components of the types which the
+	 * destination archetype does not have must already be freed, and components of the types 
+	 * which the source archetype does not have are left uninitialized.
+	 * 
+	 * @param entity The entity to move.
+	 * @param destination The archetype to move the entity to.
+	 */
+	void MoveEntity(EntityInternal& entity, ECSArchetype* destination);
 
 	/**
 	 * Used internally for removing a component from an entity.
@@ -404,58 +875,56 @@ private:
 	 * This is the non-templated version which all templated methods call.
 	 * 
 	 * @param handle The handle of the target entity.
-	 * @param entity Reference to the entity to attach the component to.
 	 * @param componentID ID of the component type being added.
 	 * @param component Pointer to the component being added.
 	 */
-	void AddComponentInternal(EntityHandle handle,
-		std::vector<std::pair<unsigned int, unsigned int>>& entity, unsigned int componentID,
+	void AddComponentInternal(EntityHandle handle, unsigned int componentID,
 		BaseECSComponent* component);
 
 	/**
 	 * Used internally for getting a component from an entity, given a component type ID.
 	 * 
-	 * @param entityComponents The list of components attached to the entity.
-	 * @param array Component type memory to lookup.
+	 * @param entity The entity to get the component from.
 	 * @param componentID ID of the component type to get.
 	 * @return Pointer to the requested component. Returns nullptr if the component is not found.
 	 */
-	BaseECSComponent* GetComponentInternal(
-		std::vector<std::pair<unsigned int, unsigned int>>& entityComponents,
-		std::vector<unsigned char>& array, unsigned int componentID);
+	BaseECSComponent* GetComponentInternal(EntityInternal& entity, unsigned int componentID);
 
 	/**
-	 * Used internally for updating a system with multiple components.
+	 * Used internally for keeping every change tick within MAX_CHANGE_TICK_AGE of the current
+	 * tick, so that old ticks are not mistaken for new ones once the tick wraps around. Only does
+	 * anything every CLAMP_CHANGE_TICKS_INTERVAL ticks. Must not be called while systems are
+	 * being updated.
+	 */
+	void ClampChangeTicks();
+
+	/**
+	 * Used internally for updating a system with every archetype of it's query.
 	 * 
-	 * @param index Index of the system in the systems list to update.
-	 * @param systems The systems list, used for looking up the system to update.
+	 * @param system The system to update.
+	 * @param deltaTime How much time has passed since the previous update.
+	 * @param threadPool If not nullptr and the system is parallel, the chunks the system is
+	 *		working with are updated on the thread pool.
+	 */
+	void UpdateSystem(BaseECSSystem& system, float deltaTime, ECSThreadPool* threadPool);
+
+	/**
+	 * Used internally for updating a system with all entities stored in a chunk. The chunk's
+	 * archetype must have every non-optional component type of the system.
+	 * 
+	 * @param system The system to update.
+	 * @param archetype The archetype which the chunk belongs to.
+	 * @param chunk The chunk to update the system with.
 	 * @param deltaTime How much time has passed since the previous update.
-	 * @param componentTypes The component types with which the system is working with.
 	 * @param componentStorage Vector reference used to avoid repeatedly allocating and
-	 *		deallocating every time the	function is called. Used for storing pointers to the 
-	 *		components of an entity, which are passed on if the entity contains the non-optional
-	 *		components with which the system is working with.
-	 * @param componentArrays Vector reference used to avoid repeatedly allocating and
-	 *		deallocating every time the	function is called. Used for storing the location of the
-	 *		 memory/data for components.
-	 */
-	void UpdateSystemWithMultipleComponents(unsigned int index, ECSSystemList& systems,
-		float deltaTime, const std::vector<unsigned int>& componentTypes,
-		std::vector<BaseECSComponent*>& componentStorage,
-		std::vector<std::vector<unsigned char>*>& componentArrays);
-
-	/**
-	 * Finds the least commonly occuring component from the list of component types specified. 
-	 * Optional components will be ignored.
-	 * 
-	 * @param componentTypes The component types to check.
-	 * @param componentFlags The flags for each component type specified.
-	 * @see BaseECSSystem::FLAG_OPTIONAL
-	 * @return The index, in the passed in array of component types, of the least commonly 
-	 *		occuring component.
-	 */
-	unsigned int FindLeastCommonComponent(const std::vector<unsigned int>& componentTypes,
-		const std::vector<unsigned int>& componentFlags);
+	 *		deallocating every time the	function is called. Used for storing the spans of the
+	 *		chunk's columns, which are passed on to the system.
+	 * @param lastRunTick The change tick at which the system was previously updated.
+	 * @param tick The change tick of this update of the system.
+	 */
+	void UpdateSystemWithChunk(BaseECSSystem& system, ECSArchetype& archetype, ECSChunk& chunk,
+		float deltaTime, std::vector<ECSComponentSpan>& componentStorage, uint32_t lastRunTick,
+		uint32_t tick);
 
 	// Disallow copy and assign
 	ECS(const ECS& other) = delete;
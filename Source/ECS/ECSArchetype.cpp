@@ -0,0 +1,449 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#include "ECSArchetype.h"
+
+#include <algorithm> // std::min
+#include <cstring> // std::memcpy, std::memset
+#include <new> // std::align_val_t
+
+/**
+ * Rounds a byte offset up to the next multiple of the column alignment.
+ *
+ * @param offset The offset to round.
+ * @return The aligned offset.
+ */
+static inline size_t AlignColumn(size_t offset)
+{
+	return (offset + ECSArchetype::COLUMN_ALIGNMENT - 1) & ~(ECSArchetype::COLUMN_ALIGNMENT - 1);
+}
+
+ECSArchetype::ECSArchetype(const std::vector<unsigned int>& componentTypes,
+	const std::vector<ECSComponentPool*>& pools) : componentTypes(componentTypes), pools(pools)
+{
+	// The size of a single row; every component of the entity and it's change tick, plus the
+	// entity's handle
+	size_t rowSize = sizeof(EntityHandle);
+
+	fieldOffsets.resize(componentTypes.size());
+
+	for (unsigned int column = 0; column < componentTypes.size(); column++)
+	{
+		const std::vector<ECSField>& fields = BaseECSComponent::GetTypeFields(componentTypes[column]);
+
+		// Pooled columns only store a pointer to each component, and struct of arrays columns
+		// only store the fields
+		size_t size = BaseECSComponent::GetTypeSize(componentTypes[column]);
+		if (pools[column] != nullptr)
+		{
+			size = sizeof(BaseECSComponent*);
+		}
+		else if (!fields.empty())
+		{
+			size = 0;
+			for (const ECSField& field : fields)
+			{
+				size += field.size;
+			}
+			fieldOffsets[column].resize(fields.size());
+		}
+
+		componentSizes.push_back(size);
+		rowSize += componentSizes.back() + sizeof(uint32_t);
+	}
+
+	// Build the lookup from component ID to column
+	// Component types are sorted, so the last one has the highest ID
+	if (!componentTypes.empty())
+	{
+		columnLookup.resize(componentTypes.back() + 1, -1);
+	}
+	for (unsigned int column = 0; column < componentTypes.size(); column++)
+	{
+		columnLookup[componentTypes[column]] = (int)column;
+		signature.set(componentTypes[column]);
+	}
+
+	columnOffsets.resize(componentTypes.size());
+
+	// Find the number of rows which fit in a chunk. Start with an estimate ignoring the padding
+	// between columns, and decrease it until the padded layout fits.
+	unsigned int capacity = (unsigned int)(CHUNK_SIZE / rowSize);
+	while (capacity > 1 && ComputeLayout(capacity) > CHUNK_SIZE)
+	{
+		capacity--;
+	}
+
+	// A single row may be larger than the target chunk size, in which case a chunk holds a
+	// single entity and is sized to fit it
+	if (capacity == 0)
+	{
+		capacity = 1;
+	}
+
+	chunkCapacity = capacity;
+	chunkSize = ComputeLayout(capacity);
+}
+
+ECSArchetype::~ECSArchetype()
+{
+	// Free every component still stored in the archetype
+	for (unsigned int row = 0; row < numEntities; row++)
+	{
+		for (unsigned int column = 0; column < componentTypes.size(); column++)
+		{
+			FreeComponent(row, column);
+		}
+	}
+
+	for (ECSChunk& chunk : chunks)
+	{
+		::operator delete(chunk.memory, std::align_val_t(COLUMN_ALIGNMENT));
+	}
+}
+
+unsigned int ECSArchetype::AddRow(EntityHandle handle)
+{
+	unsigned int row = (unsigned int)numEntities;
+	size_t chunkIndex = row / chunkCapacity;
+
+	// If every chunk is full, allocate a new one
+	// Existing chunks are never moved, so components already stored stay where they are
+	if (chunkIndex == chunks.size())
+	{
+		AllocateChunk();
+	}
+
+	ECSChunk& chunk = chunks[chunkIndex];
+	GetEntities(chunk)[chunk.size] = handle;
+	chunk.size++;
+	chunk.version++;
+	numEntities++;
+
+	return row;
+}
+
+unsigned int ECSArchetype::AddRows(const EntityHandle* handles, size_t count)
+{
+	unsigned int firstRow = (unsigned int)numEntities;
+	Reserve(numEntities + count);
+
+	// Fill the last chunk, then every following chunk, with a single copy each
+	while (count > 0)
+	{
+		ECSChunk& chunk = chunks[numEntities / chunkCapacity];
+		unsigned int run = (unsigned int)std::min<size_t>(count, chunkCapacity - chunk.size);
+
+		std::memcpy(GetEntities(chunk) + chunk.size, handles, run * sizeof(EntityHandle));
+		chunk.size += run;
+		chunk.version++;
+		numEntities += run;
+
+		handles += run;
+		count -= run;
+	}
+
+	return firstRow;
+}
+
+void ECSArchetype::CopyComponents(unsigned int firstRow, unsigned int column,
+	const unsigned char* components, size_t count)
+{
+	unsigned int componentID = componentTypes[column];
+	size_t componentSize = BaseECSComponent::GetTypeSize(componentID);
+
+	// Pooled components are allocated one at a time
+	if (pools[column] != nullptr)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			ConstructComponent(firstRow + i, column, GetEntity(firstRow + i),
+				(BaseECSComponent*)(components + i * componentSize));
+		}
+		return;
+	}
+
+	const std::vector<ECSField>& fields = BaseECSComponent::GetTypeFields(componentID);
+
+	// Copy the part of the range stored in each chunk
+	size_t copied = 0;
+	while (copied < count)
+	{
+		unsigned int row = firstRow + (unsigned int)copied;
+		const ECSChunk& chunk = chunks[row / chunkCapacity];
+		unsigned int index = row % chunkCapacity;
+		size_t run = std::min<size_t>(count - copied, chunkCapacity - index);
+
+		if (IsColumnSoA(column))
+		{
+			// The array of each field follows the array of the previous field
+			const unsigned char* fieldArray = components;
+			for (size_t i = 0; i < fields.size(); i++)
+			{
+				std::memcpy(chunk.memory + fieldOffsets[column][i] + index * fields[i].size,
+					fieldArray + copied * fields[i].size, run * fields[i].size);
+				fieldArray += count * fields[i].size;
+			}
+		}
+		else
+		{
+			std::memcpy(GetColumnData(chunk, column) + index * componentSize,
+				components + copied * componentSize, run * componentSize);
+		}
+
+		copied += run;
+	}
+}
+
+void ECSArchetype::Reserve(size_t numRows)
+{
+	size_t numChunks = (numRows + chunkCapacity - 1) / chunkCapacity;
+	chunks.reserve(numChunks);
+
+	// Chunks past the last row are left empty, and filled by AddRow in order
+	while (chunks.size() < numChunks)
+	{
+		AllocateChunk();
+	}
+}
+
+ECSComponentSpan ECSArchetype::GetColumnSpan(const ECSChunk& chunk, unsigned int column) const
+{
+	ECSComponentSpan span;
+
+	if (IsColumnSoA(column))
+	{
+		const std::vector<ECSField>& fields = BaseECSComponent::GetTypeFields(componentTypes[column]);
+
+		span.data = chunk.memory;
+		span.stride = BaseECSComponent::GetTypeSize(componentTypes[column]);
+		span.fields = fields.data();
+		span.fieldOffsets = fieldOffsets[column].data();
+		span.numFields = (unsigned int)fields.size();
+		span.entities = GetEntities(chunk);
+	}
+	else
+	{
+		span.data = GetColumnData(chunk, column);
+		span.stride = componentSizes[column];
+		span.isIndirect = pools[column] != nullptr;
+	}
+
+	return span;
+}
+
+void ECSArchetype::ConstructComponent(unsigned int row, unsigned int column, EntityHandle entity,
+	BaseECSComponent* component)
+{
+	// Components stored as a struct of arrays are trivially copyable, so copying their fields is
+	// the same as copy constructing them
+	if (IsColumnSoA(column))
+	{
+		GetComponentSpan(row, column).Scatter(0, component);
+		return;
+	}
+
+	unsigned char* slot = GetSlot(row, column);
+	void* memory = slot;
+
+	if (pools[column] != nullptr)
+	{
+		memory = pools[column]->Allocate();
+		*(void**)slot = memory;
+	}
+
+	BaseECSComponent::GetTypeCreateFunction(componentTypes[column])(memory, entity, component);
+}
+
+void ECSArchetype::FreeComponent(unsigned int row, unsigned int column)
+{
+	// Components stored as a struct of arrays are trivially destructible
+	if (IsColumnSoA(column))
+	{
+		return;
+	}
+
+	BaseECSComponent* component = GetComponent(row, column);
+	BaseECSComponent::GetTypeFreeFunction(componentTypes[column])(component);
+
+	if (pools[column] != nullptr)
+	{
+		pools[column]->Free(component);
+	}
+}
+
+void ECSArchetype::RelocateComponent(unsigned int row, unsigned int column, ECSArchetype& source,
+	unsigned int sourceRow, unsigned int sourceColumn)
+{
+	// Every field of a struct of arrays component is copied separately
+	if (IsColumnSoA(column))
+	{
+		ECSComponentSpan destinationSpan = GetComponentSpan(row, column);
+		ECSComponentSpan sourceSpan = source.GetComponentSpan(sourceRow, sourceColumn);
+
+		for (unsigned int i = 0; i < destinationSpan.numFields; i++)
+		{
+			std::memcpy(destinationSpan.GetField<unsigned char>(i),
+				sourceSpan.GetField<unsigned char>(i), destinationSpan.fields[i].size);
+		}
+		return;
+	}
+
+	unsigned char* destination = GetSlot(row, column);
+	unsigned char* original = source.GetSlot(sourceRow, sourceColumn);
+
+	// Pooled components stay where they are; only the pointer to them moves
+	// Both archetypes store the same component type, so they share the same pool
+	if (pools[column] != nullptr)
+	{
+		*(BaseECSComponent**)destination = *(BaseECSComponent**)original;
+	}
+	else
+	{
+		BaseECSComponent::GetTypeRelocateFunction(componentTypes[column])(destination,
+			(BaseECSComponent*)original);
+	}
+}
+
+EntityHandle ECSArchetype::RemoveRow(unsigned int row, bool shouldFreeComponents)
+{
+	// The naive way of removing the row would be to shift every row after it. However, because
+	// the order of the rows is irrelevant, we can move the last row of the archetype into the
+	// row being removed. This keeps every chunk except the last one full.
+
+	unsigned int lastRow = (unsigned int)numEntities - 1;
+
+	ECSChunk& chunk = chunks[row / chunkCapacity];
+	ECSChunk& lastChunk = chunks[lastRow / chunkCapacity];
+	unsigned int index = row % chunkCapacity;
+	unsigned int lastIndex = lastRow % chunkCapacity;
+
+	for (unsigned int column = 0; column < componentTypes.size(); column++)
+	{
+		if (shouldFreeComponents)
+		{
+			FreeComponent(row, column);
+		}
+
+		// Relocate the last component of the column, and copy it's change tick, into the hole
+		if (row != lastRow)
+		{
+			RelocateComponent(row, column, *this, lastRow, column);
+
+			GetChangeTicks(chunk, column)[index] = GetChangeTicks(lastChunk, column)[lastIndex];
+			uint32_t& columnTick = GetColumnChangeTicks(chunk)[column];
+			if (ECSIsTickNewer(GetChangeTicks(chunk, column)[index], columnTick))
+			{
+				columnTick = GetChangeTicks(chunk, column)[index];
+			}
+		}
+	}
+
+	EntityHandle movedEntity = nullptr;
+
+	if (row != lastRow)
+	{
+		movedEntity = GetEntities(lastChunk)[lastIndex];
+		GetEntities(chunk)[index] = movedEntity;
+	}
+
+	lastChunk.size--;
+	lastChunk.version++;
+	if (&chunk != &lastChunk)
+	{
+		chunk.version++;
+	}
+	numEntities--;
+
+	return movedEntity;
+}
+
+void ECSArchetype::Clear()
+{
+	for (unsigned int row = 0; row < numEntities; row++)
+	{
+		for (unsigned int column = 0; column < componentTypes.size(); column++)
+		{
+			FreeComponent(row, column);
+		}
+	}
+
+	for (ECSChunk& chunk : chunks)
+	{
+		if (chunk.size > 0)
+		{
+			chunk.size = 0;
+			chunk.version++;
+		}
+	}
+
+	numEntities = 0;
+}
+
+unsigned int ECSArchetype::AppendChunk(const unsigned char* memory, unsigned int size)
+{
+	unsigned int firstRow = (unsigned int)numEntities;
+	size_t chunkIndex = firstRow / chunkCapacity;
+
+	if (chunkIndex == chunks.size())
+	{
+		AllocateChunk();
+	}
+
+	// The copy includes the entity handles and change ticks of the rows
+	ECSChunk& chunk = chunks[chunkIndex];
+	std::memcpy(chunk.memory, memory, chunkSize);
+	chunk.size = size;
+	chunk.version++;
+	numEntities += size;
+
+	return firstRow;
+}
+
+size_t ECSArchetype::ComputeLayout(unsigned int capacity)
+{
+	size_t offset = 0;
+
+	// Lay out the columns one after another, each starting on an aligned boundary
+	for (unsigned int column = 0; column < componentTypes.size(); column++)
+	{
+		columnOffsets[column] = offset;
+
+		// Every field of a struct of arrays column is laid out as a column of it's own
+		if (IsColumnSoA(column))
+		{
+			const std::vector<ECSField>& fields =
+				BaseECSComponent::GetTypeFields(componentTypes[column]);
+
+			for (size_t i = 0; i < fields.size(); i++)
+			{
+				fieldOffsets[column][i] = offset;
+				offset = AlignColumn(offset + fields[i].size * capacity);
+			}
+			continue;
+		}
+
+		offset = AlignColumn(offset + componentSizes[column] * capacity);
+	}
+
+	entitiesOffset = offset;
+	offset = AlignColumn(offset + sizeof(EntityHandle) * capacity);
+
+	// The change ticks of every column follow, one after another, and the change ticks of the
+	// columns themselves come last
+	changeTicksOffset = offset;
+	offset += sizeof(uint32_t) * capacity * componentTypes.size();
+
+	columnChangeTicksOffset = offset;
+	return offset + sizeof(uint32_t) * componentTypes.size();
+}
+
+void ECSArchetype::AllocateChunk()
+{
+	ECSChunk chunk;
+	chunk.memory = (unsigned char*)::operator new(chunkSize, std::align_val_t(COLUMN_ALIGNMENT));
+
+	// Nothing in the chunk has changed yet
+	std::memset(GetColumnChangeTicks(chunk), 0, sizeof(uint32_t) * componentTypes.size());
+
+	chunks.push_back(chunk);
+}
@@ -0,0 +1,529 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#pragma once
+
+#include "ECSComponent.h"
+#include "ECSComponentPool.h"
+#include "ECSComponentSpan.h"
+
+#include <unordered_map>
+#include <vector>
+
+class ECSListener;
+
+/**
+ * Determines if a change tick is later than another. Ticks are 32-bit and wrap around, so they
+ * are compared by their distance rather than their value; a tick is later if it is less than
+ * half of the range of ticks after the other.
+ *
+ * @param tick The tick to check.
+ * @param other The tick to compare against, such as the tick at which a system last ran.
+ * @return If tick is later than other.
+ */
+inline bool ECSIsTickNewer(uint32_t tick, uint32_t other)
+{
+	return (int32_t)(tick - other) > 0;
+}
+
+/**
+ * @brief A fixed-size block of memory which stores the components of entities sharing the same
+ * archetype.
+ *
+ * Every component type of the archetype is stored as a contiguous column inside of the chunk,
+ * followed by a column holding the handles of the entities. Row i of every column belongs to the
+ * same entity.
+ *
+ * The chunk also stores a change tick for every component, which is the tick at which the
+ * component was last changed, along with the latest change tick of every column. Systems which
+ * only process changed components can skip entire chunks by looking at the column ticks. Ticks
+ * are compared with ECSIsTickNewer, since they wrap around.
+ *
+ * Changes to which rows the chunk stores are not tracked by the change ticks; the version of the
+ * chunk is incremented every time a row is added to or removed from it instead.
+ */
+struct ECSChunk
+{
+	// Raw memory of the chunk
+	unsigned char* memory = nullptr;
+
+	// The number of entities currently stored in the chunk
+	unsigned int size = 0;
+
+	// Incremented every time the rows of the chunk change
+	uint32_t version = 0;
+};
+
+/**
+ * @brief Storage for all entities which have the exact same set of component types.
+ *
+ * Entities are stored in fixed-size chunks, with one column per component type. This allows a
+ * system to walk the components of every matching entity linearly, without having to look up
+ * each of an entity's components individually.
+ *
+ * Rows are kept tightly packed; every chunk is full except for the last one. Removing a row moves
+ * the last row of the archetype into the hole.
+ *
+ * Component types with a stable address are stored in a component pool instead, and their column
+ * holds a pointer to each component. Moving a row then only moves the pointer.
+ *
+ * Component types stored as a struct of arrays have one array per field in every chunk, rather
+ * than a single column of whole components.
+ */
+class ECSArchetype
+{
+public:
+	// The target size of a chunk in bytes
+	static constexpr size_t CHUNK_SIZE = 16 * 1024;
+
+	// Alignment of each column inside of a chunk; keeps every column on its own cache line
+	static constexpr size_t COLUMN_ALIGNMENT = 64;
+
+	/**
+	 * @param componentTypes The IDs of the component types of the archetype, sorted in
+	 *		ascending order and without duplicates.
+	 * @param pools The component pool storing the components of each column, or nullptr for
+	 *		columns storing the components directly. Indices correspond to those of the component
+	 *		types array.
+	 */
+	ECSArchetype(const std::vector<unsigned int>& componentTypes,
+		const std::vector<ECSComponentPool*>& pools);
+
+	// Frees every component still stored in the archetype, and all chunk memory
+	~ECSArchetype();
+
+	/** @brief Gets the sorted IDs of the component types of the archetype. */
+	inline const std::vector<unsigned int>& GetComponentTypes() const { return componentTypes; }
+
+	/** @brief Gets the component types of the archetype as a signature. */
+	inline const ECSComponentSignature& GetSignature() const { return signature; }
+
+	/**
+	 * Gets the column which stores a given component type. This is a constant time lookup.
+	 *
+	 * @param componentID The ID of the component type.
+	 * @return The index of the column, or -1 if the archetype does not have the component type.
+	 */
+	inline int GetColumn(unsigned int componentID) const
+	{
+		return componentID < columnLookup.size() ? columnLookup[componentID] : -1;
+	}
+
+	/** @brief Determines if the archetype has a given component type. */
+	inline bool HasComponentType(unsigned int componentID) const
+	{
+		return GetColumn(componentID) != -1;
+	}
+
+	/** @brief Gets the maximum number of entities that fit in a single chunk. */
+	inline unsigned int GetChunkCapacity() const { return chunkCapacity; }
+
+	/** @brief Gets the size in bytes of every chunk allocated by the archetype. */
+	inline size_t GetChunkMemorySize() const { return chunkSize; }
+
+	/** @brief Gets the number of chunks allocated by the archetype. */
+	inline size_t GetNumChunks() const { return chunks.size(); }
+
+	/** @brief Gets the chunk at the specified index. */
+	inline ECSChunk& GetChunk(size_t index) { return chunks[index]; }
+	inline const ECSChunk& GetChunk(size_t index) const { return chunks[index]; }
+
+	/** @brief Gets the number of entities stored in the archetype. */
+	inline size_t size() const { return numEntities; }
+
+	/**
+	 * Determines if the components of a column are stored in a component pool, in which case the
+	 * column stores pointers to the components.
+	 */
+	inline bool IsColumnPooled(unsigned int column) const { return pools[column] != nullptr; }
+
+	/** @brief Determines if the components of a column are stored as a struct of arrays. */
+	inline bool IsColumnSoA(unsigned int column) const { return !fieldOffsets[column].empty(); }
+
+	/**
+	 * Gets the span of every component of a column in a chunk.
+	 *
+	 * @param chunk The chunk to look in.
+	 * @param column The index of the column.
+	 * @return The span, starting at the first row of the chunk.
+	 */
+	ECSComponentSpan GetColumnSpan(const ECSChunk& chunk, unsigned int column) const;
+
+	/**
+	 * Gets the start of a column in a chunk.
+	 *
+	 * @param chunk The chunk to look in.
+	 * @param column The index of the column.
+	 * @return Pointer to the first component of the column, or to the first pointer to a
+	 *		component if the column is pooled, or to the array of the first field if the column is
+	 *		a struct of arrays.
+	 */
+	inline unsigned char* GetColumnData(const ECSChunk& chunk, unsigned int column) const
+	{
+		return chunk.memory + columnOffsets[column];
+	}
+
+	/** @brief Gets the column of entity handles in a chunk. */
+	inline EntityHandle* GetEntities(const ECSChunk& chunk) const
+	{
+		return (EntityHandle*)(chunk.memory + entitiesOffset);
+	}
+
+	/**
+	 * Gets the change ticks of a column in a chunk; one tick per row.
+	 *
+	 * @param chunk The chunk to look in.
+	 * @param column The index of the column.
+	 * @return Pointer to the change tick of the first row.
+	 */
+	inline uint32_t* GetChangeTicks(const ECSChunk& chunk, unsigned int column) const
+	{
+		return (uint32_t*)(chunk.memory + changeTicksOffset) + column * chunkCapacity;
+	}
+
+	/**
+	 * Gets the latest change tick of every column in a chunk. No row of a column has a change
+	 * tick later than the column's tick.
+	 *
+	 * @param chunk The chunk to look in.
+	 * @return Pointer to the tick of the first column.
+	 */
+	inline uint32_t* GetColumnChangeTicks(const ECSChunk& chunk) const
+	{
+		return (uint32_t*)(chunk.memory + columnChangeTicksOffset);
+	}
+
+	/**
+	 * Marks a component of the entity stored at a given row as changed.
+	 *
+	 * @param row The row of the entity in the archetype.
+	 * @param column The column of the component type.
+	 * @param tick The change tick to mark the component with.
+	 */
+	inline void MarkChanged(unsigned int row, unsigned int column, uint32_t tick)
+	{
+		const ECSChunk& chunk = chunks[row / chunkCapacity];
+		GetChangeTicks(chunk, column)[row % chunkCapacity] = tick;
+
+		// The tick of a column with a single row is that row's tick, whatever the column held
+		// before the chunk was refilled
+		uint32_t& columnTick = GetColumnChangeTicks(chunk)[column];
+		if (chunk.size == 1 || ECSIsTickNewer(tick, columnTick))
+		{
+			columnTick = tick;
+		}
+	}
+
+	/**
+	 * Marks a run of components of a column in a chunk as changed.
+	 *
+	 * @param chunk The chunk to mark.
+	 * @param column The column of the component type.
+	 * @param first The first row in the chunk to mark.
+	 * @param count The number of rows to mark.
+	 * @param tick The change tick to mark the components with.
+	 */
+	inline void MarkChanged(const ECSChunk& chunk, unsigned int column, unsigned int first,
+		unsigned int count, uint32_t tick)
+	{
+		uint32_t* changeTicks = GetChangeTicks(chunk, column) + first;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			changeTicks[i] = tick;
+		}
+
+		uint32_t& columnTick = GetColumnChangeTicks(chunk)[column];
+		if (count > 0 && (count == chunk.size || ECSIsTickNewer(tick, columnTick)))
+		{
+			columnTick = tick;
+		}
+	}
+
+	/**
+	 * Gets the change tick of a component of the entity stored at a given row.
+	 *
+	 * @param row The row of the entity in the archetype.
+	 * @param column The column of the component type.
+	 * @return The tick at which the component was last changed.
+	 */
+	inline uint32_t GetChangeTick(unsigned int row, unsigned int column)
+	{
+		return GetChangeTicks(chunks[row / chunkCapacity], column)[row % chunkCapacity];
+	}
+
+	/**
+	 * Gets a component of the entity stored at a given row.
+	 *
+	 * @param row The row of the entity in the archetype.
+	 * @param column The column of the component type.
+	 * @return Pointer to the component, or nullptr if the column is a struct of arrays.
+	 */
+	inline BaseECSComponent* GetComponent(unsigned int row, unsigned int column)
+	{
+		if (IsColumnSoA(column))
+		{
+			return nullptr;
+		}
+
+		unsigned char* slot = GetSlot(row, column);
+		return pools[column] != nullptr ? *(BaseECSComponent**)slot : (BaseECSComponent*)slot;
+	}
+
+	/**
+	 * Gets the span of a single component of the entity stored at a given row.
+	 *
+	 * @param row The row of the entity in the archetype.
+	 * @param column The column of the component type.
+	 * @return Span whose first element is the component.
+	 */
+	inline ECSComponentSpan GetComponentSpan(unsigned int row, unsigned int column) const
+	{
+		ECSComponentSpan span = GetColumnSpan(chunks[row / chunkCapacity], column);
+		span.Advance(row % chunkCapacity);
+		return span;
+	}
+
+	/**
+	 * Constructs a new component of the entity stored at a given row, as a copy of another
+	 * component. The row must not hold a component in that column yet.
+	 *
+	 * @param row The row of the entity in the archetype.
+	 * @param column The column of the component type.
+	 * @param entity Handle to the entity which the component is attached to.
+	 * @param component The component to copy.
+	 */
+	void ConstructComponent(unsigned int row, unsigned int column, EntityHandle entity,
+		BaseECSComponent* component);
+
+	/**
+	 * Frees a component of the entity stored at a given row. Afterwards, the row no longer holds
+	 * a component in that column.
+	 *
+	 * @param row The row of the entity in the archetype.
+	 * @param column The column of the component type.
+	 */
+	void FreeComponent(unsigned int row, unsigned int column);
+
+	/**
+	 * Relocates a component from a row of an archetype into a row of this archetype, which must
+	 * not hold a component in that column. Afterwards, the source row no longer holds a component
+	 * in that column.
+	 *
+	 * @param row The row to relocate the component into.
+	 * @param column The column of the component type in this archetype.
+	 * @param source The archetype to relocate the component from; may be this archetype.
+	 * @param sourceRow The row to relocate the component from.
+	 * @param sourceColumn The column of the component type in the source archetype.
+	 */
+	void RelocateComponent(unsigned int row, unsigned int column, ECSArchetype& source,
+		unsigned int sourceRow, unsigned int sourceColumn);
+
+	/** @brief Gets the handle of the entity stored at a given row. */
+	inline EntityHandle GetEntity(unsigned int row)
+	{
+		return GetEntities(chunks[row / chunkCapacity])[row % chunkCapacity];
+	}
+
+	/**
+	 * Appends a row to the archetype, allocating a new chunk if the last one is full. The memory
+	 * for the components of the row is left uninitialized; the caller must construct them.
+	 *
+	 * @param handle Handle to the entity the row belongs to.
+	 * @return The index of the new row.
+	 */
+	unsigned int AddRow(EntityHandle handle);
+
+	/**
+	 * Appends many rows to the archetype at once, filling each chunk with a single copy of the
+	 * entity handles. The memory for the components of the rows is left uninitialized; the caller
+	 * must construct them.
+	 *
+	 * @param handles Handles to the entities the rows belong to.
+	 * @param count The number of rows to append.
+	 * @return The index of the first new row.
+	 */
+	unsigned int AddRows(const EntityHandle* handles, size_t count);
+
+	/**
+	 * Constructs the components of a column for a range of rows by copying their bytes, a whole
+	 * chunk at a time. The component type must be trivially copyable, and the rows must not hold a
+	 * component in that column yet.
+	 *
+	 * @param firstRow The first row to construct a component for.
+	 * @param column The column of the component type.
+	 * @param components The components to copy, one after another. For struct of arrays columns,
+	 *		the array of every field of the components instead, one after another.
+	 * @param count The number of components to copy.
+	 */
+	void CopyComponents(unsigned int firstRow, unsigned int column, const unsigned char* components,
+		size_t count);
+
+	/**
+	 * Allocates enough chunks to store a number of entities, so that adding rows up to that
+	 * number does not allocate.
+	 *
+	 * @param numRows The total number of entities to reserve storage for.
+	 */
+	void Reserve(size_t numRows);
+
+	/**
+	 * Removes a row from the archetype. The last row of the archetype is moved into the hole, so
+	 * that the rows are kept tightly packed.
+	 *
+	 * @param row The index of the row to remove.
+	 * @param shouldFreeComponents If true, the components of the row are freed. Otherwise the
+	 *		caller is expected to have relocated or freed them already.
+	 * @return Handle to the entity which was moved into the removed row, or nullptr if no entity
+	 *		was moved.
+	 */
+	EntityHandle RemoveRow(unsigned int row, bool shouldFreeComponents);
+
+	/**
+	 * Frees the components of every row and removes all rows from the archetype. Chunks are kept
+	 * for reuse.
+	 */
+	void Clear();
+
+	/**
+	 * Appends a chunk's worth of rows by copying the raw memory of a chunk of this archetype.
+	 * Every chunk before it must be full. Components which are not trivially copyable, and
+	 * components of pooled columns, are left uninitialized by the copy; the caller must construct
+	 * them.
+	 *
+	 * @param memory Copy of the memory of a chunk, GetChunkMemorySize() bytes large.
+	 * @param size The number of rows stored in the copied chunk.
+	 * @return The index of the first appended row.
+	 */
+	unsigned int AppendChunk(const unsigned char* memory, unsigned int size);
+
+	/**
+	 * Gets the archetype reached by adding a component type to this archetype. Edges are cached
+	 * so that moving an entity between archetypes does not require a lookup by component types.
+	 *
+	 * @param componentID ID of the component type being added.
+	 * @return The cached archetype, or nullptr if the edge has not been computed yet.
+	 */
+	inline ECSArchetype* GetAddEdge(unsigned int componentID) const
+	{
+		auto it = addEdges.find(componentID);
+		return it == addEdges.end() ? nullptr : it->second;
+	}
+
+	/**
+	 * Gets the archetype reached by removing a component type from this archetype.
+	 *
+	 * @see GetAddEdge
+	 *
+	 * @param componentID ID of the component type being removed.
+	 * @return The cached archetype, or nullptr if the edge has not been computed yet.
+	 */
+	inline ECSArchetype* GetRemoveEdge(unsigned int componentID) const
+	{
+		auto it = removeEdges.find(componentID);
+		return it == removeEdges.end() ? nullptr : it->second;
+	}
+
+	/** @brief Caches the archetype reached by adding a component type to this archetype. */
+	inline void SetAddEdge(unsigned int componentID, ECSArchetype* archetype)
+	{
+		addEdges[componentID] = archetype;
+	}
+
+	/** @brief Caches the archetype reached by removing a component type from this archetype. */
+	inline void SetRemoveEdge(unsigned int componentID, ECSArchetype* archetype)
+	{
+		removeEdges[componentID] = archetype;
+	}
+
+	/**
+	 * Gets the listeners which should be notified when an entity of this archetype is made or
+	 * removed. Kept up to date by the ECS, so that dispatching entity events does not need to
+	 * check every listener.
+	 *
+	 * @return Array of listeners, in the order they were added to the ECS.
+	 */
+	inline const std::vector<ECSListener*>& GetEntityListeners() const { return entityListeners; }
+
+	/** @brief Sets the listeners which should be notified of entity events of this archetype. */
+	inline void SetEntityListeners(std::vector<ECSListener*> listeners)
+	{
+		entityListeners = std::move(listeners);
+	}
+
+private:
+	// Sorted IDs of the component types stored in the archetype; index corresponds to column
+	std::vector<unsigned int> componentTypes;
+
+	// Sparse lookup array; index corresponds to component ID, and the value is the column storing
+	// that component type, or -1 if the archetype does not have the component type
+	// Only large enough to hold the highest component ID of the archetype
+	std::vector<int> columnLookup;
+
+	// One bit per component type of the archetype
+	ECSComponentSignature signature;
+
+	// Size in bytes of the component type stored in each column, or of a pointer if the column is
+	// pooled
+	std::vector<size_t> componentSizes;
+
+	// The component pool of each column, or nullptr if the column stores the components directly
+	std::vector<ECSComponentPool*> pools;
+
+	// Offset in bytes from the start of a chunk to the array of each field of each column; empty
+	// for columns which are not a struct of arrays
+	std::vector<std::vector<size_t>> fieldOffsets;
+
+	// Offset in bytes from the start of a chunk to the start of each column
+	std::vector<size_t> columnOffsets;
+
+	// Offset in bytes from the start of a chunk to the start of the entity handle column
+	size_t entitiesOffset = 0;
+
+	// Offset in bytes from the start of a chunk to the change ticks of the first column, and to
+	// the change ticks of the columns themselves
+	size_t changeTicksOffset = 0;
+	size_t columnChangeTicksOffset = 0;
+
+	// The size in bytes of every chunk allocated by the archetype
+	size_t chunkSize = 0;
+
+	// The number of entities which fit in a single chunk
+	unsigned int chunkCapacity = 0;
+
+	// Chunks are never freed once allocated, and are reused as entities come and go
+	std::vector<ECSChunk> chunks;
+
+	// The number of entities stored across all chunks
+	size_t numEntities = 0;
+
+	// Archetype graph; map<component ID, archetype>
+	std::unordered_map<unsigned int, ECSArchetype*> addEdges;
+	std::unordered_map<unsigned int, ECSArchetype*> removeEdges;
+
+	// The listeners interested in entities of this archetype
+	std::vector<ECSListener*> entityListeners;
+
+	/**
+	 * Computes the column offsets for a given chunk capacity.
+	 *
+	 * @param capacity The number of entities per chunk.
+	 * @return The number of bytes needed for a chunk with the given capacity.
+	 */
+	size_t ComputeLayout(unsigned int capacity);
+
+	/** @brief Allocates a new, empty chunk at the end of the archetype. */
+	void AllocateChunk();
+
+	/**
+	 * Gets the memory of a row in a column; the component itself, or the pointer to it if the
+	 * column is pooled.
+	 */
+	inline unsigned char* GetSlot(unsigned int row, unsigned int column)
+	{
+		return GetColumnData(chunks[row / chunkCapacity], column) +
+			(row % chunkCapacity) * componentSizes[column];
+	}
+
+	// Disallow copy and assign
+	ECSArchetype(const ECSArchetype& other) = delete;
+	ECSArchetype& operator=(const ECSArchetype& other) = delete;
+};
@@ -0,0 +1,135 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#include "ECSCommandBuffer.h"
+#include "ECS.h"
+
+#include <algorithm> // std::sort
+#include <new> // std::align_val_t
+
+ECSCommandBuffer::~ECSCommandBuffer()
+{
+	Clear();
+
+	for (unsigned char* block : blocks)
+	{
+		::operator delete(block, std::align_val_t(COMPONENT_ALIGNMENT));
+	}
+}
+
+EntityHandle ECSCommandBuffer::MakeEntity(BaseECSComponent** entityComponents,
+	const unsigned int* componentIDs, size_t numberOfComponents)
+{
+	Command command;
+	command.type = Command::MAKE_ENTITY;
+	command.entity = ecs.ReserveEntity();
+	command.firstComponent = (unsigned int)components.size();
+	command.numComponents = (unsigned int)numberOfComponents;
+	command.componentID = 0;
+
+	for (size_t i = 0; i < numberOfComponents; i++)
+	{
+		CopyComponent(componentIDs[i], entityComponents[i]);
+	}
+
+	// Sort the components by type, so that entities with the same component types can be found
+	// when playing back
+	std::sort(components.begin() + command.firstComponent, components.end());
+
+	commands.push_back(command);
+	return command.entity;
+}
+
+void ECSCommandBuffer::RemoveEntity(EntityHandle handle)
+{
+	Command command;
+	command.type = Command::REMOVE_ENTITY;
+	command.entity = handle;
+	command.firstComponent = 0;
+	command.numComponents = 0;
+	command.componentID = 0;
+
+	commands.push_back(command);
+}
+
+void ECSCommandBuffer::AddComponent(EntityHandle handle, unsigned int componentID,
+	BaseECSComponent* component)
+{
+	Command command;
+	command.type = Command::ADD_COMPONENT;
+	command.entity = handle;
+	command.firstComponent = (unsigned int)components.size();
+	command.numComponents = 1;
+	command.componentID = componentID;
+
+	CopyComponent(componentID, component);
+
+	commands.push_back(command);
+}
+
+void ECSCommandBuffer::RemoveComponent(EntityHandle handle, unsigned int componentID)
+{
+	Command command;
+	command.type = Command::REMOVE_COMPONENT;
+	command.entity = handle;
+	command.firstComponent = 0;
+	command.numComponents = 0;
+	command.componentID = componentID;
+
+	commands.push_back(command);
+}
+
+void ECSCommandBuffer::CopyComponent(unsigned int componentID, BaseECSComponent* component)
+{
+	size_t size = BaseECSComponent::GetTypeSize(componentID);
+	unsigned char* memory;
+
+	// Components larger than a block get a block of their own
+	if (size > BLOCK_SIZE)
+	{
+		memory = (unsigned char*)::operator new(size, std::align_val_t(COMPONENT_ALIGNMENT));
+		largeBlocks.push_back(memory);
+	}
+	else
+	{
+		// Move on to the next block if the component does not fit in the current one
+		if (currentBlock < blocks.size() && blockOffset + size > BLOCK_SIZE)
+		{
+			currentBlock++;
+			blockOffset = 0;
+		}
+
+		if (currentBlock == blocks.size())
+		{
+			blocks.push_back((unsigned char*)::operator new(BLOCK_SIZE,
+				std::align_val_t(COMPONENT_ALIGNMENT)));
+		}
+
+		memory = blocks[currentBlock] + blockOffset;
+
+		// Keep the next component aligned
+		blockOffset = (blockOffset + size + COMPONENT_ALIGNMENT - 1) & ~(COMPONENT_ALIGNMENT - 1);
+	}
+
+	// The copy is not attached to any entity until it is played back
+	BaseECSComponent::GetTypeCreateFunction(componentID)(memory, nullptr, component);
+	components.push_back({ componentID, (BaseECSComponent*)memory });
+}
+
+void ECSCommandBuffer::Clear()
+{
+	for (auto& component : components)
+	{
+		BaseECSComponent::GetTypeFreeFunction(component.first)(component.second);
+	}
+
+	for (unsigned char* block : largeBlocks)
+	{
+		::operator delete(block, std::align_val_t(COMPONENT_ALIGNMENT));
+	}
+
+	commands.clear();
+	components.clear();
+	largeBlocks.clear();
+	currentBlock = 0;
+	blockOffset = 0;
+}
@@ -0,0 +1,185 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#pragma once
+
+#include "ECSComponent.h"
+
+#include <type_traits> // std::remove_reference_t
+#include <vector>
+
+class ECS;
+
+/**
+ * @brief Records changes to the structure of the ECS, so that they can be applied later.
+ *
+ * Making or removing entities, and adding or removing components, moves components between and
+ * within archetypes, which is not allowed while systems are iterating over them. Instead, systems
+ * record those changes into a command buffer, and the ECS plays back every command buffer at a
+ * sync point once all systems are done. Every thread has it's own command buffer, so recording
+ * never needs a lock, except for reserving the handle of an entity being made.
+ *
+ * Components passed to the command buffer are copied when recorded; the originals may be
+ * destroyed right away.
+ *
+ * @see ECS::GetCommandBuffer
+ * @see ECS::PlaybackCommandBuffers
+ */
+class ECSCommandBuffer
+{
+public:
+	/** @param ecs The ECS which the commands are played back into. */
+	ECSCommandBuffer(ECS& ecs) : ecs(ecs) {}
+
+	// Frees every component still stored in the command buffer, and all block memory
+	~ECSCommandBuffer();
+
+	/**
+	 * Records making an entity. Non-templated version.
+	 *
+	 * @param entityComponents The components attached to the entity.
+	 * @param componentIDs The types of the components being added.
+	 * @param numberOfComponents The number of components being added.
+	 * @return Handle to the entity. The handle is reserved right away, so it can be stored and
+	 *		passed to other commands, but the entity only exists once the command is played back.
+	 */
+	EntityHandle MakeEntity(BaseECSComponent** entityComponents, const unsigned int* componentIDs,
+		size_t numberOfComponents);
+
+	template<class... Components>
+	/**
+	 * Records making an entity.
+	 *
+	 * @see MakeEntity
+	 *
+	 * @param ...entityComponents The components attached to the entity.
+	 * @return Handle to the entity.
+	 */
+	EntityHandle MakeEntity(Components&... entityComponents)
+	{
+		BaseECSComponent* components[] = { (&entityComponents)... };
+		unsigned int componentIDs[] = { (std::remove_reference_t<Components>::ID)... };
+
+		return MakeEntity(components, componentIDs, sizeof...(Components));
+	}
+
+	/**
+	 * Records removing an entity.
+	 *
+	 * @param handle Handle to the entity to remove.
+	 */
+	void RemoveEntity(EntityHandle handle);
+
+	/**
+	 * Records adding a component to an entity. Non-templated version.
+	 *
+	 * @param handle Handle to the entity which the component should be attached to.
+	 * @param componentID ID of the component type being added.
+	 * @param component Pointer to the component to attach.
+	 */
+	void AddComponent(EntityHandle handle, unsigned int componentID, BaseECSComponent* component);
+
+	template<class Component>
+	/**
+	 * Records adding a component to an entity.
+	 *
+	 * @param handle Handle to the entity which the component should be attached to.
+	 * @param component Pointer to the component to attach.
+	 */
+	inline void AddComponent(EntityHandle handle, Component* component)
+	{
+		AddComponent(handle, Component::ID, component);
+	}
+
+	/**
+	 * Records removing a component from an entity. Non-templated version.
+	 *
+	 * @param handle Handle to the entity which the component will be removed from.
+	 * @param componentID ID of the component type being removed.
+	 */
+	void RemoveComponent(EntityHandle handle, unsigned int componentID);
+
+	template<class Component>
+	/**
+	 * Records removing a component from an entity.
+	 *
+	 * @param handle Handle to the entity which the component will be removed from.
+	 */
+	inline void RemoveComponent(EntityHandle handle)
+	{
+		RemoveComponent(handle, Component::ID);
+	}
+
+	/** @brief Determines if the command buffer has no commands to play back. */
+	inline bool IsEmpty() const { return commands.empty(); }
+
+private:
+	// Only the ECS plays back command buffers
+	friend class ECS;
+
+	/** @brief Used internally for storing a single recorded command. */
+	struct Command
+	{
+		enum Type
+		{
+			MAKE_ENTITY,
+			ADD_COMPONENT,
+			REMOVE_COMPONENT,
+			REMOVE_ENTITY
+		};
+
+		Type type;
+
+		// The entity the command applies to
+		EntityHandle entity;
+
+		// The components of the command, in the components array
+		// Sorted by component ID when making an entity
+		unsigned int firstComponent;
+		unsigned int numComponents;
+
+		// The component type being removed, for REMOVE_COMPONENT
+		unsigned int componentID;
+	};
+
+	// The size in bytes of a block of component memory
+	static constexpr size_t BLOCK_SIZE = 16 * 1024;
+
+	// Alignment of every component copied into a block
+	static constexpr size_t COMPONENT_ALIGNMENT = 16;
+
+	ECS& ecs;
+
+	std::vector<Command> commands;
+
+	// The components of every command; pair<component ID, copy of the component>
+	std::vector<std::pair<unsigned int, BaseECSComponent*>> components;
+
+	// Memory which the components are copied into. Blocks are never moved once allocated, so the
+	// copies stay valid while more commands are recorded, and are reused after every playback.
+	std::vector<unsigned char*> blocks;
+
+	// The block currently being filled, and the offset of the next free byte in it
+	size_t currentBlock = 0;
+	size_t blockOffset = 0;
+
+	// Blocks allocated for components too large to fit in a regular block; freed on playback
+	std::vector<unsigned char*> largeBlocks;
+
+	/**
+	 * Used internally for copying a component into the command buffer's memory.
+	 *
+	 * @param componentID ID of the component type.
+	 * @param component The component to copy.
+	 */
+	void CopyComponent(unsigned int componentID, BaseECSComponent* component);
+
+	/**
+	 * Used internally for freeing every recorded component and clearing all commands. Block
+	 * memory is kept for the next commands.
+	 */
+	void Clear();
+
+	// Disallow copy and assign
+	ECSCommandBuffer(const ECSCommandBuffer& other) = delete;
+	ECSCommandBuffer& operator=(const ECSCommandBuffer& other) = delete;
+};
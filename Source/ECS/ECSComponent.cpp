@@ -26,17 +26,34 @@
 
 #include "ECSComponent.h"
 
-std::vector<std::tuple<ECSComponentCreateFunction, ECSComponentFreeFunction, size_t>>*
-	BaseECSComponent::componentTypes;
+#include <iostream>
+
+#ifdef __GNUG__
+#include <cstdlib>
+#include <cxxabi.h>
+#else
+#include <cctype>
+#endif
+
+std::vector<ECSComponentTypeInfo>* BaseECSComponent::componentTypes;
 
 unsigned int BaseECSComponent::RegisterComponentType(ECSComponentCreateFunction createFunction, 
-	ECSComponentFreeFunction freeFunction, size_t size)
+	ECSComponentFreeFunction freeFunction, size_t size, ECSComponentMoveFunction moveFunction,
+	ECSComponentRelocateFunction relocateFunction, bool hasStableAddress,
+	std::vector<ECSField> fields, bool isTriviallyCopyable, uint64_t nameHash,
+	bool isSerializable, const char* name)
 {
 	// If the component types array has not been initialized
 	if (componentTypes == nullptr)
 	{
-		componentTypes = new std::vector<std::tuple<ECSComponentCreateFunction,
-			ECSComponentFreeFunction, size_t>>();
+		componentTypes = new std::vector<ECSComponentTypeInfo>();
+	}
+
+	// Component types past the maximum cannot be part of a signature, and are rejected when used
+	if (componentTypes->size() >= MAX_TYPES)
+	{
+		std::cerr << "Too many component types; at most " << MAX_TYPES << " can be registered."
+			<< std::endl;
 	}
 
 	// The ID starts at zero.
@@ -45,8 +62,55 @@ unsigned int BaseECSComponent::RegisterComponentType(ECSComponentCreateFunction
 	unsigned int componentID = componentTypes->size();
 	
 	// Add the component's parameters to the lookup array
-	componentTypes->push_back(std::tuple<ECSComponentCreateFunction, ECSComponentFreeFunction,
-		size_t>(createFunction, freeFunction, size));
+	ECSComponentTypeInfo info;
+	info.create = createFunction;
+	info.free = freeFunction;
+	info.move = moveFunction;
+	info.relocate = relocateFunction;
+	info.size = size;
+	info.hasStableAddress = hasStableAddress;
+	info.fields = std::move(fields);
+	info.isTriviallyCopyable = isTriviallyCopyable;
+	info.nameHash = nameHash;
+	info.isSerializable = isSerializable;
+	info.name = ECSDemangleTypeName(name);
+	componentTypes->push_back(std::move(info));
 
 	return componentID;
 }
+
+std::string ECSDemangleTypeName(const char* name)
+{
+#ifdef __GNUG__
+	int status = 0;
+	char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+	if (status != 0 || demangled == nullptr)
+	{
+		return name;
+	}
+
+	std::string result = demangled;
+	std::free(demangled);
+	return result;
+#else
+	std::string result = name;
+
+	// Template arguments are prefixed as well, e.g. "struct Foo<struct Bar>"
+	for (const char* prefix : { "struct ", "class ", "enum " })
+	{
+		const size_t length = std::strlen(prefix);
+		for (size_t i = result.find(prefix); i != std::string::npos; i = result.find(prefix, i))
+		{
+			// Only remove whole words, not the end of a longer name such as "substruct "
+			if (i > 0 && (std::isalnum((unsigned char)result[i - 1]) || result[i - 1] == '_'))
+			{
+				i += length;
+				continue;
+			}
+			result.erase(i, length);
+		}
+	}
+
+	return result;
+#endif
+}
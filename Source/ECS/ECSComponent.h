@@ -26,30 +26,163 @@
 
 #pragma once
 
-#include <tuple>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
 #include <vector>
 #include <utility>
 
 // Forward declaration of the struct for the typedefs below
 struct BaseECSComponent;
 
-/** @brief Used for refering to any entity. */
-typedef void* EntityHandle;
+/**
+ * @brief Used for refering to any entity.
+ *
+ * A handle is the index of the entity's slot in the ECS's entity table, along with the generation
+ * of the slot when the entity was made. Slots are reused once an entity is removed, and their
+ * generation is incremented when that happens, so a stale handle to a removed entity can be
+ * detected by comparing generations. Generation 0 is never used by an entity, which makes the
+ * default handle a null handle.
+ */
+struct EntityHandle
+{
+	// Index of the entity's slot in the entity table
+	uint32_t index = 0;
+
+	// Generation of the slot when the entity was made
+	uint32_t generation = 0;
+
+	constexpr EntityHandle() = default;
+
+	// Allows nullptr to be used as a null handle
+	constexpr EntityHandle(std::nullptr_t) {}
+
+	constexpr EntityHandle(uint32_t index, uint32_t generation) : index(index),
+		generation(generation) {}
+
+	constexpr bool operator==(const EntityHandle& other) const
+	{
+		return index == other.index && generation == other.generation;
+	}
+
+	constexpr bool operator!=(const EntityHandle& other) const
+	{
+		return !(*this == other);
+	}
+};
+
+namespace std
+{
+	/** @brief Allows entity handles to be used as keys of unordered containers. */
+	template<>
+	struct hash<EntityHandle>
+	{
+		size_t operator()(const EntityHandle& handle) const
+		{
+			return std::hash<uint64_t>()(((uint64_t)handle.generation << 32) | handle.index);
+		}
+	};
+}
 
 /** @brief Pointer to the component create function. */
-typedef unsigned int(*ECSComponentCreateFunction)(std::vector<unsigned char>& memory,
-	EntityHandle entity, BaseECSComponent* component);
+typedef void(*ECSComponentCreateFunction)(void* memory, EntityHandle entity,
+	BaseECSComponent* component);
 
 /** @brief Pointer to the component free function. */
 typedef void (*ECSComponentFreeFunction)(BaseECSComponent* component);
 
+/** @brief Pointer to the component move function. */
+typedef void (*ECSComponentMoveFunction)(void* memory, BaseECSComponent* component);
+
+/** @brief Pointer to the component relocate function. */
+typedef void (*ECSComponentRelocateFunction)(void* memory, BaseECSComponent* component);
+
+/**
+ * @brief A field of a component type which is stored as a struct of arrays.
+ *
+ * @see ECSSoAFields
+ */
+struct ECSField
+{
+	// Offset in bytes from the start of the component to the field
+	size_t offset = 0;
+
+	// Size in bytes of the field
+	size_t size = 0;
+
+	template<typename Component, typename T>
+	/**
+	 * Describes a field from a pointer to the member.
+	 *
+	 * @param member Pointer to the member of the component type, e.g. &MyComponent::position.
+	 * @return The field.
+	 */
+	static ECSField Of(T Component::* member)
+	{
+		// Component types are default constructible, so a temporary component is enough to
+		// find the offset of the member
+		Component component;
+
+		ECSField field;
+		field.offset = (size_t)((unsigned char*)&(component.*member) - (unsigned char*)&component);
+		field.size = sizeof(T);
+		return field;
+	}
+};
+
+/**
+ * @brief Everything the ECS needs to know about a component type at runtime.
+ *
+ * @see BaseECSComponent::RegisterComponentType
+ */
+struct ECSComponentTypeInfo
+{
+	ECSComponentCreateFunction create = nullptr;
+	ECSComponentFreeFunction free = nullptr;
+	ECSComponentMoveFunction move = nullptr;
+	ECSComponentRelocateFunction relocate = nullptr;
+
+	// Size in bytes of the component type
+	size_t size = 0;
+
+	// If components are stored in a component pool, so that their address never changes
+	bool hasStableAddress = false;
+
+	// The fields which components are split into when stored as a struct of arrays, or empty if
+	// components are stored as a whole
+	std::vector<ECSField> fields;
+
+	// If components can be copied by copying their bytes
+	bool isTriviallyCopyable = false;
+
+	// Hash of the name of the component type, which identifies the type in scene files
+	uint64_t nameHash = 0;
+
+	// If components are written to scene files
+	bool isSerializable = false;
+
+	// The readable name of the component type
+	std::string name;
+};
+
 /** @brief Base struct which components derive from. */
 struct BaseECSComponent
 {
 public:
+	// The maximum number of component types which can be registered; the size of a component
+	// signature
+	static constexpr unsigned int MAX_TYPES = 256;
+
 	/**
-	 * Registers a component's create function, free function, and size for future lookup. 
-	 * Determines the next available ID for the component type, and returns it.
+	 * Registers a component's create function, free function, size, move function and relocate
+	 * function for future lookup. Determines the next available ID for the component type, and
+	 * returns it.
 	 * 
 	 * @param createFunction Pointer to the component create function, which defines how to create
 	 *		the component at runtime.
@@ -59,10 +192,35 @@ public:
 	 * 
 	 * @param size The size of the component type in bytes.
 	 * 
+	 * @param moveFunction Pointer to the component move function, which defines how to move a
+	 *		component into uninitialized memory at runtime.
+	 * 
+	 * @param relocateFunction Pointer to the component relocate function, which defines how to
+	 *		move a component to another address at runtime, ending the lifetime of the original.
+	 * 
+	 * @param hasStableAddress If components of the type should be stored in a component pool, so
+	 *		that their address never changes.
+	 * 
+	 * @param fields The fields which components of the type are split into when stored as a
+	 *		struct of arrays, or an empty array to store the components as a whole.
+	 * 
+	 * @param isTriviallyCopyable If components of the type can be copied by copying their bytes.
+	 * 
+	 * @param nameHash Hash of the name of the component type, which identifies the type in scene
+	 *		files independently of the order in which component types are registered.
+	 * 
+	 * @param isSerializable If components of the type are written to scene files.
+	 * 
+	 * @param name The name of the component type, as reported by the compiler. It is demangled
+	 *		before being stored.
+	 * 
 	 * @return The component ID of the newly registered component type.
 	 */
 	static unsigned int RegisterComponentType(ECSComponentCreateFunction createFunction,
-		ECSComponentFreeFunction freeFunction, size_t size);
+		ECSComponentFreeFunction freeFunction, size_t size, ECSComponentMoveFunction moveFunction,
+		ECSComponentRelocateFunction relocateFunction, bool hasStableAddress,
+		std::vector<ECSField> fields, bool isTriviallyCopyable, uint64_t nameHash,
+		bool isSerializable, const char* name);
 
 	// The entity which the component is attached to
 	EntityHandle entity = nullptr;
@@ -75,7 +233,7 @@ public:
 	 */
 	inline static ECSComponentCreateFunction GetTypeCreateFunction(unsigned int id)
 	{
-		return std::get<0>((*componentTypes)[id]);
+		return (*componentTypes)[id].create;
 	}
 
 	/**
@@ -86,7 +244,29 @@ public:
 	 */
 	inline static ECSComponentFreeFunction GetTypeFreeFunction(unsigned int id)
 	{
-		return std::get<1>((*componentTypes)[id]);
+		return (*componentTypes)[id].free;
+	}
+
+	/**
+	 * Gets the component move function for a given component type.
+	 *
+	 * @param id The ID of the component type to look up.
+	 * @return The move function.
+	 */
+	inline static ECSComponentMoveFunction GetTypeMoveFunction(unsigned int id)
+	{
+		return (*componentTypes)[id].move;
+	}
+
+	/**
+	 * Gets the component relocate function for a given component type.
+	 *
+	 * @param id The ID of the component type to look up.
+	 * @return The relocate function.
+	 */
+	inline static ECSComponentRelocateFunction GetTypeRelocateFunction(unsigned int id)
+	{
+		return (*componentTypes)[id].relocate;
 	}
 
 	/**
@@ -97,7 +277,84 @@ public:
 	 */
 	inline static size_t GetTypeSize(unsigned int id)
 	{
-		return std::get<2>((*componentTypes)[id]);
+		return (*componentTypes)[id].size;
+	}
+
+	/**
+	 * Determines if components of a given component type are stored in a component pool, rather
+	 * than directly in the chunks of archetypes.
+	 *
+	 * @see ECSHasStableAddress
+	 *
+	 * @param id The ID of the component type to look up.
+	 * @return If components of the type never change address.
+	 */
+	inline static bool HasTypeStableAddress(unsigned int id)
+	{
+		return (*componentTypes)[id].hasStableAddress;
+	}
+
+	/**
+	 * Gets the fields which components of a given component type are split into.
+	 *
+	 * @see ECSSoAFields
+	 *
+	 * @param id The ID of the component type to look up.
+	 * @return Array of fields, which is empty if the components are stored as a whole.
+	 */
+	inline static const std::vector<ECSField>& GetTypeFields(unsigned int id)
+	{
+		return (*componentTypes)[id].fields;
+	}
+
+	/** @brief Determines if components of a given component type are stored as a struct of arrays. */
+	inline static bool IsTypeSoA(unsigned int id)
+	{
+		return !GetTypeFields(id).empty();
+	}
+
+	/**
+	 * @brief Determines if components of a given component type can be copied by copying their
+	 * bytes, without calling the create function.
+	 */
+	inline static bool IsTypeTriviallyCopyable(unsigned int id)
+	{
+		return (*componentTypes)[id].isTriviallyCopyable;
+	}
+
+	/**
+	 * Gets the hash of the name of a given component type.
+	 *
+	 * @param id The ID of the component type to look up.
+	 * @return The hash, which is the same for every run of the same build.
+	 */
+	inline static uint64_t GetTypeNameHash(unsigned int id)
+	{
+		return (*componentTypes)[id].nameHash;
+	}
+
+	/**
+	 * Determines if components of a given component type are written to scene files.
+	 *
+	 * @see ECSIsSerializable
+	 */
+	inline static bool IsTypeSerializable(unsigned int id)
+	{
+		return (*componentTypes)[id].isSerializable;
+	}
+
+	/**
+	 * Gets the name of a given component type. The name is compiler specific, and only meant for
+	 * reporting; use GetTypeNameHash for identifying component types.
+	 *
+	 * @see ECSDemangleTypeName
+	 *
+	 * @param id The ID of the component type to look up.
+	 * @return The name of the type.
+	 */
+	inline static const std::string& GetTypeName(unsigned int id)
+	{
+		return (*componentTypes)[id].name;
 	}
 
 	/**
@@ -105,16 +362,42 @@ public:
 	 */
 	inline static bool IsTypeValid(unsigned int id)
 	{
-		return id < componentTypes->size();
+		return id < componentTypes->size() && id < MAX_TYPES;
+	}
+
+	/** @brief Gets the number of registered component types. */
+	inline static unsigned int GetNumTypes()
+	{
+		return componentTypes == nullptr ? 0 : (unsigned int)componentTypes->size();
 	}
 
 private:
 	// Lookup array for all the parameters of a given component type, index corresponds to
 	// component ID. This gives us a global index of all component types at runtime.
-	static std::vector<std::tuple<ECSComponentCreateFunction, ECSComponentFreeFunction,
-		size_t>>* componentTypes;
+	static std::vector<ECSComponentTypeInfo>* componentTypes;
 };
 
+/**
+ * @brief Set of component types, with one bit per component ID.
+ *
+ * Checking if one set of component types contains another is a single AND and compare, rather than
+ * a search through lists of component IDs.
+ */
+typedef std::bitset<BaseECSComponent::MAX_TYPES> ECSComponentSignature;
+
+/**
+ * Checks if a signature contains every component type of another signature.
+ *
+ * @param signature The signature to check.
+ * @param other The component types which must all be present.
+ * @return If every bit set in other is also set in signature.
+ */
+inline bool SignatureContains(const ECSComponentSignature& signature,
+	const ECSComponentSignature& other)
+{
+	return (signature & other) == other;
+}
+
 template<typename T>
 /**
  * @brief Intermediary ECS component struct which components should inherit.
@@ -127,37 +410,166 @@ struct ECSComponent : public BaseECSComponent
 {
 	static const ECSComponentCreateFunction CREATE_FUNCTION;
 	static const ECSComponentFreeFunction FREE_FUNCTION;
+	static const ECSComponentMoveFunction MOVE_FUNCTION;
+	static const ECSComponentRelocateFunction RELOCATE_FUNCTION;
 	static const unsigned int ID;
 	static const size_t SIZE;
 };
 
+template<typename Component>
+/**
+ * @brief Determines if a component type can be relocated by copying it's bytes.
+ *
+ * True for trivially copyable component types. Component types which own memory, such as ones
+ * holding a std::vector or std::string, are moved and destroyed instead. A component type known to
+ * be safe to copy bytewise, which is the case for most types not storing pointers into themselves,
+ * may opt into the fast path by specializing this trait:
+ *
+ *		template<>
+ *		struct ECSIsTriviallyRelocatable<MyComponent> : std::true_type {};
+ */
+struct ECSIsTriviallyRelocatable : std::is_trivially_copyable<Component> {};
+
+template<typename Component>
+/**
+ * @brief Determines if components of a component type keep the same address for as long as they
+ * exist.
+ *
+ * By default, components are stored directly in the chunks of archetypes, and are moved whenever
+ * an entity changes archetype or another entity is removed. A pointer to such a component is only
+ * valid until the next structural change of the ECS. Component types which need pointers to them
+ * to stay valid may opt into being stored in a paged component pool instead:
+ *
+ *		template<>
+ *		struct ECSHasStableAddress<MyComponent> : std::true_type {};
+ *
+ * The chunks then only store pointers to the components, which costs an indirection whenever a
+ * system accesses them.
+ *
+ * @see ECSComponentPool
+ */
+struct ECSHasStableAddress : std::false_type {};
+
+template<typename Component>
+/**
+ * @brief Declares the fields of a component type which should be stored as a struct of arrays.
+ *
+ * By default, the components of a column are stored one after another. A component type may
+ * instead have each of it's fields stored as a separate contiguous array, so that systems can run
+ * vectorized loops over a single field of many entities. The fields must cover all of the data of
+ * the component, except for the entity handle, and the component type must be trivially copyable:
+ *
+ *		template<>
+ *		struct ECSSoAFields<MyComponent>
+ *		{
+ *			static constexpr bool IS_SOA = true;
+ *
+ *			static std::vector<ECSField> Get()
+ *			{
+ *				return { ECSField::Of(&MyComponent::position), ECSField::Of(&MyComponent::velocity) };
+ *			}
+ *		};
+ *
+ * Such components have no address of their own. Systems are passed a proxy holding a copy of the
+ * component, which is written back once the system is done with it, and ECS::GetProxy replaces
+ * ECS::GetComponent. Systems can also access the arrays directly through
+ * ECSComponentSpan::GetField.
+ *
+ * Cannot be combined with ECSHasStableAddress.
+ */
+struct ECSSoAFields
+{
+	static constexpr bool IS_SOA = false;
+
+	static std::vector<ECSField> Get() { return {}; }
+};
+
+template<typename Component>
+/** @brief Used internally for getting the fields of a component type when registering it. */
+std::vector<ECSField> ECSGetSoAFields()
+{
+	static_assert(!ECSSoAFields<Component>::IS_SOA || std::is_trivially_copyable<Component>::value,
+		"Component types stored as a struct of arrays must be trivially copyable.");
+	static_assert(!ECSSoAFields<Component>::IS_SOA || !ECSHasStableAddress<Component>::value,
+		"Component types stored as a struct of arrays cannot have a stable address.");
+
+	return ECSSoAFields<Component>::Get();
+}
+
+template<typename Component>
+/**
+ * @brief Determines if components of a component type are written to scene files.
+ *
+ * Scene files store the bytes of components as they are, so only trivially copyable component
+ * types can be serialized. Component types holding pointers, such as to meshes or other resources
+ * which only exist at runtime, must opt out by specializing this trait:
+ *
+ *		template<>
+ *		struct ECSIsSerializable<MyComponent> : std::false_type {};
+ *
+ * Components of such types are skipped when saving a scene, and have to be added to the loaded
+ * entities afterwards.
+ *
+ * @see ECSSceneFile
+ */
+struct ECSIsSerializable : std::is_trivially_copyable<Component> {};
+
+template<typename Component>
+/** @brief Used internally for determining if a component type is serializable when registering it. */
+constexpr bool ECSGetIsSerializable()
+{
+	static_assert(!ECSIsSerializable<Component>::value ||
+		std::is_trivially_copyable<Component>::value,
+		"Serializable component types must be trivially copyable.");
+
+	return ECSIsSerializable<Component>::value;
+}
+
+/**
+ * Hashes the name of a component type with 64-bit FNV-1a.
+ *
+ * @param name The name of the component type.
+ * @return The hash of the name.
+ */
+inline uint64_t ECSHashTypeName(const char* name)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (; *name != '\0'; name++)
+	{
+		hash ^= (unsigned char)*name;
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+/**
+ * Turns the name of a type, as returned by std::type_info::name, into the name it is written with
+ * in source code. GCC and Clang return mangled names, which are demangled; MSVC returns readable
+ * names prefixed with "struct " or "class ", which is removed.
+ *
+ * @param name The name of the type, as reported by the compiler.
+ * @return The readable name, or the name as given if it could not be demangled.
+ */
+std::string ECSDemangleTypeName(const char* name);
 
 template<typename Component>
 /**
  * This function defines how to create a component at runtime.
  *
- * @param memory Byte array of memory.
+ * @param memory Uninitialized memory, large enough to hold the component, where the component
+ *		should be constructed. This is a slot in the chunk of the entity's archetype.
  * @param entity The entity handle of the entity which this component should be attached to.
  * @param component The component to initialize.
- * @return Location/index of the component created in the memory array.
  */
-unsigned int ECSComponentCreate(std::vector<unsigned char>& memory, EntityHandle entity,
-	BaseECSComponent* component)
+void ECSComponentCreate(void* memory, EntityHandle entity, BaseECSComponent* component)
 {
-	// The component will be added at the end of the memory array
-	unsigned int index = memory.size();
-
-	// Resize the memory array to include the space needed to store the component
-	memory.resize(index + Component::SIZE);
-
-	// Construct the new component. Specify the address of memory[index] in order for the new
-	// component to be constructed in the memory array.
-	Component* c = new(&memory[index]) Component(*(Component*)component);
+	// Construct the new component. Specify the address of the memory in order for the new
+	// component to be constructed in the chunk.
+	Component* c = new(memory) Component(*(Component*)component);
 
 	// Set the entity which the component is attached to
 	c->entity = entity;
-
-	return index;
 }
 
 template<typename Component>
@@ -174,11 +586,52 @@ void ECSComponentFree(BaseECSComponent* component)
 	c->~Component();
 }
 
+template<typename Component>
+/**
+ * This function defines how to move a component at runtime. The original component is left in
+ * it's moved-from state, and must still be freed.
+ *
+ * @param memory Uninitialized memory, large enough to hold the component, where the component
+ *		should be constructed.
+ * @param component The component to move from.
+ */
+void ECSComponentMove(void* memory, BaseECSComponent* component)
+{
+	new(memory) Component(std::move(*(Component*)component));
+}
+
+template<typename Component>
+/**
+ * This function defines how to relocate a component at runtime; used when components are moved
+ * between and within chunks. Afterwards, the original memory no longer holds a component, and must
+ * not be freed.
+ *
+ * @param memory Uninitialized memory, large enough to hold the component, where the component
+ *		should be moved to.
+ * @param component The component to relocate.
+ */
+void ECSComponentRelocate(void* memory, BaseECSComponent* component)
+{
+	if constexpr (ECSIsTriviallyRelocatable<Component>::value)
+	{
+		std::memcpy(memory, component, sizeof(Component));
+	}
+	else
+	{
+		Component* c = (Component*)component;
+		new(memory) Component(std::move(*c));
+		c->~Component();
+	}
+}
+
 template<typename T>
 // Set the component ID for every individual component
 // RegisterComponentType returns the ID of the new component
 const unsigned int ECSComponent<T>::ID(BaseECSComponent::RegisterComponentType(
-	ECSComponentCreate<T>, ECSComponentFree<T>, sizeof(T)));
+	ECSComponentCreate<T>, ECSComponentFree<T>, sizeof(T), ECSComponentMove<T>,
+	ECSComponentRelocate<T>, ECSHasStableAddress<T>::value, ECSGetSoAFields<T>(),
+	std::is_trivially_copyable<T>::value, ECSHashTypeName(typeid(T).name()),
+	ECSGetIsSerializable<T>(), typeid(T).name()));
 
 template<typename T>
 // Knowing the size of an individual component helps us with dynamically allocating memory for  
@@ -192,4 +645,12 @@ const ECSComponentCreateFunction ECSComponent<T>::CREATE_FUNCTION(ECSComponentCr
 
 template<typename T>
 // How to free the component at runtime
-const ECSComponentFreeFunction ECSComponent<T>::FREE_FUNCTION(ECSComponentFree<T>);
\ No newline at end of file
+const ECSComponentFreeFunction ECSComponent<T>::FREE_FUNCTION(ECSComponentFree<T>);
+
+template<typename T>
+// How to move the component at runtime
+const ECSComponentMoveFunction ECSComponent<T>::MOVE_FUNCTION(ECSComponentMove<T>);
+
+template<typename T>
+// How to relocate the component at runtime
+const ECSComponentRelocateFunction ECSComponent<T>::RELOCATE_FUNCTION(ECSComponentRelocate<T>);
\ No newline at end of file
@@ -0,0 +1,61 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#include "ECSComponentPool.h"
+
+#include <algorithm> // std::max
+#include <new> // std::align_val_t
+
+ECSComponentPool::ECSComponentPool(size_t componentSize)
+{
+	// Free slots store a pointer, so the stride is rounded up to keep every slot aligned for one.
+	// Component sizes are a multiple of their alignment, so components stay aligned as well.
+	stride = std::max(componentSize, sizeof(void*));
+	stride = (stride + alignof(void*) - 1) & ~(alignof(void*) - 1);
+
+	// A single component may be larger than the target page size, in which case a page holds a
+	// single component and is sized to fit it
+	componentsPerPage = std::max<size_t>(1, PAGE_SIZE / stride);
+	pageSize = componentsPerPage * stride;
+}
+
+ECSComponentPool::~ECSComponentPool()
+{
+	for (unsigned char* page : pages)
+	{
+		::operator delete(page, std::align_val_t(PAGE_ALIGNMENT));
+	}
+}
+
+void* ECSComponentPool::Allocate()
+{
+	numAllocated++;
+
+	// Reuse the most recently freed slot
+	if (firstFree != nullptr)
+	{
+		void* memory = firstFree;
+		firstFree = *(void**)firstFree;
+		return memory;
+	}
+
+	// If every slot of every page is in use, allocate a new page
+	if (numUntouched == 0)
+	{
+		pages.push_back((unsigned char*)::operator new(pageSize,
+			std::align_val_t(PAGE_ALIGNMENT)));
+		numUntouched = componentsPerPage;
+	}
+
+	// Slots of the last page are handed out in order
+	void* memory = pages.back() + (componentsPerPage - numUntouched) * stride;
+	numUntouched--;
+	return memory;
+}
+
+void ECSComponentPool::Free(void* memory)
+{
+	numAllocated--;
+
+	*(void**)memory = firstFree;
+	firstFree = memory;
+}
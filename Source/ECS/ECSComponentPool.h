@@ -0,0 +1,90 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Paged storage for the components of a single component type, which never moves a
+ * component once it has been allocated.
+ *
+ * Components are stored in fixed-size pages. Pages are never reallocated or freed while the pool
+ * exists, and freed slots are reused by later allocations, so a pointer to a component stays valid
+ * until the component itself is removed. Growing the pool only allocates a new page; existing
+ * components are never copied.
+ *
+ * Component types with a stable address are stored in a pool, and the archetype columns of those
+ * types store pointers into the pool instead of the components themselves.
+ *
+ * @see ECSHasStableAddress
+ */
+class ECSComponentPool
+{
+public:
+	// The target size of a page in bytes
+	static constexpr size_t PAGE_SIZE = 16 * 1024;
+
+	// Alignment of every page
+	static constexpr size_t PAGE_ALIGNMENT = 64;
+
+	/** @param componentSize The size in bytes of the component type stored in the pool. */
+	ECSComponentPool(size_t componentSize);
+
+	// Frees all page memory. Components still stored in the pool are not freed; they are owned by
+	// the archetypes pointing to them.
+	~ECSComponentPool();
+
+	/**
+	 * Allocates memory for a single component. The memory is left uninitialized; the caller must
+	 * construct the component.
+	 *
+	 * @return Pointer to the memory, which stays valid until it is passed to Free.
+	 */
+	void* Allocate();
+
+	/**
+	 * Returns the memory of a component to the pool, so that it can be reused. The component
+	 * must have been freed already.
+	 *
+	 * @param memory Memory previously returned by Allocate.
+	 */
+	void Free(void* memory);
+
+	/** @brief Gets the number of components currently allocated from the pool. */
+	inline size_t size() const { return numAllocated; }
+
+	/** @brief Gets the total number of components the allocated pages can hold. */
+	inline size_t GetCapacity() const { return pages.size() * componentsPerPage; }
+
+	/** @brief Gets the number of pages allocated by the pool. */
+	inline size_t GetNumPages() const { return pages.size(); }
+
+	/** @brief Gets the total size in bytes of every page allocated by the pool. */
+	inline size_t GetMemorySize() const { return pages.size() * pageSize; }
+
+private:
+	// The number of bytes between two components of a page; at least the size and alignment of a
+	// pointer, so that free slots can store the next free slot
+	size_t stride;
+
+	// The number of components which fit in a single page
+	size_t componentsPerPage;
+
+	// The size in bytes of every page allocated by the pool
+	size_t pageSize;
+
+	std::vector<unsigned char*> pages;
+
+	// Free slots form a linked list, with every free slot storing a pointer to the next one
+	void* firstFree = nullptr;
+
+	// The number of slots of the last page which have never been allocated
+	size_t numUntouched = 0;
+
+	size_t numAllocated = 0;
+
+	// Disallow copy and assign
+	ECSComponentPool(const ECSComponentPool& other) = delete;
+	ECSComponentPool& operator=(const ECSComponentPool& other) = delete;
+};
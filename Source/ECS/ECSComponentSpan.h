@@ -0,0 +1,209 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#pragma once
+
+#include "ECSComponent.h"
+
+#include <cstddef> // std::ptrdiff_t
+#include <cstring> // std::memcpy
+
+/**
+ * @brief A contiguous run of components of a single type, passed to a system's UpdateBatch.
+ *
+ * Element i of every span passed in the same call belongs to the same entity.
+ *
+ * Components stored as a struct of arrays have no address of their own; their span holds one
+ * array per field instead, accessed through GetField, or copied in and out of a whole component
+ * through Gather and Scatter.
+ */
+struct ECSComponentSpan
+{
+	// Pointer to the first component, or nullptr if the span is for an optional component type
+	// which the entities do not have
+	// For struct of arrays spans, the base which the offsets of the field arrays are relative to
+	unsigned char* data = nullptr;
+
+	// The number of bytes between two components of the span
+	// For struct of arrays spans, the size of the component type
+	size_t stride = 0;
+
+	// If the span stores pointers to the components rather than the components themselves; the
+	// case for component types with a stable address
+	bool isIndirect = false;
+
+	// The fields of the component type, or nullptr if the span is not a struct of arrays
+	const ECSField* fields = nullptr;
+
+	// Offset in bytes from data to the array of each field
+	const size_t* fieldOffsets = nullptr;
+
+	unsigned int numFields = 0;
+
+	// The handles of the entities of the span, which are not part of any field
+	const EntityHandle* entities = nullptr;
+
+	// The index of the span's first component in the arrays of the fields
+	unsigned int first = 0;
+
+	/** @brief Determines if the entities have the component type of the span. */
+	inline explicit operator bool() const { return data != nullptr; }
+
+	/** @brief Determines if the components of the span are stored as a struct of arrays. */
+	inline bool IsSoA() const { return fields != nullptr; }
+
+	/**
+	 * Gets the span as a typed array. Loops over the array can be optimized much better by the
+	 * compiler than calls to Get. For indirect spans, this is an array of pointers to components.
+	 * Not available for struct of arrays spans.
+	 *
+	 * @tparam Component The component type of the span.
+	 * @return Pointer to the first component, or nullptr if the entities do not have the
+	 *		component type.
+	 */
+	template<class Component>
+	inline Component* As() const
+	{
+		return (Component*)data;
+	}
+
+	/**
+	 * Gets a single component of the span. Not available for struct of arrays spans.
+	 *
+	 * @tparam Component The component type of the span.
+	 * @param index The index of the component in the span.
+	 * @return Reference to the component.
+	 */
+	template<class Component>
+	inline Component& Get(unsigned int index) const
+	{
+		unsigned char* element = data + index * stride;
+		return isIndirect ? **(Component**)element : *(Component*)element;
+	}
+
+	/**
+	 * Gets the array of a single field of a struct of arrays span.
+	 *
+	 * @tparam T The type of the field.
+	 * @param field The index of the field, in the order the fields were declared.
+	 * @return Pointer to the field of the first component of the span.
+	 */
+	template<class T>
+	inline T* GetField(unsigned int field) const
+	{
+		return (T*)(data + fieldOffsets[field] + first * fields[field].size);
+	}
+
+	/**
+	 * Copies every field of a component of a struct of arrays span into a whole component, along
+	 * with the entity the component is attached to. Memory of the component not covered by a
+	 * field is left untouched.
+	 *
+	 * @param index The index of the component in the span.
+	 * @param component The component to copy the fields into.
+	 */
+	inline void Gather(unsigned int index, BaseECSComponent* component) const
+	{
+		for (unsigned int i = 0; i < numFields; i++)
+		{
+			std::memcpy((unsigned char*)component + fields[i].offset,
+				data + fieldOffsets[i] + (first + index) * fields[i].size, fields[i].size);
+		}
+
+		component->entity = entities[first + index];
+	}
+
+	/**
+	 * Copies every field of a whole component into a component of a struct of arrays span.
+	 *
+	 * @param index The index of the component in the span.
+	 * @param component The component to copy the fields from.
+	 */
+	inline void Scatter(unsigned int index, const BaseECSComponent* component) const
+	{
+		for (unsigned int i = 0; i < numFields; i++)
+		{
+			std::memcpy(data + fieldOffsets[i] + (first + index) * fields[i].size,
+				(const unsigned char*)component + fields[i].offset, fields[i].size);
+		}
+	}
+
+	/**
+	 * Moves the start of the span.
+	 *
+	 * @param count The number of components to move the start of the span forward by; negative
+	 *		to move it back.
+	 */
+	inline void Advance(std::ptrdiff_t count)
+	{
+		if (IsSoA())
+		{
+			first = (unsigned int)(first + count);
+		}
+		else if (data != nullptr)
+		{
+			data += count * (std::ptrdiff_t)stride;
+		}
+	}
+};
+
+template<class Component>
+/**
+ * @brief Holds a copy of a component stored as a struct of arrays, so that it can be used like a
+ * regular component.
+ *
+ * The fields of the component are gathered into the copy when the proxy is created, and scattered
+ * back when the proxy is destroyed, if the proxy is writable. The proxy converts to a reference
+ * or pointer to the copy, so code written for regular components keeps working:
+ *
+ *		void Update(float deltaTime, MyComponent& component); // Passed a proxy
+ *
+ * A proxy must not outlive the next structural change of the ECS.
+ */
+class ECSComponentProxy
+{
+public:
+	/**
+	 * @param span The struct of arrays span of the component, or an empty span if the entity does
+	 *		not have the component type.
+	 * @param index The index of the component in the span.
+	 * @param isWritable If the copy should be written back when the proxy is destroyed.
+	 */
+	ECSComponentProxy(const ECSComponentSpan& span, unsigned int index, bool isWritable) :
+		span(span), index(index), isWritable(isWritable)
+	{
+		if (span)
+		{
+			span.Gather(index, &component);
+		}
+	}
+
+	~ECSComponentProxy()
+	{
+		if (span && isWritable)
+		{
+			span.Scatter(index, &component);
+		}
+	}
+
+	/** @brief Determines if the entity has the component type. */
+	inline explicit operator bool() const { return (bool)span; }
+
+	inline Component* operator->() { return &component; }
+	inline Component& operator*() { return component; }
+
+	inline operator Component&() { return component; }
+
+	// Used for optional component types; nullptr if the entity does not have the component type
+	inline operator Component*() { return span ? &component : nullptr; }
+
+private:
+	ECSComponentSpan span;
+	unsigned int index;
+	bool isWritable;
+
+	Component component;
+
+	// Disallow copy and assign
+	ECSComponentProxy(const ECSComponentProxy& other) = delete;
+	ECSComponentProxy& operator=(const ECSComponentProxy& other) = delete;
+};
@@ -0,0 +1,73 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#pragma once
+
+#include "ECSArchetype.h"
+
+#include <vector>
+
+/**
+ * @brief Persistent set of the archetypes which have all of a given set of component types.
+ *
+ * Queries are owned by the ECS and kept up to date as archetypes are created. Entities moving
+ * between archetypes need no work at all, since the archetypes themselves track their entities.
+ * Updating a system therefore only walks the archetypes of its query, instead of matching every
+ * archetype against the system every frame.
+ */
+class ECSQuery
+{
+public:
+	/**
+	 * @param componentTypes The IDs of the component types every matching archetype must have,
+	 *		sorted in ascending order.
+	 */
+	ECSQuery(const std::vector<unsigned int>& componentTypes) : componentTypes(componentTypes)
+	{
+		for (unsigned int componentType : componentTypes)
+		{
+			signature.set(componentType);
+		}
+	}
+
+	/** @brief Gets the sorted IDs of the component types of the query. */
+	inline const std::vector<unsigned int>& GetComponentTypes() const { return componentTypes; }
+
+	/**
+	 * Gets every archetype which has all of the component types of the query. Includes archetypes
+	 * which are currently empty.
+	 *
+	 * @return Array of archetypes, in the order they were created.
+	 */
+	inline const std::vector<ECSArchetype*>& GetArchetypes() const { return archetypes; }
+
+	/**
+	 * Checks if an archetype has every component type of the query.
+	 *
+	 * @param archetype The archetype to check.
+	 * @return If the archetype belongs to the query.
+	 */
+	inline bool Matches(const ECSArchetype& archetype) const
+	{
+		return SignatureContains(archetype.GetSignature(), signature);
+	}
+
+private:
+	// Only the ECS adds archetypes to a query
+	friend class ECS;
+
+	// Sorted IDs of the component types of the query
+	std::vector<unsigned int> componentTypes;
+	ECSComponentSignature signature;
+
+	// The archetypes which match the query
+	std::vector<ECSArchetype*> archetypes;
+
+	/** @brief Adds an archetype to the query if it matches. */
+	inline void AddArchetypeIfMatches(ECSArchetype* archetype)
+	{
+		if (Matches(*archetype))
+		{
+			archetypes.push_back(archetype);
+		}
+	}
+};
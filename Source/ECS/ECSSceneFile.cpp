@@ -0,0 +1,630 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#include "ECSSceneFile.h"
+#include "ECS.h"
+
+#include <algorithm> // std::sort, std::adjacent_find, std::min
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/** @brief The start of a scene file. */
+struct SceneHeader
+{
+	uint32_t magic;
+	uint32_t version;
+
+	uint32_t numComponentTypes;
+	uint32_t numArchetypes;
+
+	// The total number of component type indices of every archetype
+	uint32_t numComponentTypeIndices;
+
+	// The size of the entity table
+	uint32_t numEntitySlots;
+
+	// Used for detecting truncated files
+	uint64_t fileSize;
+};
+
+/** @brief A component type stored in a scene file. */
+struct SceneComponentType
+{
+	uint64_t nameHash;
+	uint64_t size;
+};
+
+/** @brief An archetype stored in a scene file. */
+struct SceneArchetype
+{
+	// Index of the archetype's first component type in the component type indices
+	uint32_t firstComponentType;
+	uint32_t numComponentTypes;
+
+	uint64_t numEntities;
+
+	// Offset in bytes from the start of the file to the archetype's section
+	uint64_t dataOffset;
+};
+
+/** @brief Read-only memory mapping of a whole file. */
+class SceneMappedFile
+{
+public:
+	SceneMappedFile() {}
+
+	~SceneMappedFile()
+	{
+#ifdef _WIN32
+		if (data != nullptr)
+		{
+			UnmapViewOfFile(data);
+		}
+		if (mapping != nullptr)
+		{
+			CloseHandle(mapping);
+		}
+		if (file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(file);
+		}
+#else
+		if (data != nullptr)
+		{
+			munmap((void*)data, size);
+		}
+#endif
+	}
+
+	/**
+	 * Maps a file into memory.
+	 *
+	 * @param path The path of the file.
+	 * @return If the file was mapped or not. Empty files cannot be mapped.
+	 */
+	bool Open(const std::string& path)
+	{
+#ifdef _WIN32
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			return false;
+		}
+
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr)
+		{
+			return false;
+		}
+
+		data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		size = (size_t)fileSize.QuadPart;
+#else
+		int file = open(path.c_str(), O_RDONLY);
+		if (file == -1)
+		{
+			return false;
+		}
+
+		struct stat fileStatus;
+		if (fstat(file, &fileStatus) != 0 || fileStatus.st_size == 0)
+		{
+			close(file);
+			return false;
+		}
+
+		// The mapping stays valid once the file is closed
+		void* memory = mmap(nullptr, (size_t)fileStatus.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		close(file);
+
+		if (memory != MAP_FAILED)
+		{
+			// The file is read from start to end
+			posix_madvise(memory, (size_t)fileStatus.st_size, POSIX_MADV_SEQUENTIAL);
+
+			data = (const unsigned char*)memory;
+			size = (size_t)fileStatus.st_size;
+		}
+#endif
+
+		return data != nullptr;
+	}
+
+	// The contents of the file, or nullptr if it is not mapped
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+
+private:
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#endif
+
+	// Disallow copy and assign
+	SceneMappedFile(const SceneMappedFile& other) = delete;
+	SceneMappedFile& operator=(const SceneMappedFile& other) = delete;
+};
+
+/**
+ * Rounds an offset in a scene file up to the next multiple of the section alignment.
+ *
+ * @param offset The offset to round.
+ * @return The aligned offset.
+ */
+static inline uint64_t AlignSection(uint64_t offset)
+{
+	return (offset + ECSSceneFile::SECTION_ALIGNMENT - 1) & ~(ECSSceneFile::SECTION_ALIGNMENT - 1);
+}
+
+/**
+ * Gets the number of bytes a column of components takes up in a scene file.
+ *
+ * @param componentID ID of the component type of the column.
+ * @param numEntities The number of components in the column.
+ * @return The size in bytes.
+ */
+static uint64_t GetColumnFileSize(unsigned int componentID, uint64_t numEntities)
+{
+	// Struct of arrays columns only store their fields
+	const std::vector<ECSField>& fields = BaseECSComponent::GetTypeFields(componentID);
+	if (!fields.empty())
+	{
+		uint64_t size = 0;
+		for (const ECSField& field : fields)
+		{
+			size += field.size;
+		}
+		return size * numEntities;
+	}
+
+	return BaseECSComponent::GetTypeSize(componentID) * numEntities;
+}
+
+/** @brief Writes zeros to a file until it reaches an offset. */
+static void WritePadding(std::ofstream& file, uint64_t offset)
+{
+	static const char zeros[ECSSceneFile::SECTION_ALIGNMENT] = {};
+
+	uint64_t position = (uint64_t)file.tellp();
+	if (offset > position)
+	{
+		file.write(zeros, (std::streamsize)(offset - position));
+	}
+}
+
+bool ECSSceneFile::Save(const ECS& ecs, const std::string& path)
+{
+	/** @brief The serializable columns of an archetype being saved. */
+	struct ArchetypeSection
+	{
+		ECSArchetype* archetype;
+		std::vector<unsigned int> columns;
+	};
+
+	std::vector<ArchetypeSection> sections;
+
+	// Index in the component type table of every component type; index corresponds to component
+	// ID, and the value is UINT32_MAX for component types which are not in the table
+	std::vector<uint32_t> typeIndices(BaseECSComponent::GetNumTypes(), UINT32_MAX);
+
+	std::vector<SceneComponentType> componentTypes;
+	std::vector<uint32_t> componentTypeIndices;
+	std::vector<SceneArchetype> archetypes;
+
+	std::unordered_set<const ECSArchetype*> savedArchetypes;
+
+	for (ECSArchetype* archetype : ecs.archetypes)
+	{
+		if (archetype->size() == 0)
+		{
+			continue;
+		}
+
+		ArchetypeSection section;
+		section.archetype = archetype;
+
+		SceneArchetype sceneArchetype;
+		sceneArchetype.firstComponentType = (uint32_t)componentTypeIndices.size();
+		sceneArchetype.numEntities = archetype->size();
+
+		for (unsigned int column = 0; column < archetype->GetComponentTypes().size(); column++)
+		{
+			unsigned int componentID = archetype->GetComponentTypes()[column];
+			if (!BaseECSComponent::IsTypeSerializable(componentID))
+			{
+				continue;
+			}
+
+			if (typeIndices[componentID] == UINT32_MAX)
+			{
+				typeIndices[componentID] = (uint32_t)componentTypes.size();
+				componentTypes.push_back({ BaseECSComponent::GetTypeNameHash(componentID),
+					BaseECSComponent::GetTypeSize(componentID) });
+			}
+
+			section.columns.push_back(column);
+			componentTypeIndices.push_back(typeIndices[componentID]);
+		}
+
+		// Entities with no serializable components are not saved at all
+		if (section.columns.empty())
+		{
+			continue;
+		}
+
+		sceneArchetype.numComponentTypes = (uint32_t)section.columns.size();
+		archetypes.push_back(sceneArchetype);
+		sections.push_back(std::move(section));
+		savedArchetypes.insert(archetype);
+	}
+
+	// The generation of every slot of the entity table. Slots of entities which are not saved are
+	// stored as if the entities had been removed.
+	std::vector<uint32_t> generations(ecs.entities.size());
+	for (size_t i = 0; i < ecs.entities.size(); i++)
+	{
+		generations[i] = ecs.entities[i].generation;
+
+		ECSArchetype* archetype = ecs.entities[i].archetype;
+		if (archetype != nullptr && savedArchetypes.count(archetype) == 0)
+		{
+			generations[i] = generations[i] + 1 == 0 ? 1 : generations[i] + 1;
+		}
+	}
+
+	// Lay out the sections of the archetypes after the tables
+	uint64_t offset = sizeof(SceneHeader) + sizeof(SceneComponentType) * componentTypes.size() +
+		sizeof(SceneArchetype) * archetypes.size() +
+		sizeof(uint32_t) * componentTypeIndices.size() + sizeof(uint32_t) * generations.size();
+
+	for (size_t i = 0; i < sections.size(); i++)
+	{
+		offset = AlignSection(offset);
+		archetypes[i].dataOffset = offset;
+		offset += sizeof(EntityHandle) * archetypes[i].numEntities;
+
+		for (unsigned int column : sections[i].columns)
+		{
+			offset = AlignSection(offset) + GetColumnFileSize(
+				sections[i].archetype->GetComponentTypes()[column], archetypes[i].numEntities);
+		}
+	}
+
+	SceneHeader header;
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.numComponentTypes = (uint32_t)componentTypes.size();
+	header.numArchetypes = (uint32_t)archetypes.size();
+	header.numComponentTypeIndices = (uint32_t)componentTypeIndices.size();
+	header.numEntitySlots = (uint32_t)generations.size();
+	header.fileSize = offset;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cerr << "Could not open scene file '" << path << "' for writing." << std::endl;
+		return false;
+	}
+
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)componentTypes.data(),
+		sizeof(SceneComponentType) * componentTypes.size());
+	file.write((const char*)archetypes.data(), sizeof(SceneArchetype) * archetypes.size());
+	file.write((const char*)componentTypeIndices.data(),
+		sizeof(uint32_t) * componentTypeIndices.size());
+	file.write((const char*)generations.data(), sizeof(uint32_t) * generations.size());
+
+	for (size_t i = 0; i < sections.size(); i++)
+	{
+		const ECSArchetype& archetype = *sections[i].archetype;
+		size_t numChunks = (archetype.size() + archetype.GetChunkCapacity() - 1) /
+			archetype.GetChunkCapacity();
+
+		WritePadding(file, archetypes[i].dataOffset);
+		for (size_t chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+		{
+			const ECSChunk& chunk = archetype.GetChunk(chunkIndex);
+			file.write((const char*)archetype.GetEntities(chunk), sizeof(EntityHandle) * chunk.size);
+		}
+
+		// Every column is written as a single array, a chunk at a time
+		for (unsigned int column : sections[i].columns)
+		{
+			WritePadding(file, AlignSection((uint64_t)file.tellp()));
+
+			if (archetype.IsColumnSoA(column))
+			{
+				const std::vector<ECSField>& fields =
+					BaseECSComponent::GetTypeFields(archetype.GetComponentTypes()[column]);
+
+				for (unsigned int field = 0; field < fields.size(); field++)
+				{
+					for (size_t chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+					{
+						const ECSChunk& chunk = archetype.GetChunk(chunkIndex);
+						file.write(archetype.GetColumnSpan(chunk, column).GetField<const char>(field),
+							fields[field].size * chunk.size);
+					}
+				}
+				continue;
+			}
+
+			for (size_t chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+			{
+				const ECSChunk& chunk = archetype.GetChunk(chunkIndex);
+				ECSComponentSpan span = archetype.GetColumnSpan(chunk, column);
+
+				// Pooled columns store pointers, so each component is written on it's own
+				if (span.isIndirect)
+				{
+					size_t size = BaseECSComponent::GetTypeSize(archetype.GetComponentTypes()[column]);
+					for (unsigned int row = 0; row < chunk.size; row++)
+					{
+						file.write((const char*)&span.Get<BaseECSComponent>(row), size);
+					}
+				}
+				else
+				{
+					file.write((const char*)span.data, span.stride * chunk.size);
+				}
+			}
+		}
+	}
+
+	if (!file)
+	{
+		std::cerr << "Could not write scene file '" << path << "'." << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool ECSSceneFile::Load(ECS& ecs, const std::string& path)
+{
+	if (ecs.entities.size() != ecs.freeEntities.size() || ecs.numReservedEntities > 0)
+	{
+		std::cerr << "Attempted to load scene file '" << path << "' into an ECS which has entities."
+			<< std::endl;
+		return false;
+	}
+
+	SceneMappedFile file;
+	if (!file.Open(path))
+	{
+		std::cerr << "Could not open scene file '" << path << "'." << std::endl;
+		return false;
+	}
+
+	// Check the file as a whole before making any entities, so that nothing is loaded from an
+	// invalid file
+
+	const SceneHeader* header = (const SceneHeader*)file.data;
+	if (file.size < sizeof(SceneHeader) || header->magic != MAGIC)
+	{
+		std::cerr << "'" << path << "' is not a scene file." << std::endl;
+		return false;
+	}
+
+	if (header->version != VERSION)
+	{
+		std::cerr << "Scene file '" << path << "' has version " << header->version <<
+			", expected version " << VERSION << "." << std::endl;
+		return false;
+	}
+
+	uint64_t tablesSize = sizeof(SceneHeader) +
+		sizeof(SceneComponentType) * (uint64_t)header->numComponentTypes +
+		sizeof(SceneArchetype) * (uint64_t)header->numArchetypes +
+		sizeof(uint32_t) * (uint64_t)header->numComponentTypeIndices +
+		sizeof(uint32_t) * (uint64_t)header->numEntitySlots;
+
+	if (header->fileSize != file.size || tablesSize > file.size)
+	{
+		std::cerr << "Scene file '" << path << "' is truncated." << std::endl;
+		return false;
+	}
+
+	const SceneComponentType* componentTypes = (const SceneComponentType*)(header + 1);
+	const SceneArchetype* archetypes =
+		(const SceneArchetype*)(componentTypes + header->numComponentTypes);
+	const uint32_t* componentTypeIndices = (const uint32_t*)(archetypes + header->numArchetypes);
+	const uint32_t* generations = componentTypeIndices + header->numComponentTypeIndices;
+
+	// Find the registered component type of every component type in the file
+	std::unordered_map<uint64_t, unsigned int> typesByNameHash;
+	for (unsigned int id = 0; id < BaseECSComponent::GetNumTypes() &&
+		id < BaseECSComponent::MAX_TYPES; id++)
+	{
+		typesByNameHash[BaseECSComponent::GetTypeNameHash(id)] = id;
+	}
+
+	std::vector<unsigned int> componentIDs(header->numComponentTypes);
+	for (uint32_t i = 0; i < header->numComponentTypes; i++)
+	{
+		auto it = typesByNameHash.find(componentTypes[i].nameHash);
+		if (it == typesByNameHash.end() || !BaseECSComponent::IsTypeSerializable(it->second))
+		{
+			std::cerr << "Scene file '" << path << "' has component type " << std::hex <<
+				componentTypes[i].nameHash << std::dec << ", which is not a serializable " <<
+				"component type." << std::endl;
+			return false;
+		}
+
+		if (componentTypes[i].size != BaseECSComponent::GetTypeSize(it->second))
+		{
+			std::cerr << "Scene file '" << path << "' has component type " << std::hex <<
+				componentTypes[i].nameHash << std::dec << " with size " << componentTypes[i].size <<
+				", expected size " << BaseECSComponent::GetTypeSize(it->second) << "." << std::endl;
+			return false;
+		}
+
+		componentIDs[i] = it->second;
+	}
+
+	// The sorted component types of every archetype
+	std::vector<std::vector<unsigned int>> archetypeTypes(header->numArchetypes);
+
+	// Every slot of the entity table may only be used by a single entity
+	std::vector<bool> isSlotUsed(header->numEntitySlots, false);
+
+	for (uint32_t i = 0; i < header->numArchetypes; i++)
+	{
+		const SceneArchetype& archetype = archetypes[i];
+
+		if ((uint64_t)archetype.firstComponentType + archetype.numComponentTypes >
+			header->numComponentTypeIndices || archetype.dataOffset > file.size ||
+			archetype.numEntities > (file.size - archetype.dataOffset) / sizeof(EntityHandle))
+		{
+			std::cerr << "Scene file '" << path << "' is corrupt." << std::endl;
+			return false;
+		}
+
+		uint64_t end = archetype.dataOffset + sizeof(EntityHandle) * archetype.numEntities;
+
+		for (uint32_t j = 0; j < archetype.numComponentTypes; j++)
+		{
+			uint32_t typeIndex = componentTypeIndices[archetype.firstComponentType + j];
+			if (typeIndex >= header->numComponentTypes)
+			{
+				std::cerr << "Scene file '" << path << "' is corrupt." << std::endl;
+				return false;
+			}
+
+			archetypeTypes[i].push_back(componentIDs[typeIndex]);
+			end = AlignSection(end) + GetColumnFileSize(componentIDs[typeIndex],
+				archetype.numEntities);
+		}
+
+		std::sort(archetypeTypes[i].begin(), archetypeTypes[i].end());
+		if (end > file.size || archetypeTypes[i].empty() ||
+			std::adjacent_find(archetypeTypes[i].begin(), archetypeTypes[i].end()) !=
+			archetypeTypes[i].end())
+		{
+			std::cerr << "Scene file '" << path << "' is corrupt." << std::endl;
+			return false;
+		}
+
+		const EntityHandle* handles = (const EntityHandle*)(file.data + archetype.dataOffset);
+		for (uint64_t j = 0; j < archetype.numEntities; j++)
+		{
+			if (handles[j].index >= header->numEntitySlots || isSlotUsed[handles[j].index] ||
+				handles[j].generation != generations[handles[j].index])
+			{
+				std::cerr << "Scene file '" << path << "' has an invalid entity handle." << std::endl;
+				return false;
+			}
+
+			isSlotUsed[handles[j].index] = true;
+		}
+	}
+
+	// The file is valid; replace the entity table
+	ecs.entities.resize(header->numEntitySlots);
+	for (uint32_t i = 0; i < header->numEntitySlots; i++)
+	{
+		ecs.entities[i].archetype = nullptr;
+		ecs.entities[i].row = 0;
+		ecs.entities[i].generation = generations[i];
+	}
+
+	// Every loaded component counts as changed
+	uint32_t tick = ecs.GetChangeTick();
+
+	std::vector<ECSArchetype*> loadedArchetypes(header->numArchetypes);
+
+	for (uint32_t i = 0; i < header->numArchetypes; i++)
+	{
+		const SceneArchetype& sceneArchetype = archetypes[i];
+		size_t numEntities = (size_t)sceneArchetype.numEntities;
+		const EntityHandle* handles = (const EntityHandle*)(file.data + sceneArchetype.dataOffset);
+
+		ECSArchetype* archetype = ecs.FindOrCreateArchetype(archetypeTypes[i]);
+		loadedArchetypes[i] = archetype;
+
+		unsigned int firstRow = archetype->AddRows(handles, numEntities);
+
+		// Copy every column straight from the file into the chunks
+		uint64_t offset = sceneArchetype.dataOffset + sizeof(EntityHandle) * numEntities;
+		for (uint32_t j = 0; j < sceneArchetype.numComponentTypes; j++)
+		{
+			unsigned int componentID =
+				componentIDs[componentTypeIndices[sceneArchetype.firstComponentType + j]];
+
+			offset = AlignSection(offset);
+			archetype->CopyComponents(firstRow, archetype->GetColumn(componentID),
+				file.data + offset, numEntities);
+			offset += GetColumnFileSize(componentID, numEntities);
+		}
+
+		for (size_t row = firstRow; row < firstRow + numEntities;)
+		{
+			const ECSChunk& chunk = archetype->GetChunk(row / archetype->GetChunkCapacity());
+			unsigned int index = (unsigned int)(row % archetype->GetChunkCapacity());
+			unsigned int count = (unsigned int)std::min<size_t>(firstRow + numEntities - row,
+				archetype->GetChunkCapacity() - index);
+
+			for (unsigned int column = 0; column < archetypeTypes[i].size(); column++)
+			{
+				archetype->MarkChanged(chunk, column, index, count, tick);
+			}
+
+			row += count;
+		}
+
+		for (size_t j = 0; j < numEntities; j++)
+		{
+			ecs.entities[handles[j].index].archetype = archetype;
+			ecs.entities[handles[j].index].row = firstRow + (unsigned int)j;
+		}
+	}
+
+	// Slots which are not used by any entity are free. They are added in reverse, so that the
+	// lowest slots are reused first.
+	ecs.freeEntities.clear();
+	for (uint32_t i = header->numEntitySlots; i > 0; i--)
+	{
+		if (ecs.entities[i - 1].archetype == nullptr)
+		{
+			ecs.freeEntities.push_back(i - 1);
+		}
+	}
+
+	// Dispatch the make entity event once every entity has been loaded
+	for (uint32_t i = 0; i < header->numArchetypes; i++)
+	{
+		if (archetypes[i].numEntities == 0)
+		{
+			continue;
+		}
+
+		const EntityHandle* handles = (const EntityHandle*)(file.data + archetypes[i].dataOffset);
+		ecs.NotifyMakeEntities(loadedArchetypes[i], handles, (size_t)archetypes[i].numEntities);
+	}
+
+	return true;
+}
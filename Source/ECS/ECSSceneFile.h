@@ -0,0 +1,68 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+class ECS;
+
+/**
+ * @brief Reads and writes the entities of an ECS as a binary scene file.
+ *
+ * The file is laid out like the storage of the ECS itself, so that loading is a memory mapping of
+ * the file followed by block copies into the chunks of the archetypes, rather than constructing
+ * every entity one at a time:
+ *
+ *		Header
+ *		Component type table; the name hash and size of every component type in the file
+ *		Archetype table; the component types, number of entities and data offset of every section
+ *		Component type indices of every archetype, one after another
+ *		Entity table; the generation of every slot
+ *		One section per archetype, each starting on a 64 byte boundary:
+ *			The handles of the entities of the archetype
+ *			One array per component type, in the order of the archetype's component types, each
+ *			starting on a 64 byte boundary. Component types stored as a struct of arrays store the
+ *			array of every field instead, one after another.
+ *
+ * Components are stored as their raw bytes, so a scene file can only be loaded by a build with the
+ * same component layouts. Every component type is identified by the hash of it's name, and
+ * validated by it's size, when loading. Only serializable component types are written; see
+ * ECSIsSerializable.
+ *
+ * Entity handles are kept as they are, so handles stored inside of components remain valid once
+ * the scene is loaded.
+ */
+class ECSSceneFile
+{
+public:
+	// Identifies scene files; "GLES"
+	static constexpr uint32_t MAGIC = 0x53454C47;
+
+	// Incremented every time the layout of the file changes
+	static constexpr uint32_t VERSION = 1;
+
+	// Alignment of every section of component data in the file
+	static constexpr uint64_t SECTION_ALIGNMENT = 64;
+
+	/**
+	 * Writes every entity of an ECS to a scene file. Components of types which are not
+	 * serializable are skipped, as are entities with no serializable components at all.
+	 *
+	 * @param ecs The ECS to save.
+	 * @param path The path of the file to write.
+	 * @return If the scene was saved or not.
+	 */
+	static bool Save(const ECS& ecs, const std::string& path);
+
+	/**
+	 * Makes every entity stored in a scene file, with the same handles they had when the scene was
+	 * saved. The ECS must not have any entities, and handles to entities it had before must not
+	 * be used afterwards. Listeners are notified once per archetype.
+	 *
+	 * @param ecs The ECS to load the scene into.
+	 * @param path The path of the file to read.
+	 * @return If the scene was loaded or not. Nothing is loaded if the file is invalid.
+	 */
+	static bool Load(ECS& ecs, const std::string& path);
+};
@@ -0,0 +1,109 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#include "ECSSnapshot.h"
+
+#include <cstring> // std::memcpy
+#include <new> // std::align_val_t
+
+void ECSSnapshot::Clear()
+{
+	tick = 0;
+	isTaken = false;
+	archetypes.clear();
+	entities.clear();
+	freeEntities.clear();
+}
+
+size_t ECSSnapshot::GetNumChunks() const
+{
+	size_t numChunks = 0;
+	for (const ArchetypeCopy& archetype : archetypes)
+	{
+		numChunks += archetype.chunks.size();
+	}
+
+	return numChunks;
+}
+
+size_t ECSSnapshot::GetNumUniqueChunks() const
+{
+	size_t numChunks = 0;
+	for (const ArchetypeCopy& archetype : archetypes)
+	{
+		for (const std::shared_ptr<ChunkCopy>& chunk : archetype.chunks)
+		{
+			if (chunk.use_count() == 1)
+			{
+				numChunks++;
+			}
+		}
+	}
+
+	return numChunks;
+}
+
+ECSSnapshot::ChunkCopy::ChunkCopy(ECSArchetype& archetype, size_t chunkIndex)
+{
+	const ECSChunk& chunk = archetype.GetChunk(chunkIndex);
+
+	size = chunk.size;
+	version = chunk.version;
+
+	// Copy the whole chunk at once, including the entity handles and change ticks
+	memory = (unsigned char*)::operator new(archetype.GetChunkMemorySize(),
+		std::align_val_t(ECSArchetype::COLUMN_ALIGNMENT));
+	std::memcpy(memory, chunk.memory, archetype.GetChunkMemorySize());
+
+	const std::vector<unsigned int>& componentTypes = archetype.GetComponentTypes();
+	unsigned int firstRow = (unsigned int)chunkIndex * archetype.GetChunkCapacity();
+
+	// The bytes of pooled columns are only pointers to the components, and the bytes of
+	// components which are not trivially copyable cannot be copied on their own; copy construct
+	// those components instead
+	for (unsigned int column = 0; column < componentTypes.size(); column++)
+	{
+		unsigned int componentID = componentTypes[column];
+
+		if (!archetype.IsColumnPooled(column) &&
+			BaseECSComponent::IsTypeTriviallyCopyable(componentID))
+		{
+			continue;
+		}
+
+		size_t componentSize = BaseECSComponent::GetTypeSize(componentID);
+
+		DeepColumn deepColumn;
+		deepColumn.column = column;
+		deepColumn.componentID = componentID;
+		deepColumn.components = (unsigned char*)::operator new(componentSize * size,
+			std::align_val_t(ECSArchetype::COLUMN_ALIGNMENT));
+
+		for (unsigned int i = 0; i < size; i++)
+		{
+			BaseECSComponent* component = archetype.GetComponent(firstRow + i, column);
+			BaseECSComponent::GetTypeCreateFunction(componentID)(
+				deepColumn.components + i * componentSize, component->entity, component);
+		}
+
+		deepColumns.push_back(deepColumn);
+	}
+}
+
+ECSSnapshot::ChunkCopy::~ChunkCopy()
+{
+	for (DeepColumn& deepColumn : deepColumns)
+	{
+		size_t componentSize = BaseECSComponent::GetTypeSize(deepColumn.componentID);
+
+		for (unsigned int i = 0; i < size; i++)
+		{
+			BaseECSComponent::GetTypeFreeFunction(deepColumn.componentID)(
+				(BaseECSComponent*)(deepColumn.components + i * componentSize));
+		}
+
+		::operator delete(deepColumn.components,
+			std::align_val_t(ECSArchetype::COLUMN_ALIGNMENT));
+	}
+
+	::operator delete(memory, std::align_val_t(ECSArchetype::COLUMN_ALIGNMENT));
+}
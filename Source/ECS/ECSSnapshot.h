@@ -0,0 +1,126 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#pragma once
+
+#include "ECSArchetype.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Copy of the complete state of an ECS at one point in time, which the ECS can be restored
+ * to later. Used for rollback, replay and undo.
+ *
+ * A snapshot stores a block copy of every used chunk of every archetype, along with the entity
+ * table. Components which are not trivially copyable, or which are stored in a component pool,
+ * are copy constructed into the snapshot instead.
+ *
+ * Snapshots are copy-on-write; when a snapshot is taken relative to a previous snapshot, every
+ * chunk which has not changed since the previous snapshot shares the previous snapshot's copy
+ * instead of being copied again. Keeping a history of snapshots therefore only costs memory for
+ * the chunks which actually changed between them.
+ *
+ * A snapshot can only be restored into the ECS it was taken from, and must not outlive it.
+ *
+ * @see ECS::Snapshot
+ * @see ECS::Restore
+ */
+class ECSSnapshot
+{
+public:
+	ECSSnapshot() {}
+
+	/** @brief Gets the change tick of the ECS when the snapshot was taken. */
+	inline uint32_t GetTick() const { return tick; }
+
+	/** @brief Gets the number of entities stored in the snapshot. */
+	inline size_t GetNumEntities() const
+	{
+		return entities.size() - freeEntities.size();
+	}
+
+	/** @brief Gets the number of chunk copies of the snapshot, including shared ones. */
+	size_t GetNumChunks() const;
+
+	/**
+	 * Gets the number of chunk copies which are not shared with any other snapshot; the memory
+	 * which would be released by clearing the snapshot.
+	 */
+	size_t GetNumUniqueChunks() const;
+
+	/** @brief Determines if the snapshot has been taken. */
+	inline bool IsEmpty() const { return !isTaken; }
+
+	/** @brief Releases every chunk copy of the snapshot, leaving it empty. */
+	void Clear();
+
+private:
+	// Only the ECS takes and restores snapshots
+	friend class ECS;
+
+	/** @brief Copy of a single chunk, which may be shared between snapshots. */
+	struct ChunkCopy
+	{
+		/**
+		 * Copies every row of a chunk. Components of deep columns are copy constructed.
+		 *
+		 * @param archetype The archetype storing the chunk.
+		 * @param chunkIndex The index of the chunk in the archetype.
+		 */
+		ChunkCopy(ECSArchetype& archetype, size_t chunkIndex);
+
+		// Frees the copies of the components of deep columns
+		~ChunkCopy();
+
+		/** @brief A column whose components cannot be restored by copying the chunk's bytes. */
+		struct DeepColumn
+		{
+			unsigned int column;
+			unsigned int componentID;
+
+			// Copy of every component of the column, one after another
+			unsigned char* components;
+		};
+
+		// Raw copy of the chunk's memory
+		unsigned char* memory;
+
+		// The number of entities stored in the chunk
+		unsigned int size;
+
+		// The version of the chunk which was copied
+		uint32_t version;
+
+		std::vector<DeepColumn> deepColumns;
+
+		// Disallow copy and assign
+		ChunkCopy(const ChunkCopy& other) = delete;
+		ChunkCopy& operator=(const ChunkCopy& other) = delete;
+	};
+
+	/** @brief The chunk copies of a single archetype. */
+	struct ArchetypeCopy
+	{
+		size_t numEntities = 0;
+		std::vector<std::shared_ptr<ChunkCopy>> chunks;
+	};
+
+	/** @brief Copy of a slot in the entity table. */
+	struct EntitySlot
+	{
+		ECSArchetype* archetype;
+		unsigned int row;
+		uint32_t generation;
+	};
+
+	// The change tick of the ECS when the snapshot was taken
+	uint32_t tick = 0;
+	bool isTaken = false;
+
+	// Index corresponds to the index of the archetype in the ECS
+	std::vector<ArchetypeCopy> archetypes;
+
+	std::vector<EntitySlot> entities;
+	std::vector<uint32_t> freeEntities;
+};
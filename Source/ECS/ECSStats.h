@@ -0,0 +1,99 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** @brief Memory and occupancy of a single component type, across every archetype storing it. */
+struct ECSComponentTypeStats
+{
+	unsigned int componentID = 0;
+
+	// The name of the component type
+	std::string name;
+
+	// The number of components of the type attached to entities
+	size_t numComponents = 0;
+
+	// The number of bytes taken by the components, including their change ticks, and the column
+	// pointers to them if they are stored in a component pool
+	size_t bytesUsed = 0;
+
+	// The number of bytes set aside for the component type in every allocated chunk, including
+	// rows which are not in use, plus the pages of the component pool if there is one
+	size_t bytesReserved = 0;
+
+	// The number of chunks and pool pages allocated for storing components of the type
+	// Component memory is never reallocated; storage grows by allocating another chunk or page,
+	// so this counts every time storage for the type had to grow
+	size_t numAllocations = 0;
+};
+
+/** @brief Memory and occupancy of a single archetype. */
+struct ECSArchetypeStats
+{
+	// Sorted IDs of the component types of the archetype
+	std::vector<unsigned int> componentTypes;
+
+	size_t numEntities = 0;
+	size_t numChunks = 0;
+
+	// The maximum number of entities that fit in a single chunk
+	unsigned int chunkCapacity = 0;
+
+	// The total size in bytes of every chunk allocated by the archetype
+	size_t bytesReserved = 0;
+};
+
+/** @brief Occupancy and timing of a single system, as of it's last update. */
+struct ECSSystemStats
+{
+	// The name of the type of the system
+	std::string name;
+
+	// The number of entities which had every non-optional component type of the system
+	size_t numMatchedEntities = 0;
+
+	// How long the update took, in seconds
+	float lastUpdateTime = 0.0f;
+
+	// The change tick at which the system was last updated, or 0 if it has not been updated
+	uint32_t lastRunTick = 0;
+};
+
+/**
+ * @brief Statistics of an ECS at one point in time, for tracking memory usage and catching
+ * regressions in system updates.
+ *
+ * @see ECS::GetStats
+ */
+struct ECSStats
+{
+	// The number of entities stored in archetypes
+	size_t numEntities = 0;
+
+	// The number of entity slots reserved by command buffers for entities which have not been
+	// made yet, including slots past the end of the entity table
+	size_t numReservedEntities = 0;
+
+	// The number of slots in the entity table, including free ones, and the number of slots the
+	// table can hold before it is reallocated
+	size_t entityTableSize = 0;
+	size_t entityTableCapacity = 0;
+
+	// The total size in bytes of every chunk and pool page allocated by the ECS
+	size_t bytesReserved = 0;
+
+	// Only component types which have been stored in an archetype are included, in order of ID
+	std::vector<ECSComponentTypeStats> componentTypes;
+
+	// Index corresponds to the index of the archetype in the ECS
+	std::vector<ECSArchetypeStats> archetypes;
+
+	// In the order of the system lists passed to ECS::GetStats, and the order of the systems in
+	// each list
+	std::vector<ECSSystemStats> systems;
+};
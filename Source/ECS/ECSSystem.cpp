@@ -26,6 +26,9 @@
 
 #include "ECSSystem.h"
 
+#include <algorithm> // std::find, std::lower_bound, std::max
+#include <cstddef> // std::max_align_t
+
 bool BaseECSSystem::IsValid()
 {
 	// Iterate over all component flags
@@ -44,6 +47,124 @@ bool BaseECSSystem::IsValid()
 }
 
 
+void BaseECSSystem::UpdateBatch(float deltaTime, const ECSComponentSpan* components,
+	unsigned int count)
+{
+	// Created once per thread to avoid repeatedly allocating and deallocating for every run;
+	// stores pointers to the components of a single entity
+	static thread_local std::vector<BaseECSComponent*> componentStorage;
+	componentStorage.resize(componentTypes.size());
+
+	// Components stored as a struct of arrays are gathered into a copy for every entity, and
+	// scattered back afterwards unless they are read only
+	static thread_local std::vector<std::vector<std::max_align_t>> gatherStorage;
+	gatherStorage.resize(std::max(gatherStorage.size(), componentTypes.size()));
+	for (unsigned int j = 0; j < componentTypes.size(); j++)
+	{
+		if (components[j].IsSoA())
+		{
+			gatherStorage[j].resize((components[j].stride + sizeof(std::max_align_t) - 1) /
+				sizeof(std::max_align_t));
+		}
+	}
+
+	// Iterate over every entity of the run
+	for (unsigned int i = 0; i < count; i++)
+	{
+		// Optional component types which the entities do not have are passed in as nullptr
+		for (unsigned int j = 0; j < componentTypes.size(); j++)
+		{
+			if (!components[j])
+			{
+				componentStorage[j] = nullptr;
+			}
+			else if (components[j].IsSoA())
+			{
+				componentStorage[j] = (BaseECSComponent*)gatherStorage[j].data();
+				components[j].Gather(i, componentStorage[j]);
+			}
+			else
+			{
+				componentStorage[j] = &components[j].Get<BaseECSComponent>(i);
+			}
+		}
+
+		UpdateComponents(deltaTime, componentStorage.data());
+
+		for (unsigned int j = 0; j < componentTypes.size(); j++)
+		{
+			if (components[j] && components[j].IsSoA() &&
+				(componentFlags[j] & FLAG_READ_ONLY) == 0)
+			{
+				components[j].Scatter(i, componentStorage[j]);
+			}
+		}
+	}
+}
+
+bool BaseECSSystem::ConflictsWith(BaseECSSystem& other)
+{
+	// Iterate over all component types this system writes
+	for (unsigned int componentType : writeComponentTypes)
+	{
+		// If the other system reads or writes the same component type, the two systems conflict
+		if (std::find(other.readComponentTypes.begin(), other.readComponentTypes.end(),
+			componentType) != other.readComponentTypes.end())
+		{
+			return true;
+		}
+	}
+
+	// Iterate over all component types the other system writes
+	for (unsigned int componentType : other.writeComponentTypes)
+	{
+		// If this system reads or writes the same component type, the two systems conflict
+		if (std::find(readComponentTypes.begin(), readComponentTypes.end(), componentType) !=
+			readComponentTypes.end())
+		{
+			return true;
+		}
+	}
+
+	// The systems do not conflict; they only read the component types they share
+	return false;
+}
+
+void BaseECSSystem::AddComponentType(unsigned int componentType, unsigned int componentFlag)
+{
+	componentTypes.push_back(componentType);
+	componentFlags.push_back(componentFlag);
+
+	// Keep the required component types sorted, so they can be used as a key directly
+	if ((componentFlag & FLAG_OPTIONAL) == 0)
+	{
+		auto it = std::lower_bound(requiredComponentTypes.begin(), requiredComponentTypes.end(),
+			componentType);
+		if (it == requiredComponentTypes.end() || *it != componentType)
+		{
+			requiredComponentTypes.insert(it, componentType);
+		}
+	}
+
+	AddComponentAccess(componentType, (componentFlag & FLAG_READ_ONLY) == 0);
+}
+
+void BaseECSSystem::AddComponentAccess(unsigned int componentType, bool isWrite)
+{
+	// Writing a component type implies reading it
+	if (std::find(readComponentTypes.begin(), readComponentTypes.end(), componentType) ==
+		readComponentTypes.end())
+	{
+		readComponentTypes.push_back(componentType);
+	}
+
+	if (isWrite && std::find(writeComponentTypes.begin(), writeComponentTypes.end(),
+		componentType) == writeComponentTypes.end())
+	{
+		writeComponentTypes.push_back(componentType);
+	}
+}
+
 bool ECSSystemList::RemoveSystem(BaseECSSystem& system)
 {
 	// Iterate over all systems in the systems list
@@ -55,6 +176,9 @@ bool ECSSystemList::RemoveSystem(BaseECSSystem& system)
 			// Remove the system from the list
 			systems.erase(systems.begin() + i);
 
+			// The schedule needs to be rebuilt without the removed system
+			schedule.clear();
+
 			// The system was successfully removed
 			return true;
 		}
@@ -62,3 +186,38 @@ bool ECSSystemList::RemoveSystem(BaseECSSystem& system)
 	// The system was not removed; it was not found in the list
 	return false;
 }
+
+const std::vector<std::vector<unsigned int>>& ECSSystemList::GetSchedule()
+{
+	// The schedule is already built
+	if (!schedule.empty() || systems.empty())
+	{
+		return schedule;
+	}
+
+	// The phase each system is placed in
+	std::vector<unsigned int> phases(systems.size(), 0);
+
+	// Iterate over all systems in the list
+	for (unsigned int i = 0; i < systems.size(); i++)
+	{
+		// A system must be updated after every earlier system it conflicts with; this builds the
+		// dependency graph of the systems. Place the system in the phase right after the latest
+		// phase of the systems it depends on.
+		for (unsigned int j = 0; j < i; j++)
+		{
+			if (systems[i]->ConflictsWith(*systems[j]))
+			{
+				phases[i] = std::max(phases[i], phases[j] + 1);
+			}
+		}
+
+		if (phases[i] >= schedule.size())
+		{
+			schedule.resize(phases[i] + 1);
+		}
+		schedule[phases[i]].push_back(i);
+	}
+
+	return schedule;
+}
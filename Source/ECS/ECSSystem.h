@@ -27,6 +27,7 @@
 #pragma once
 
 #include "ECSComponent.h"
+#include "ECSComponentSpan.h"
 #include <vector>
 
 /**
@@ -40,7 +41,18 @@ public:
 	enum
 	{
 		// Allow for optional components; components that are processed only if they exist
-		FLAG_OPTIONAL = 1
+		FLAG_OPTIONAL = 1,
+
+		// The system only reads the component, and never modifies it
+		// Systems which only read a component type can be updated at the same time
+		FLAG_READ_ONLY = 2,
+
+		// The system is only updated with entities whose component of this type changed since
+		// the system was last updated. If several component types have this flag, the entity
+		// is updated if any of them changed.
+		// Components which the system does not only read are marked as changed when the system
+		// is updated with them.
+		FLAG_ONLY_CHANGED = 4
 	};
 
 	BaseECSSystem() {}
@@ -53,6 +65,22 @@ public:
 	 */
 	virtual void UpdateComponents(float deltaTime, BaseECSComponent** components) {}
 
+	/**
+	 * Called every frame for each contiguous run of entities with which the system is working
+	 * with, rather than once per entity. Systems with simple per-entity work should override this
+	 * and loop over the spans directly, which avoids a virtual call per entity and allows the
+	 * compiler to vectorize the loop.
+	 * 
+	 * The default implementation calls UpdateComponents for every entity of the run.
+	 * 
+	 * @param deltaTime How much time has passed since the previous update.
+	 * @param components One span per component type the system is working with, in the same
+	 *		order as the component types.
+	 * @param count The number of entities in the run.
+	 */
+	virtual void UpdateBatch(float deltaTime, const ECSComponentSpan* components,
+		unsigned int count);
+
 	/**
 	 * Gets the component types with which the system is working with.
 	 * 
@@ -77,6 +105,76 @@ public:
 		return componentFlags;
 	}
 
+	/**
+	 * Gets the non-optional component types with which the system is working with, sorted in
+	 * ascending order. An entity must have all of them for the system to be updated with it.
+	 * 
+	 * @return Array of component IDs.
+	 */
+	const std::vector<unsigned int>& GetRequiredComponentTypes()
+	{
+		return requiredComponentTypes;
+	}
+
+	/**
+	 * Gets every component type which the system reads, including the ones it writes. Includes
+	 * the component types the system is working with, and those declared with AddComponentAccess.
+	 * 
+	 * @return Array of component IDs.
+	 */
+	const std::vector<unsigned int>& GetReadComponentTypes()
+	{
+		return readComponentTypes;
+	}
+
+	/**
+	 * Gets every component type which the system writes. Includes the component types the system
+	 * is working with which are not read only, and those declared with AddComponentAccess.
+	 * 
+	 * @return Array of component IDs.
+	 */
+	const std::vector<unsigned int>& GetWriteComponentTypes()
+	{
+		return writeComponentTypes;
+	}
+
+	/**
+	 * Checks if two systems access the same component types in a conflicting way; one of them
+	 * writes a component type which the other reads or writes. Conflicting systems cannot be
+	 * updated at the same time.
+	 * 
+	 * @param other The system to compare against.
+	 * @return If the systems conflict or not.
+	 */
+	bool ConflictsWith(BaseECSSystem& other);
+
+	/**
+	 * @brief If true, the system must be updated on the thread which updates the system list,
+	 * for instance because it issues rendering commands.
+	 */
+	inline bool IsMainThreadOnly() { return isMainThreadOnly; }
+
+	/**
+	 * @brief If true, the entities the system is working with may be split into ranges which are
+	 * updated at the same time on different threads.
+	 */
+	inline bool IsParallel() { return isParallel; }
+
+	/**
+	 * @brief Gets the change tick at which the system was last updated. Components changed after
+	 * this tick are considered changed by the system.
+	 */
+	inline uint32_t GetLastRunTick() { return lastRunTick; }
+
+	/**
+	 * @brief Gets the number of entities which had every non-optional component type of the
+	 * system when it was last updated.
+	 */
+	inline size_t GetNumMatchedEntities() { return numMatchedEntities; }
+
+	/** @brief Gets how long the last update of the system took, in seconds. */
+	inline float GetLastUpdateTime() { return lastUpdateTime; }
+
 	/**
 	 * Checks if a system is valid.
 	 * Specifically, ensure that the system is working with at least one non-optional component.
@@ -94,16 +192,61 @@ protected:
 	 * 
 	 * @see FLAG_OPTIONAL
 	 */
-	void AddComponentType(unsigned int componentType, unsigned int componentFlag = 0)
+	void AddComponentType(unsigned int componentType, unsigned int componentFlag = 0);
+
+	/**
+	 * Declares that the system accesses a component type. Only needed for component types which
+	 * the system accesses without working with them, for instance through ECS::GetComponent.
+	 * Used for determining which systems can be updated at the same time.
+	 * 
+	 * @param componentType The ID of the component type.
+	 * @param isWrite If the system modifies components of the type, rather than only reading them.
+	 */
+	void AddComponentAccess(unsigned int componentType, bool isWrite);
+
+	/**
+	 * Sets whether the system must be updated on the thread which updates the system list.
+	 * 
+	 * @see IsMainThreadOnly
+	 */
+	void SetMainThreadOnly(bool mainThreadOnly)
 	{
-		componentTypes.push_back(componentType);
-		componentFlags.push_back(componentFlag);
+		isMainThreadOnly = mainThreadOnly;
+	}
+
+	/**
+	 * Sets whether the entities the system is working with may be updated in parallel. Only
+	 * enable this if updating an entity touches nothing but that entity's own components, and
+	 * UpdateComponents is safe to call from multiple threads at the same time.
+	 * 
+	 * @see IsParallel
+	 */
+	void SetParallel(bool parallel)
+	{
+		isParallel = parallel;
 	}
 
 private:
 	// The set of components with which a particular system is working with
 	std::vector<unsigned int> componentTypes;
 	std::vector<unsigned int> componentFlags;
+
+	// Sorted non-optional component types; used for finding the system's query
+	std::vector<unsigned int> requiredComponentTypes;
+
+	// The component types the system reads and writes
+	std::vector<unsigned int> readComponentTypes;
+	std::vector<unsigned int> writeComponentTypes;
+
+	bool isMainThreadOnly = false;
+	bool isParallel = false;
+
+	// Set by the ECS every time the system is updated
+	friend class ECS;
+	uint32_t lastRunTick = 0;
+	bool hasRun = false;
+	size_t numMatchedEntities = 0;
+	float lastUpdateTime = 0.0f;
 };
 
 class ECSSystemList
@@ -123,6 +266,9 @@ public:
 
 		// Add the system the list
 		systems.push_back(&system);
+
+		// The schedule needs to be rebuilt to include the new system
+		schedule.clear();
 		return true;
 	}
 
@@ -146,6 +292,22 @@ public:
 	 */
 	bool RemoveSystem(BaseECSSystem& system);
 
+	/**
+	 * Gets the order in which systems can be updated in parallel. The schedule is a list of
+	 * phases, and each phase is a list of indices of systems which do not conflict with each
+	 * other. A system is always placed in a later phase than every system before it in the list
+	 * which it conflicts with, so updating the phases one after another gives the same result as
+	 * updating the systems in the order they were added.
+	 * 
+	 * @see BaseECSSystem::ConflictsWith
+	 * 
+	 * @return The phases of the schedule.
+	 */
+	const std::vector<std::vector<unsigned int>>& GetSchedule();
+
 private:
 	std::vector<BaseECSSystem*> systems;
+
+	// Built when needed, and cleared whenever the list changes
+	std::vector<std::vector<unsigned int>> schedule;
 };
@@ -0,0 +1,184 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#include "ECSThreadPool.h"
+
+#include <algorithm> // std::min, std::max
+
+// The pool which the calling thread is a worker of, and the index of it's queue in that pool
+static thread_local const ECSThreadPool* currentPool = nullptr;
+static thread_local size_t currentQueue = 0;
+
+ECSThreadPool::ECSThreadPool(unsigned int numWorkers)
+{
+	// One queue per worker, plus the shared queue
+	for (unsigned int i = 0; i <= numWorkers; i++)
+	{
+		queues.push_back(std::make_unique<TaskQueue>());
+	}
+
+	for (unsigned int i = 0; i < numWorkers; i++)
+	{
+		workers.emplace_back(&ECSThreadPool::WorkerLoop, this, (size_t)i);
+	}
+}
+
+ECSThreadPool::~ECSThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		isShuttingDown = true;
+	}
+	sleepCondition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void ECSThreadPool::Submit(ECSTaskGroup& group, std::function<void()> task)
+{
+	group.remaining++;
+
+	// Counted before the task is queued, so that the count never drops below zero when the task
+	// is taken right away
+	numPendingTasks++;
+
+	// Workers push to their own queue, everyone else to the shared queue
+	TaskQueue& queue = *queues[GetCurrentQueue()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back({ std::move(task), &group });
+	}
+
+	// Wake up a sleeping worker. The lock makes sure a worker which is about to sleep sees the
+	// new task first.
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	sleepCondition.notify_one();
+}
+
+void ECSThreadPool::Wait(ECSTaskGroup& group)
+{
+	size_t queueIndex = GetCurrentQueue();
+
+	while (group.remaining > 0)
+	{
+		// Help with pending tasks rather than blocking. If there are none left, the remaining
+		// tasks of the group are already running on other threads.
+		if (!TryRunTask(queueIndex))
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void ECSThreadPool::ParallelFor(size_t count, size_t grainSize,
+	const std::function<void(size_t begin, size_t end)>& function)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	// Split the range into a few tasks per thread, so that threads which finish early can steal
+	// the remaining tasks
+	if (grainSize == 0)
+	{
+		grainSize = std::max<size_t>(1, count / ((workers.size() + 1) * 4));
+	}
+
+	// Not worth splitting; execute the function on this thread
+	if (grainSize >= count || workers.empty())
+	{
+		function(0, count);
+		return;
+	}
+
+	ECSTaskGroup group;
+
+	for (size_t begin = 0; begin < count; begin += grainSize)
+	{
+		size_t end = std::min(begin + grainSize, count);
+		Submit(group, [&function, begin, end]() { function(begin, end); });
+	}
+
+	Wait(group);
+}
+
+unsigned int ECSThreadPool::GetDefaultNumWorkers()
+{
+	unsigned int numThreads = std::thread::hardware_concurrency();
+	return numThreads > 1 ? numThreads - 1 : 0;
+}
+
+size_t ECSThreadPool::GetCurrentQueue() const
+{
+	return currentPool == this ? currentQueue : queues.size() - 1;
+}
+
+bool ECSThreadPool::TryRunTask(size_t queueIndex)
+{
+	if (numPendingTasks == 0)
+	{
+		return false;
+	}
+
+	Task task;
+	bool hasTask = false;
+
+	// Take the most recently submitted task from the thread's own queue
+	{
+		TaskQueue& queue = *queues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty())
+		{
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+			hasTask = true;
+		}
+	}
+
+	// Otherwise, steal the oldest task from another queue, starting with the next one
+	for (size_t i = 1; !hasTask && i < queues.size(); i++)
+	{
+		TaskQueue& queue = *queues[(queueIndex + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty())
+		{
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			hasTask = true;
+		}
+	}
+
+	if (!hasTask)
+	{
+		return false;
+	}
+
+	numPendingTasks--;
+
+	task.function();
+	task.group->remaining--;
+	return true;
+}
+
+void ECSThreadPool::WorkerLoop(size_t queueIndex)
+{
+	currentPool = this;
+	currentQueue = queueIndex;
+
+	while (!isShuttingDown)
+	{
+		if (TryRunTask(queueIndex))
+		{
+			continue;
+		}
+
+		// Sleep until there is a task to execute, or the pool is shutting down
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepCondition.wait(lock, [this] { return isShuttingDown || numPendingTasks > 0; });
+	}
+}
@@ -0,0 +1,138 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Keeps track of a group of tasks submitted to a thread pool, so that they can be waited on
+ * together.
+ */
+struct ECSTaskGroup
+{
+	// The number of tasks of the group which have not finished yet
+	std::atomic<unsigned int> remaining{ 0 };
+};
+
+/**
+ * @brief Work-stealing pool of worker threads used by the ECS for updating systems in parallel.
+ *
+ * Every worker has it's own queue of tasks. Tasks submitted by a worker go to the back of it's own
+ * queue, and the worker takes tasks from the back of it's queue first, which keeps related work
+ * on the same thread. A worker with an empty queue steals tasks from the front of the other
+ * queues. Tasks submitted by threads outside of the pool go to a shared queue.
+ *
+ * The thread which waits on a task group helps executing tasks until the group is finished, which
+ * means that tasks may themselves submit and wait on tasks without deadlocking the pool.
+ */
+class ECSThreadPool
+{
+public:
+	/**
+	 * @param numWorkers The number of worker threads to start. The thread waiting on tasks also
+	 *		executes tasks, so by default one less worker than the number of hardware threads is
+	 *		started.
+	 */
+	ECSThreadPool(unsigned int numWorkers = GetDefaultNumWorkers());
+
+	// Stops and joins all worker threads
+	~ECSThreadPool();
+
+	/**
+	 * Submits a task to be executed by the pool.
+	 *
+	 * @param group The group the task belongs to.
+	 * @param task The task to execute.
+	 */
+	void Submit(ECSTaskGroup& group, std::function<void()> task);
+
+	/**
+	 * Blocks until every task of a group has finished. The calling thread executes pending tasks
+	 * while it waits.
+	 *
+	 * @param group The group to wait on.
+	 */
+	void Wait(ECSTaskGroup& group);
+
+	/**
+	 * Splits a range of indices into smaller ranges, executes a function for every range on the
+	 * pool, and waits for all of them to finish.
+	 *
+	 * @param count The number of indices; the range is [0, count).
+	 * @param grainSize The number of indices per task. If 0, the range is split into a few tasks
+	 *		per thread.
+	 * @param function Called with the beginning and end of every range. Must be safe to call from
+	 *		multiple threads at the same time.
+	 */
+	void ParallelFor(size_t count, size_t grainSize,
+		const std::function<void(size_t begin, size_t end)>& function);
+
+	/** @brief Gets the number of worker threads, excluding the thread waiting on tasks. */
+	inline unsigned int GetNumWorkers() const { return (unsigned int)workers.size(); }
+
+	/** @brief Gets one less than the number of hardware threads, or 0 if it is unknown. */
+	static unsigned int GetDefaultNumWorkers();
+
+private:
+	/** @brief Used internally for storing a task along with the group it belongs to. */
+	struct Task
+	{
+		std::function<void()> function;
+		ECSTaskGroup* group;
+	};
+
+	/** @brief Used internally for a queue of tasks which can be stolen from. */
+	struct TaskQueue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<std::thread> workers;
+
+	// One queue per worker, followed by the shared queue for threads outside of the pool
+	std::vector<std::unique_ptr<TaskQueue>> queues;
+
+	// The number of tasks which have been submitted but not started yet, across all queues
+	std::atomic<unsigned int> numPendingTasks{ 0 };
+
+	// Used for putting idle workers to sleep
+	std::mutex sleepMutex;
+	std::condition_variable sleepCondition;
+	std::atomic<bool> isShuttingDown{ false };
+
+	/**
+	 * Used internally for getting the queue of the calling thread.
+	 *
+	 * @return The index of the calling worker's queue, or the index of the shared queue if the
+	 *		calling thread is not a worker of this pool.
+	 */
+	size_t GetCurrentQueue() const;
+
+	/**
+	 * Used internally for executing a single pending task, if there is one. The task is taken from
+	 * the back of the thread's own queue if possible, otherwise stolen from another queue.
+	 *
+	 * @param queueIndex The index of the calling thread's queue.
+	 * @return If a task was executed or not.
+	 */
+	bool TryRunTask(size_t queueIndex);
+
+	/**
+	 * Entry point of the worker threads.
+	 *
+	 * @param queueIndex The index of the worker's own queue.
+	 */
+	void WorkerLoop(size_t queueIndex);
+
+	// Disallow copy and assign
+	ECSThreadPool(const ECSThreadPool& other) = delete;
+	ECSThreadPool& operator=(const ECSThreadPool& other) = delete;
+};
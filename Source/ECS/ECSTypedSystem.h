@@ -0,0 +1,188 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#pragma once
+
+#include "ECSSystem.h"
+
+#include <type_traits> // std::remove_reference_t, std::conditional_t
+#include <utility> // std::index_sequence
+
+/** @brief Declares that a typed system only reads a component type. Passed as a const reference. */
+template<typename Component>
+struct Read {};
+
+/** @brief Declares that a typed system modifies a component type. Passed as a reference. */
+template<typename Component>
+struct Write {};
+
+/**
+ * @brief Declares that a typed system works with a component type only if the entity has it.
+ * Passed as a pointer, which is nullptr if the entity does not have the component type.
+ *
+ * Wraps either Read<Component> or Write<Component>. A plain component type is the same as
+ * Write<Component>.
+ */
+template<typename Access>
+struct Optional {};
+
+/**
+ * @brief Declares that a typed system is only updated with entities whose component of this type
+ * changed since the system was last updated. Wraps Read<Component>, Write<Component> or
+ * Optional<...>, and is passed the same way as the access it wraps.
+ *
+ * @see BaseECSSystem::FLAG_ONLY_CHANGED
+ */
+template<typename Access>
+struct OnlyChanged {};
+
+template<typename Component, bool IsWritable>
+/**
+ * Used internally for getting a component from a span. How the span stores it's components is
+ * known from the component type, so no check is needed per component.
+ *
+ * @return Reference to the component, or a proxy for components stored as a struct of arrays.
+ */
+inline decltype(auto) ECSGetSpanComponent(const ECSComponentSpan& span, unsigned int index)
+{
+	if constexpr (ECSSoAFields<Component>::IS_SOA)
+	{
+		return ECSComponentProxy<Component>(span, index, IsWritable);
+	}
+	else if constexpr (ECSHasStableAddress<Component>::value)
+	{
+		return *span.As<Component*>()[index];
+	}
+	else
+	{
+		return span.As<Component>()[index];
+	}
+}
+
+template<typename Component>
+/**
+ * @brief Used internally for resolving how a typed system accesses a component type.
+ *
+ * A plain component type is accessed for writing.
+ */
+struct ECSAccessTraits
+{
+	using Type = Component;
+	using Reference = std::conditional_t<ECSSoAFields<Component>::IS_SOA,
+		ECSComponentProxy<Component>, Component&>;
+
+	static constexpr unsigned int FLAGS = 0;
+
+	static inline Reference Get(const ECSComponentSpan& span, unsigned int index)
+	{
+		return ECSGetSpanComponent<Component, true>(span, index);
+	}
+};
+
+template<typename Component>
+struct ECSAccessTraits<Write<Component>> : public ECSAccessTraits<Component> {};
+
+template<typename Component>
+struct ECSAccessTraits<Read<Component>>
+{
+	using Type = Component;
+	using Reference = std::conditional_t<ECSSoAFields<Component>::IS_SOA,
+		ECSComponentProxy<Component>, const Component&>;
+
+	static constexpr unsigned int FLAGS = BaseECSSystem::FLAG_READ_ONLY;
+
+	static inline Reference Get(const ECSComponentSpan& span, unsigned int index)
+	{
+		return ECSGetSpanComponent<Component, false>(span, index);
+	}
+};
+
+template<typename Access>
+struct ECSAccessTraits<Optional<Access>>
+{
+	using Type = typename ECSAccessTraits<Access>::Type;
+
+	// Proxies convert to a pointer themselves
+	using Reference = std::conditional_t<ECSSoAFields<Type>::IS_SOA,
+		typename ECSAccessTraits<Access>::Reference,
+		std::remove_reference_t<typename ECSAccessTraits<Access>::Reference>*>;
+
+	static constexpr unsigned int FLAGS = ECSAccessTraits<Access>::FLAGS |
+		BaseECSSystem::FLAG_OPTIONAL;
+
+	static inline Reference Get(const ECSComponentSpan& span, unsigned int index)
+	{
+		if constexpr (ECSSoAFields<Type>::IS_SOA)
+		{
+			return ECSAccessTraits<Access>::Get(span, index);
+		}
+		else
+		{
+			return span ? &ECSAccessTraits<Access>::Get(span, index) : nullptr;
+		}
+	}
+};
+
+template<typename Access>
+struct ECSAccessTraits<OnlyChanged<Access>> : public ECSAccessTraits<Access>
+{
+	static constexpr unsigned int FLAGS = ECSAccessTraits<Access>::FLAGS |
+		BaseECSSystem::FLAG_ONLY_CHANGED;
+};
+
+template<typename Derived, typename... Accesses>
+/**
+ * @brief System which declares the component types it works with as template arguments.
+ *
+ * The derived class implements an Update function taking the delta time followed by one argument
+ * per component type, in the same order as the template arguments:
+ *
+ *		class MySystem : public TypedSystem<MySystem, Read<A>, Write<B>, Optional<C>>
+ *		{
+ *		public:
+ *			void Update(float deltaTime, const A& a, B& b, C* c);
+ *		};
+ *
+ * The component types, flags and access modes are registered from the template arguments, and
+ * every run of entities is walked with a loop calling Update directly on the derived class. This
+ * avoids the virtual call and the casts per entity, and allows the compiler to inline Update into
+ * the loop.
+ *
+ * Component types stored as a struct of arrays are passed as an ECSComponentProxy, which converts
+ * to the same reference or pointer as any other component type.
+ *
+ * @tparam Derived The class deriving from the typed system.
+ * @tparam Accesses Read<Component>, Write<Component>, Optional<...> or OnlyChanged<...> for every
+ *		component type.
+ */
+class TypedSystem : public BaseECSSystem
+{
+public:
+	TypedSystem() : BaseECSSystem()
+	{
+		(AddComponentType(ECSAccessTraits<Accesses>::Type::ID, ECSAccessTraits<Accesses>::FLAGS),
+			...);
+	}
+
+	virtual void UpdateBatch(float deltaTime, const ECSComponentSpan* components,
+		unsigned int count) override
+	{
+		UpdateBatchInternal(deltaTime, components, count, std::index_sequence_for<Accesses...>());
+	}
+
+private:
+	template<size_t... Indices>
+	/**
+	 * Used internally for calling Update on every entity of a run, with the span of every
+	 * component type matched to the argument it is passed as.
+	 */
+	inline void UpdateBatchInternal(float deltaTime, const ECSComponentSpan* components,
+		unsigned int count, std::index_sequence<Indices...>)
+	{
+		Derived& derived = static_cast<Derived&>(*this);
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			derived.Update(deltaTime, ECSAccessTraits<Accesses>::Get(components[Indices], i)...);
+		}
+	}
+};
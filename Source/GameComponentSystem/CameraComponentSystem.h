@@ -3,7 +3,9 @@
 #pragma once
 
 #include "ECS/ECS.h"
+#include "ECS/ECSTypedSystem.h"
 #include "TransformComponent.h"
+#include "TransformPropagationSystem.h"
 #include "GameRenderContext.h"
 #include "Rendering/Camera.h"
 #include "Transform.h"
@@ -19,31 +21,60 @@ struct CameraComponent : public ECSComponent<CameraComponent>
 	Transform offset;
 };
 
+// Not written to scene files; the camera only exists at runtime
+template<>
+struct ECSIsSerializable<CameraComponent> : std::false_type {};
+
 /**
  * @brief System which updates the position and rotation of the camera according to
  * the state of the camera component.
+ *
+ * The camera follows the world transform of the entity, so a camera attached to a parent entity
+ * moves with it. Should be updated after the TransformPropagationSystem, so that the world
+ * transform is up to date.
+ *
+ * The camera is written to, so any system which reads the camera, such as for rendering, must
+ * declare read access to the camera component.
  */
-class CameraSystem : public BaseECSSystem
+class CameraSystem : public TypedSystem<CameraSystem, Read<WorldTransformComponent>,
+	Write<CameraComponent>>
 {
 public:
-	CameraSystem() : BaseECSSystem()
-	{
-		AddComponentType(TransformComponent::ID);
-		AddComponentType(CameraComponent::ID);
-	}
-
-	virtual void UpdateComponents(float deltaTime, BaseECSComponent** components)
+	void Update(float deltaTime, const WorldTransformComponent& worldTransform,
+		CameraComponent& camera)
 	{
-		TransformComponent* transform = (TransformComponent*)components[0];
-		CameraComponent* camera = (CameraComponent*)components[1];
-
 		// Update position
-		camera->camera->SetPosition(
-			transform->transform.GetPosition() + camera->offset.GetPosition());	
-		
+		camera.camera->SetPosition(
+			glm::vec3(worldTransform.model[3]) + camera.offset.GetPosition());
+
 		// Update rotation
-		camera->camera->SetRotation(
-			transform->transform.GetRotation() + camera->offset.GetRotation());
+		camera.camera->SetRotation(
+			GetRotation(worldTransform.model) + camera.offset.GetRotation());
 	}
 private:
+	/**
+	 * Gets the rotation of a world matrix, in degrees, in the same order as Transform; rotated
+	 * around x, then y, then z.
+	 *
+	 * @param model The world matrix, which may be scaled.
+	 * @return The rotation around each axis, in degrees.
+	 */
+	static glm::vec3 GetRotation(const glm::mat4& model)
+	{
+		// Each column is an axis of the rotation, scaled
+		const glm::vec3 x = glm::normalize(glm::vec3(model[0]));
+		const glm::vec3 y = glm::normalize(glm::vec3(model[1]));
+		const glm::vec3 z = glm::normalize(glm::vec3(model[2]));
+
+		// The rotation around z is found first, and undone from the other axes before finding
+		// the rotations around x and y, which stays accurate when facing straight up or down
+		const float rotationZ = glm::atan(x.y, x.x);
+		const float cz = glm::cos(rotationZ);
+		const float sz = glm::sin(rotationZ);
+
+		const float rotationX = glm::atan(sz * z.x - cz * z.y, cz * y.y - sz * y.x);
+		const float rotationY = glm::atan(-x.z, cz * x.x + sz * x.y);
+
+		return glm::degrees(glm::vec3(rotationX, rotationY, rotationZ));
+	}
 };
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "ECS/ECS.h"
+#include "ECS/ECSTypedSystem.h"
 #include "Transform.h"
 #include "TransformComponent.h"
 #include "Events/AxisControl.h"
@@ -18,26 +19,22 @@ struct FreecamControlComponent : public ECSComponent<FreecamControlComponent>
 	MotionControl* motion;
 };
 
-class FreecamControlSystem : public BaseECSSystem
+// Not written to scene files; the controls only exist at runtime
+template<>
+struct ECSIsSerializable<FreecamControlComponent> : std::false_type {};
+
+class FreecamControlSystem : public TypedSystem<FreecamControlSystem, Write<TransformComponent>,
+	Read<FreecamControlComponent>>
 {
 public:
-	FreecamControlSystem() : BaseECSSystem()
+	void Update(float deltaTime, TransformComponent& transformComponent,
+		const FreecamControlComponent& freecamControlComponent)
 	{
-		AddComponentType(TransformComponent::ID);
-		AddComponentType(FreecamControlComponent::ID);
-	}
-
-	virtual void UpdateComponents(float deltaTime, BaseECSComponent** components)
-	{
-		const auto transformComponent = (TransformComponent*)components[0];
-		const auto freecamControlComponent = (FreecamControlComponent*)components[1];
-		const auto motionComponent = (MotionComponent*)components[2];
-
-		glm::vec3& position = transformComponent->transform.GetPosition();
-		glm::vec3& rotation = transformComponent->transform.GetRotation();
+		glm::vec3& position = transformComponent.transform.GetPosition();
+		glm::vec3& rotation = transformComponent.transform.GetRotation();
 
-		rotation.y -= freecamControlComponent->motion->Get().x;
-		rotation.x -= freecamControlComponent->motion->Get().y;
+		rotation.y -= freecamControlComponent.motion->Get().x;
+		rotation.x -= freecamControlComponent.motion->Get().y;
 
 		glm::vec3 forward(0.f, 0.f, -1.f);
 		forward = glm::rotate(forward, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
@@ -49,7 +46,7 @@ public:
 		right = glm::rotate(right, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
 		right = glm::rotate(right, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
 
-		position += forward * freecamControlComponent->forward->Get() * deltaTime;
-		position += right * freecamControlComponent->right->Get() * deltaTime;
+		position += forward * freecamControlComponent.forward->Get() * deltaTime;
+		position += right * freecamControlComponent.right->Get() * deltaTime;
 	}
 };
\ No newline at end of file
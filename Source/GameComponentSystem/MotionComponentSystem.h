@@ -27,6 +27,7 @@
 #pragma once
 
 #include "ECS/ECS.h"
+#include "ECS/ECSTypedSystem.h"
 #include "MotionIntegrators.h"
 
 #include <GLM/glm.hpp>
@@ -38,29 +39,62 @@ struct MotionComponent : public ECSComponent<MotionComponent>
 	glm::vec3 force = glm::vec3(0.0f, 0.0f, 0.0f);
 };
 
+/**
+ * Velocities and forces are stored as separate arrays, so that the motion system integrates them
+ * with a single loop over contiguous floats.
+ */
+template<>
+struct ECSSoAFields<MotionComponent>
+{
+	static constexpr bool IS_SOA = true;
+
+	// Field indices, in the order returned by Get
+	static constexpr unsigned int VELOCITY = 0;
+	static constexpr unsigned int FORCE = 1;
+
+	static std::vector<ECSField> Get()
+	{
+		return { ECSField::Of(&MotionComponent::velocity), ECSField::Of(&MotionComponent::force) };
+	}
+};
+
 /**
  * @brief System which updates the position of the entity according to the state of the motion
  * component. Uses a motion integrator to determine the new position every update.
  */
-class MotionSystem : public BaseECSSystem
+class MotionSystem : public TypedSystem<MotionSystem, Write<TransformComponent>,
+	Write<MotionComponent>>
 {
 public:
-	MotionSystem() : BaseECSSystem()
+	MotionSystem()
 	{
-		AddComponentType(TransformComponent::ID);
-		AddComponentType(MotionComponent::ID);
+		// Every entity is moved independently of the others
+		SetParallel(true);
 	}
 
-	virtual void UpdateComponents(float deltaTime, BaseECSComponent** components)
+	void Update(float deltaTime, TransformComponent& transform, MotionComponent& motion)
 	{
-		TransformComponent* transform = (TransformComponent*)components[0];
-		MotionComponent* motion = (MotionComponent*)components[1];
-
 		// Update position of the entity...
-		glm::vec3 newPosition = transform->transform.GetPosition();
-		MotionIntegrators::ModifiedEuler(newPosition, motion->velocity,
-			motion->force, deltaTime);
-		transform->transform.SetPosition(newPosition);
+		MotionIntegrators::ModifiedEuler(transform.transform.GetPosition(), motion.velocity,
+			motion.force, deltaTime);
+	}
+
+	virtual void UpdateBatch(float deltaTime, const ECSComponentSpan* components,
+		unsigned int count) override
+	{
+		// Work with the arrays of the motion components directly, rather than through a proxy
+		// per entity
+		TransformComponent* transforms = components[0].As<TransformComponent>();
+		glm::vec3* velocities = components[1].GetField<glm::vec3>(
+			ECSSoAFields<MotionComponent>::VELOCITY);
+		const glm::vec3* forces = components[1].GetField<glm::vec3>(
+			ECSSoAFields<MotionComponent>::FORCE);
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			MotionIntegrators::ModifiedEuler(transforms[i].transform.GetPosition(), velocities[i],
+				forces[i], deltaTime);
+		}
 	}
 
 private:
@@ -27,7 +27,9 @@
 #pragma once
 
 #include "ECS/ECS.h"
-#include "TransformComponent.h"
+#include "ECS/ECSTypedSystem.h"
+#include "TransformPropagationSystem.h"
+#include "CameraComponentSystem.h"
 #include "GameRenderContext.h"
 
 /** @brief Component which defines the visible mesh of an entity. */
@@ -40,26 +42,35 @@ struct RenderableMeshComponent : public ECSComponent<RenderableMeshComponent>
 	Texture* texture = nullptr;
 };
 
-/** @brief System which draws visible mesh of the entity every update. */
-class RenderableMeshSystem : public BaseECSSystem
+// Not written to scene files; the mesh and texture only exist at runtime
+template<>
+struct ECSIsSerializable<RenderableMeshComponent> : std::false_type {};
+
+/**
+ * @brief System which draws visible mesh of the entity every update, using the world matrix
+ * cached by the TransformPropagationSystem.
+ */
+class RenderableMeshSystem : public TypedSystem<RenderableMeshSystem,
+	Read<WorldTransformComponent>, Read<RenderableMeshComponent>>
 {
 public:
 	/**
 	 * @param context The game render context, which bridges the gap between the high-level and
 	 * low-level rendering commands
 	 */
-	RenderableMeshSystem(GameRenderContext& context) : BaseECSSystem(), context(context)
+	RenderableMeshSystem(GameRenderContext& context) : context(context)
 	{
-		AddComponentType(TransformComponent::ID);
-		AddComponentType(RenderableMeshComponent::ID);
+		// Rendering commands must be issued from the thread which owns the render context
+		SetMainThreadOnly(true);
+
+		// Meshes are drawn with the view projection of the camera, which the CameraSystem writes
+		AddComponentAccess(CameraComponent::ID, false);
 	}
 
-	virtual void UpdateComponents(float deltaTime, BaseECSComponent** components)
+	void Update(float deltaTime, const WorldTransformComponent& worldTransform,
+		const RenderableMeshComponent& mesh)
 	{
-		TransformComponent* transform = (TransformComponent*)components[0];
-		RenderableMeshComponent* mesh = (RenderableMeshComponent*)components[1];
-
-		context.RenderMesh(*mesh->mesh, *mesh->texture, transform->transform.GetModel());
+		context.RenderMesh(*mesh.mesh, *mesh.texture, worldTransform.model);
 	}
 private:
 	GameRenderContext& context;
@@ -0,0 +1,194 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#include "TransformPropagationSystem.h"
+
+#include <algorithm> // std::sort
+#include <climits> // UINT_MAX
+#include <iostream>
+#include <unordered_map>
+
+TransformPropagationSystem::TransformPropagationSystem(ECS& ecs) : ECSListener(), ecs(ecs)
+{
+	// Only entities with a parent, a transform and a world transform are sorted
+	AddComponentID(ParentComponent::ID);
+	AddComponentID(TransformComponent::ID);
+	AddComponentID(WorldTransformComponent::ID);
+
+	worldTransformSystems.AddSystem(worldTransformSystem);
+}
+
+void TransformPropagationSystem::OnMakeEntity(EntityHandle handle)
+{
+	isHierarchyChanged = true;
+}
+
+void TransformPropagationSystem::OnMakeEntities(const EntityHandle* handles, size_t count)
+{
+	isHierarchyChanged = true;
+}
+
+void TransformPropagationSystem::OnRemoveEntity(EntityHandle handle)
+{
+	isHierarchyChanged = true;
+}
+
+void TransformPropagationSystem::OnAddComponent(EntityHandle handle, unsigned int id)
+{
+	isHierarchyChanged = true;
+}
+
+void TransformPropagationSystem::OnRemoveComponent(EntityHandle handle, unsigned int id)
+{
+	isHierarchyChanged = true;
+}
+
+void TransformPropagationSystem::Update()
+{
+	// Entities without a parent first, since the world matrices of their children depend on them
+	ecs.UpdateSystems(worldTransformSystems, 0.0f);
+
+	// Changing the parent of an entity does not make or remove anything, but it's depth may have
+	// changed
+	for (size_t i = 0; i < children.size() && !isHierarchyChanged; i++)
+	{
+		if (ECSIsTickNewer(ecs.GetComponentChangeTick<ParentComponent>(children[i].handle),
+			lastUpdateTick))
+		{
+			isHierarchyChanged = true;
+		}
+	}
+
+	// Every world matrix is recomputed after sorting, since children may have moved to another
+	// parent
+	bool isSorted = isHierarchyChanged;
+	if (isHierarchyChanged)
+	{
+		SortChildren();
+		isHierarchyChanged = false;
+	}
+
+	// Parents come before their children, so the world matrix of the parent is always up to date
+	for (Child& child : children)
+	{
+		const WorldTransformComponent* parentWorldTransform =
+			ecs.GetComponent<WorldTransformComponent>(child.parent);
+
+		// A child whose parent was removed, or has no world transform, is placed relative to the
+		// world instead, as is a child which breaks a cycle; otherwise every child in the cycle
+		// would be multiplied by it's own descendant's matrix, forever
+		bool hasParent = !child.isCycleRoot && parentWorldTransform != nullptr;
+
+		if (!isSorted && hasParent == child.hasParent &&
+			!ECSIsTickNewer(ecs.GetComponentChangeTick<TransformComponent>(child.handle),
+			lastUpdateTick) &&
+			(!hasParent || !ECSIsTickNewer(
+			ecs.GetComponentChangeTick<WorldTransformComponent>(child.parent), lastUpdateTick)))
+		{
+			continue;
+		}
+
+		child.hasParent = hasParent;
+
+		glm::mat4 model = ecs.GetComponent<TransformComponent>(child.handle)->transform.GetModel();
+		if (hasParent)
+		{
+			model = parentWorldTransform->model * model;
+		}
+
+		// Marks the world matrix as changed, so that the children of this child are updated too
+		ecs.GetMut<WorldTransformComponent>(child.handle)->model = model;
+	}
+
+	// Changes made from here on are picked up by the next update
+	lastUpdateTick = ecs.AdvanceChangeTick();
+}
+
+void TransformPropagationSystem::SortChildren()
+{
+	children.clear();
+
+	// Find every entity with a parent
+	ECSQuery& query = ecs.GetQuery({ ParentComponent::ID, TransformComponent::ID,
+		WorldTransformComponent::ID });
+
+	std::unordered_map<EntityHandle, size_t> indices;
+
+	for (ECSArchetype* archetype : query.GetArchetypes())
+	{
+		int column = archetype->GetColumn(ParentComponent::ID);
+
+		for (unsigned int row = 0; row < archetype->size(); row++)
+		{
+			Child child;
+			child.handle = archetype->GetEntity(row);
+			child.parent = ((ParentComponent*)archetype->GetComponent(row, column))->parent;
+			child.depth = 0;
+			child.hasParent = false;
+			child.isCycleRoot = false;
+
+			indices[child.handle] = children.size();
+			children.push_back(child);
+		}
+	}
+
+	// Depth of a child which is still being computed; reaching it again means the hierarchy has a
+	// cycle
+	constexpr unsigned int VISITING = UINT_MAX;
+
+	// Children whose depth is being computed, from the child up towards the root
+	std::vector<size_t> path;
+
+	for (size_t i = 0; i < children.size(); i++)
+	{
+		path.clear();
+
+		size_t current = i;
+		unsigned int depth = 0;
+
+		// Walk up the hierarchy until reaching an entity whose depth is known, or an entity
+		// without a parent
+		while (true)
+		{
+			if (children[current].depth == VISITING)
+			{
+				std::cerr << "The entity hierarchy contains a cycle." << std::endl;
+
+				// Break the cycle by placing the last child of the path at the top, ignoring it's
+				// parent
+				children[path.back()].depth = 1;
+				children[path.back()].isCycleRoot = true;
+				path.pop_back();
+				depth = 1;
+				break;
+			}
+
+			if (children[current].depth != 0)
+			{
+				depth = children[current].depth;
+				break;
+			}
+
+			children[current].depth = VISITING;
+			path.push_back(current);
+
+			auto it = indices.find(children[current].parent);
+			if (it == indices.end())
+			{
+				break;
+			}
+
+			current = it->second;
+		}
+
+		// Every child on the path is one level deeper than it's parent
+		for (auto it = path.rbegin(); it != path.rend(); it++)
+		{
+			children[*it].depth = ++depth;
+		}
+	}
+
+	std::sort(children.begin(), children.end(), [](const Child& a, const Child& b)
+		{
+			return a.depth < b.depth;
+		});
+}
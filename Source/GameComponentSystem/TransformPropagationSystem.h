@@ -0,0 +1,130 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#pragma once
+
+#include "ECS/ECS.h"
+#include "ECS/ECSTypedSystem.h"
+#include "TransformComponent.h"
+
+#include <GLM/glm.hpp>
+
+#include <vector>
+
+/**
+ * @brief Component which attaches an entity to a parent entity. The entity's transform is then
+ * relative to the world transform of the parent.
+ */
+struct ParentComponent : public ECSComponent<ParentComponent>
+{
+	EntityHandle parent;
+};
+
+/**
+ * @brief Component which caches the local-to-world matrix of an entity, kept up to date by the
+ * TransformPropagationSystem. Systems which need an entity's matrix, such as rendering, should
+ * read it from here instead of building it from the transform.
+ */
+struct WorldTransformComponent : public ECSComponent<WorldTransformComponent>
+{
+	glm::mat4 model = glm::mat4(1.0f);
+};
+
+/**
+ * @brief System which computes the world matrix of entities without a parent, only for entities
+ * whose transform changed since the previous update. Entities with a parent are left to the
+ * TransformPropagationSystem.
+ */
+class WorldTransformSystem : public TypedSystem<WorldTransformSystem,
+	OnlyChanged<Read<TransformComponent>>, Write<WorldTransformComponent>,
+	Optional<Read<ParentComponent>>>
+{
+public:
+	WorldTransformSystem()
+	{
+		// Every world matrix is computed independently of the others
+		SetParallel(true);
+	}
+
+	void Update(float deltaTime, const TransformComponent& transform,
+		WorldTransformComponent& worldTransform, const ParentComponent* parent)
+	{
+		if (parent == nullptr)
+		{
+			worldTransform.model = transform.transform.GetModel();
+		}
+	}
+};
+
+/**
+ * @brief Keeps the world matrices of every entity with a transform and a world transform up to
+ * date, including entities attached to a parent.
+ *
+ * Entities with a parent are kept in an array sorted by their depth in the hierarchy, so that a
+ * single pass over the array always computes a parent's world matrix before those of it's
+ * children. The array is only rebuilt when the hierarchy changes. A child's world matrix is only
+ * recomputed if it's transform, it's parent, or it's parent's world matrix changed since the
+ * previous update, so unchanged subtrees cost a few lookups per entity.
+ *
+ * Should be updated once per frame, after game logic and before rendering.
+ */
+class TransformPropagationSystem : public ECSListener
+{
+public:
+	/** @param ecs The ECS whose entities should be kept up to date. */
+	TransformPropagationSystem(ECS& ecs);
+
+	/** @see ECSListener::OnMakeEntity */
+	virtual void OnMakeEntity(EntityHandle handle);
+
+	/** @see ECSListener::OnMakeEntities */
+	virtual void OnMakeEntities(const EntityHandle* handles, size_t count);
+
+	/** @see ECSListener::OnRemoveEntity */
+	virtual void OnRemoveEntity(EntityHandle handle);
+
+	/** @see ECSListener::OnAddComponent */
+	virtual void OnAddComponent(EntityHandle handle, unsigned int id);
+
+	/** @see ECSListener::OnRemoveComponent */
+	virtual void OnRemoveComponent(EntityHandle handle, unsigned int id);
+
+	/** @brief Computes the world matrices which are out of date. */
+	void Update();
+
+private:
+	/** @brief Used internally for referring to an entity with a parent. */
+	struct Child
+	{
+		EntityHandle handle;
+		EntityHandle parent;
+
+		// The number of ancestors of the entity
+		unsigned int depth;
+
+		// If the world matrix was last computed relative to the parent, rather than the world
+		bool hasParent;
+
+		// If the entity's parent link was ignored to break a cycle in the hierarchy; the entity
+		// is then placed relative to the world, as if it had no parent
+		bool isCycleRoot;
+	};
+
+	ECS& ecs;
+
+	// Computes the world matrices of entities without a parent
+	WorldTransformSystem worldTransformSystem;
+	ECSSystemList worldTransformSystems;
+
+	// Every entity with a parent, sorted by depth
+	std::vector<Child> children;
+
+	// If entities with a parent were made or removed, or had a parent added or removed, since the
+	// children were last sorted
+	bool isHierarchyChanged = true;
+
+	// The change tick of the ECS at the end of the previous update
+	uint32_t lastUpdateTick = 0;
+
+	/** @brief Used internally for finding every entity with a parent, and sorting them by depth. */
+	void SortChildren();
+};
@@ -26,7 +26,6 @@
 
 #include "InteractionWorld.h"
 
-#include "Algorithm/Octree.h"
 #include "Physics/PhysicsCollision.h"
 
 #include <algorithm>
@@ -39,6 +38,17 @@ void InteractionWorld::OnMakeEntity(EntityHandle handle)
 	AddEntity(handle);
 }
 
+void InteractionWorld::OnMakeEntities(const EntityHandle* handles, size_t count)
+{
+	// Make room for all of the entities at once
+	entities.reserve(entities.size() + count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		AddEntity(handles[i]);
+	}
+}
+
 void InteractionWorld::OnRemoveEntity(EntityHandle handle)
 {
 	// OnRemoveEntity is only called if the entity contains both a transform and collider component
@@ -107,72 +117,35 @@ void InteractionWorld::ProcessInteractions(float deltaTime)
 	// Remove entitiesToRemove and update entitiesToUpdate
 	RemoveAndUpdateEntities();
 
-	std::vector<std::pair<EntityHandle, const AABB>> data;
-	float min =  std::numeric_limits<float>::infinity();
-	float max = -std::numeric_limits<float>::infinity();
-
-	for (const EntityInternal& entity : entities)
-	{
-		// Get the collider component of the entity
-		const auto colliderComponent = ecs.GetComponent<ColliderComponent>(entity.handle);
-
-		const AABB transformedAABB = colliderComponent->aabb.Translate(
-			ecs.GetComponent<TransformComponent>(entity.handle)->transform.GetPosition());
+	// Bring the broadphase up to date with the entities which changed since the previous update
+	UpdateBroadphase();
 
-		data.emplace_back(entity.handle, transformedAABB);
-
-		const glm::vec3 minExtents = transformedAABB.GetMinExtents();
-		const glm::vec3 maxExtents = transformedAABB.GetMaxExtents();
-		min = std::min({ min, minExtents.x, minExtents.y, minExtents.z });
-		max = std::max({ max, maxExtents.x, maxExtents.y, maxExtents.z });
-	}
-
-	auto octree = Algorithm::Octree<EntityHandle>(AABB(glm::vec3(min), glm::vec3(max)));
-
-	for (const auto& [handle, objectBounds] : data)
-	{
-		octree.Insert(handle, objectBounds);
-	}
+	// Broadphase; find the pairs of entities which may be colliding, without testing every pair
+	// of entities
+	pairs.clear();
+	broadphase->FindPairs(pairs);
 
 	std::vector<Collision<EntityInternal&>> collisions;
 
-	// Go through the list of entities, test intersections in range
-	for (size_t i = 0; i < entities.size(); i++)
+	// Narrowphase; test the colliders of every pair found by the broadphase
+	for (const auto& [handleA, handleB] : pairs)
 	{
-		// Find intersections for this entity...
-
-		// Iterate over entities, start at i + 1
-		// As the order of the two does not matter, this will ensure that i and j will be a
-		// unique pair of entities
-
-		for (size_t j = i + 1; j < entities.size(); j++)
+		auto itA = entityIndices.find(handleA);
+		auto itB = entityIndices.find(handleB);
+		if (itA == entityIndices.end() || itB == entityIndices.end())
 		{
+			continue;
+		}
 
-			if (!octree.AreRelated(entities[i].handle, entities[j].handle))
-			{
-				continue; 
-			}
-
-			const auto transformComponentA = ecs.GetComponent<TransformComponent>(entities[i].handle);
-			const auto transformComponentB = ecs.GetComponent<TransformComponent>(entities[j].handle);
-
-			const auto colliderComponentA = ecs.GetComponent<ColliderComponent>(entities[i].handle);
-			const auto colliderComponentB = ecs.GetComponent<ColliderComponent>(entities[j].handle);
-
-			Collider* colliderA;
-			Collider* colliderB;
-
-			// https://stackoverflow.com/a/53166942
-			std::visit([&colliderA](auto&& collider) { colliderA = &collider; }, colliderComponentA->collider);
-			std::visit([&colliderB](auto&& collider) { colliderB = &collider; }, colliderComponentB->collider);
+		EntityInternal& entityA = entities[itA->second];
+		EntityInternal& entityB = entities[itB->second];
 
-			CollisionPoints points = colliderA->TestCollision(&transformComponentA->transform,
-				colliderB, &transformComponentB->transform);
+		CollisionPoints points = entityA.collider->TestCollision(entityA.transform,
+			entityB.collider, entityB.transform);
 
-			if (points.isColliding)
-			{
-				collisions.emplace_back(entities[i], entities[j], points);
-			}
+		if (points.isColliding)
+		{
+			collisions.emplace_back(entityA, entityB, points);
 		}
 	}
 
@@ -213,8 +186,11 @@ void InteractionWorld::ProcessInteraction(float deltaTime, const EntityInternal&
 				{
 					// Get the component of the type from the interactor entity
 					// Add it to the interactor components list
-					interactorComponents[i] = ecs.GetComponentByType(interactor.handle,
-						interaction->GetInteractorComponents()[i]);
+					// Only the components the interaction writes are marked as changed
+					const unsigned int componentID = interaction->GetInteractorComponents()[i];
+					interactorComponents[i] = interaction->GetInteractorWrites()[i] ?
+						ecs.GetMutByType(interactor.handle, componentID) :
+						ecs.GetComponentByType(interactor.handle, componentID);
 				}
 
 				// Iterate over all required component types for the interactee
@@ -222,8 +198,10 @@ void InteractionWorld::ProcessInteraction(float deltaTime, const EntityInternal&
 				{
 					// Get the component of the type from the interactee entity
 					// Add it to the interactee components list
-					interacteeComponents[i] = ecs.GetComponentByType(interactee.handle,
-						interaction->GetInteracteeComponents()[i]);
+					const unsigned int componentID = interaction->GetInteracteeComponents()[i];
+					interacteeComponents[i] = interaction->GetInteracteeWrites()[i] ?
+						ecs.GetMutByType(interactee.handle, componentID) :
+						ecs.GetComponentByType(interactee.handle, componentID);
 				}
 
 				// Pass in all relevant data to the interaction
@@ -234,6 +212,22 @@ void InteractionWorld::ProcessInteraction(float deltaTime, const EntityInternal&
 	}
 }
 
+void InteractionWorld::SetBroadphase(IBroadphase* broadphase)
+{
+	// The previous broadphase no longer needs to keep track of the entities
+	this->broadphase->Clear();
+
+	this->broadphase = broadphase != nullptr ? broadphase : &defaultBroadphase;
+	this->broadphase->Clear();
+
+	// Every entity is added to the new broadphase by the next update
+	for (EntityInternal& entity : entities)
+	{
+		entity.isInBroadphase = false;
+	}
+	chunkVersions.clear();
+}
+
 void InteractionWorld::AddInteraction(Interaction* interaction)
 {
 	// Add the interaction
@@ -272,11 +266,31 @@ void InteractionWorld::RemoveAndUpdateEntities()
 				// If the two entities match, remove the entity
 				if (entities[i].handle == entitiesToRemove[j])
 				{
+					// The entity no longer takes part in collision detection
+					if (entities[i].isInBroadphase)
+					{
+						broadphase->Remove(entities[i].handle);
+					}
+
+					// Another entity with the same handle may have been added since, in which
+					// case the lookup refers to that entity instead
+					auto it = entityIndices.find(entities[i].handle);
+					if (it != entityIndices.end() && it->second == i)
+					{
+						entityIndices.erase(it);
+					}
+
 					// Swap the entity being removed with the last element in the entities list
 					std::swap(entities[i], entities[entities.size() - 1]);
 					// Remove the last element
 					entities.pop_back();
 
+					// The entity which was swapped in has a new index
+					if (i < entities.size())
+					{
+						entityIndices[entities[i].handle] = i;
+					}
+
 					// Swap the entity being removed with the last element in the
 					// entitiesToRemove list
 					std::swap(entitiesToRemove[j], entitiesToRemove[entitiesToRemove.size() - 1]);
@@ -342,9 +356,110 @@ void InteractionWorld::AddEntity(EntityHandle handle)
 		ComputeInteractions(entity, i);
 	}
 	// Add the entity to the entities list
+	// It is added to the broadphase by the next update, once it's components have been set up
+	entityIndices[handle] = entities.size();
 	entities.push_back(entity);
 }
 
+AABB InteractionWorld::GetWorldAABB(const TransformComponent& transform,
+	const ColliderComponent& collider)
+{
+	return collider.aabb.Translate(transform.transform.GetPosition());
+}
+
+void InteractionWorld::UpdateBroadphase()
+{
+	ECSQuery& query = ecs.GetQuery({ TransformComponent::ID, ColliderComponent::ID });
+
+	for (ECSArchetype* archetype : query.GetArchetypes())
+	{
+		const unsigned int transformColumn = archetype->GetColumn(TransformComponent::ID);
+		const unsigned int colliderColumn = archetype->GetColumn(ColliderComponent::ID);
+		const unsigned int chunkCapacity = archetype->GetChunkCapacity();
+
+		std::vector<uint32_t>& versions = chunkVersions[archetype];
+		versions.resize(archetype->GetNumChunks(), 0);
+
+		for (size_t i = 0; i < archetype->GetNumChunks(); i++)
+		{
+			const ECSChunk& chunk = archetype->GetChunk(i);
+			const uint32_t* columnTicks = archetype->GetColumnChangeTicks(chunk);
+			const uint32_t* transformTicks = archetype->GetChangeTicks(chunk, transformColumn);
+			const uint32_t* colliderTicks = archetype->GetChangeTicks(chunk, colliderColumn);
+			const EntityHandle* handles = archetype->GetEntities(chunk);
+
+			// Chunks whose rows changed may hold entities which are new, or whose components
+			// moved
+			const bool isChunkMoved = chunk.version != versions[i];
+			versions[i] = chunk.version;
+
+			// Chunks in which neither column changed have no entities to update
+			const bool isChunkChanged =
+				ECSIsTickNewer(columnTicks[transformColumn], lastUpdateTick) ||
+				ECSIsTickNewer(columnTicks[colliderColumn], lastUpdateTick);
+
+			if (!isChunkMoved && !isChunkChanged)
+			{
+				continue;
+			}
+
+			for (unsigned int row = 0; row < chunk.size; row++)
+			{
+				const bool isRowChanged = isChunkChanged &&
+					(ECSIsTickNewer(transformTicks[row], lastUpdateTick) ||
+					ECSIsTickNewer(colliderTicks[row], lastUpdateTick));
+
+				if (!isChunkMoved && !isRowChanged)
+				{
+					continue;
+				}
+
+				auto it = entityIndices.find(handles[row]);
+				if (it == entityIndices.end())
+				{
+					continue;
+				}
+
+				EntityInternal& entity = entities[it->second];
+				const unsigned int archetypeRow = (unsigned int)i * chunkCapacity + row;
+
+				TransformComponent* transform =
+					(TransformComponent*)archetype->GetComponent(archetypeRow, transformColumn);
+				ColliderComponent* collider =
+					(ColliderComponent*)archetype->GetComponent(archetypeRow, colliderColumn);
+
+				// Gather the components for the narrowphase; they may have moved since the
+				// previous update, and a changed collider may hold another type of collider
+				if (isChunkMoved || isRowChanged)
+				{
+					entity.transform = &transform->transform;
+					// https://stackoverflow.com/a/53166942
+					std::visit([&entity](auto&& typedCollider)
+					{
+						entity.collider = &typedCollider;
+					}, collider->collider);
+				}
+
+				// Add the entities which were added since the previous update, and update those
+				// whose transform or collider changed since the previous update
+				if (!entity.isInBroadphase)
+				{
+					broadphase->Add(entity.handle, GetWorldAABB(*transform, *collider));
+					entity.isInBroadphase = true;
+				}
+				else if (isRowChanged)
+				{
+					broadphase->Update(entity.handle, GetWorldAABB(*transform, *collider));
+				}
+			}
+		}
+	}
+
+	// Changes made from here on, including those made by interactions, are picked up by the
+	// next update
+	lastUpdateTick = ecs.AdvanceChangeTick();
+}
+
 void InteractionWorld::ComputeInteractions(EntityInternal& entity, unsigned int interactionIndex)
 {
 	// Get a pointer to the interaction at the specified index
@@ -29,7 +29,9 @@
 #include "ECS/ECS.h"
 #include "GameComponentSystem/TransformComponent.h"
 #include "GameComponentSystem/ColliderComponent.h"
+#include "Physics/Broadphase/DynamicAABBTreeBroadphase.h"
 
+#include <unordered_map>
 #include <vector>
 
 struct CollisionPoints;
@@ -39,6 +41,10 @@ struct CollisionPoints;
  * interaction between the two is detected by the InteractionWorld.
  * 
  * An interaction takes place between two entities, an interactor and an interactee.
+ * 
+ * Only the components of the types an interaction declares as written are marked as changed, so
+ * that colliding with an entity does not make it count as moved. An interaction must not modify
+ * components of the types it only reads.
  */
 class Interaction
 {
@@ -52,10 +58,12 @@ public:
 	 * @param interactee Handle to the interactee entity.
 	 * @param interactorComponents The array of the interactor's components. Contains only the
 	 *			required component types for the interactor, and not all components attached
-	 *			to the interactor entity.
+	 *			to the interactor entity. Only the components of types declared as written may
+	 *			be modified.
 	 * @param interacteeComponents The array of the interactee's components. Contains only the
 	 *			required component types for the interactee, and not all components attached
-	 *			to the interactee entity.
+	 *			to the interactee entity. Only the components of types declared as written may
+	 *			be modified.
 	 */
 	virtual void Interact(float deltaTime, EntityHandle interactor, EntityHandle interactee, 
 		BaseECSComponent** interactorComponents, BaseECSComponent** interacteeComponents,
@@ -67,30 +75,50 @@ public:
 	/** @brief Gets the list of required component types for the interactee. */
 	const std::vector<unsigned int>& GetInteracteeComponents() { return interacteeComponentTypes; }
 
+	/**
+	 * @brief Gets whether each required component type of the interactor is written by the
+	 * interaction, in the same order as GetInteractorComponents.
+	 */
+	const std::vector<bool>& GetInteractorWrites() { return interactorWrites; }
+
+	/**
+	 * @brief Gets whether each required component type of the interactee is written by the
+	 * interaction, in the same order as GetInteracteeComponents.
+	 */
+	const std::vector<bool>& GetInteracteeWrites() { return interacteeWrites; }
+
 protected:
 	/**
 	 * Adds a component type to the list of required component types for the interactor.
 	 * 
 	 * @param type The ID of the component type.
+	 * @param isWrite If the interaction modifies components of the type, which marks them as
+	 *		changed every time the interaction takes place.
 	 */
-	void AddInteractorComponentType(unsigned int type)
+	void AddInteractorComponentType(unsigned int type, bool isWrite = false)
 	{
 		interactorComponentTypes.push_back(type);
+		interactorWrites.push_back(isWrite);
 	}
 
 	/**
 	 * Adds a component type to the list of required component types for the interactee.
 	 *
 	 * @param type The ID of the component type.
+	 * @param isWrite If the interaction modifies components of the type, which marks them as
+	 *		changed every time the interaction takes place.
 	 */
-	void AddInteracteeComponentType(unsigned int type)
+	void AddInteracteeComponentType(unsigned int type, bool isWrite = false)
 	{
 		interacteeComponentTypes.push_back(type);
+		interacteeWrites.push_back(isWrite);
 	}
 
 private:
 	std::vector<unsigned int> interactorComponentTypes;
 	std::vector<unsigned int> interacteeComponentTypes;
+	std::vector<bool> interactorWrites;
+	std::vector<bool> interacteeWrites;
 };
 
 class InteractionWorld : public ECSListener
@@ -108,6 +136,9 @@ public:
 	/** @see ECSListener::OnMakeEntity */
 	virtual void OnMakeEntity(EntityHandle handle);
 
+	/** @see ECSListener::OnMakeEntities */
+	virtual void OnMakeEntities(const EntityHandle* handles, size_t count);
+
 	/** @see ECSListener::OnRemoveEntity */
 	virtual void OnRemoveEntity(EntityHandle handle);
 
@@ -120,10 +151,27 @@ public:
 	/**
 	 * Proccesses interactions between entities. Should be called every update.
 	 * 
+	 * The broadphase is only told about entities whose transform or collider changed since the
+	 * previous update, which is detected through the change ticks of the ECS. Entities with a
+	 * collider must therefore be moved through ECS::GetMut or a system, rather than through
+	 * ECS::GetComponent.
+	 * 
 	 * @param deltaTime How much time has passed since the previous update.
 	 */
 	void ProcessInteractions(float deltaTime);
 
+	/**
+	 * Sets the broadphase used for finding the pairs of entities which may be colliding. Every
+	 * entity is removed from the previous broadphase, and added to the new one by the next update.
+	 * 
+	 * @param broadphase Pointer to the broadphase, which must outlive the InteractionWorld, or
+	 *		nullptr to use the default dynamic AABB tree broadphase.
+	 */
+	void SetBroadphase(IBroadphase* broadphase);
+
+	/** @brief Gets the broadphase used for finding the pairs of entities which may be colliding. */
+	inline IBroadphase* GetBroadphase() { return broadphase; }
+
 	/**
 	 * Adds an interaction to the InteractionWorld. The interaction determines how two entities
 	 * should interact, in the event that an interaction between the two is detected.
@@ -143,10 +191,23 @@ private:
 
 		// The indices of the interactions in which this entity is the interactee
 		std::vector<unsigned int> interactees;
+
+		// If the entity has been added to the broadphase
+		bool isInBroadphase = false;
+
+		// The entity's transform and collider, gathered by UpdateBroadphase so that the
+		// narrowphase does no lookups per pair
+		// Components only move when the rows of their chunk change, so these are gathered again
+		// whenever the version of the entity's chunk changes
+		Transform* transform = nullptr;
+		Collider* collider = nullptr;
 	};
 
 	std::vector<EntityInternal> entities;
 
+	// map<entity handle, index of the entity in the entities array>
+	std::unordered_map<EntityHandle, size_t> entityIndices;
+
 	// List of entities to remove
 	// Every time interactions are processed, the entities in the list will be removed, and the
 	// list will be cleared
@@ -161,11 +222,46 @@ private:
 
 	ECS& ecs;
 
+	// Used unless another broadphase is set
+	DynamicAABBTreeBroadphase defaultBroadphase;
+	IBroadphase* broadphase = &defaultBroadphase;
+
+	// The change tick of the ECS when the broadphase was last updated
+	uint32_t lastUpdateTick = 0;
+
+	// map<archetype, version of each of it's chunks when the broadphase was last updated>
+	// Chunks whose rows and components have not changed since are skipped entirely
+	std::unordered_map<const ECSArchetype*, std::vector<uint32_t>> chunkVersions;
+
+	// Reused every update, so that finding pairs does not allocate
+	std::vector<std::pair<EntityHandle, EntityHandle>> pairs;
+
 	void ProcessInteraction(float deltaTime, const EntityInternal& interactor,
 		const EntityInternal& interactee, const CollisionPoints& points) const;
 
 	void RemoveAndUpdateEntities();
 
+	/**
+	 * Gets the bounding box of an entity in world space. Colliders are placed by the
+	 * TransformComponent alone, like rigidbodies, so entities with a collider must not be attached
+	 * to a parent.
+	 * 
+	 * @see PhysicsWorldSystem
+	 * 
+	 * @param transform The entity's transform.
+	 * @param collider The entity's collider.
+	 * @return The collider's bounding box, translated by the entity's position.
+	 */
+	static AABB GetWorldAABB(const TransformComponent& transform,
+		const ColliderComponent& collider);
+
+	/**
+	 * Adds new entities to the broadphase, and updates the bounding boxes of entities whose
+	 * transform or collider changed since the previous update. Only chunks whose rows or
+	 * components changed are visited, so entities which do not change cost nothing.
+	 */
+	void UpdateBroadphase();
+
 	/**
 	 * Adds an entity to the InteractionWorld. Ensures that interactions are computed for the
 	 * entity.
@@ -22,6 +22,7 @@
 #include "GameComponentSystem/ColliderComponent.h"
 #include "GameComponentSystem/FreecamControlComponent.h"
 #include "GameComponentSystem/RenderableMeshComponentSystem.h"
+#include "GameComponentSystem/TransformPropagationSystem.h"
 #include "GameComponentSystem/MotionComponentSystem.h"
 #include "GameComponentSystem/CameraComponentSystem.h"
 
@@ -39,7 +40,7 @@ public:
 	{
 		AddInteractorComponentType(TransformComponent::ID);
 		AddInteractorComponentType(ColliderComponent::ID);
-		AddInteractorComponentType(RigidbodyComponent::ID);
+		AddInteractorComponentType(RigidbodyComponent::ID, true);
 		AddInteracteeComponentType(TransformComponent::ID);
 		AddInteracteeComponentType(ColliderComponent::ID);
 	}
@@ -78,7 +79,7 @@ class SmoothPositionSolverInteraction final : public Interaction
 public:
 	SmoothPositionSolverInteraction() : Interaction()
 	{
-		AddInteractorComponentType(TransformComponent::ID);
+		AddInteractorComponentType(TransformComponent::ID, true);
 		AddInteractorComponentType(ColliderComponent::ID);
 		AddInteractorComponentType(RigidbodyComponent::ID);
 		AddInteracteeComponentType(TransformComponent::ID);
@@ -155,6 +156,8 @@ int main(int argc, char** argv)
 
 	// Create the ECS
 	ECS ecs;
+	// Worker threads used for updating systems which do not conflict with each other in parallel
+	ECSThreadPool threadPool;
 	// Systems which determine game logic
 	ECSSystemList mainSystems;
 	// Systems which determine rendering
@@ -164,6 +167,9 @@ int main(int argc, char** argv)
 	InteractionWorld interactionWorld(ecs);
 	// Add the interaction world to the ECS
 	ecs.AddListener(&interactionWorld);
+	// Keeps the world matrices of entities up to date, including entities attached to a parent
+	TransformPropagationSystem transformPropagationSystem(ecs);
+	ecs.AddListener(&transformPropagationSystem);
 
 	ImpulseSolverInteraction impulseSolverInteraction;
 	SmoothPositionSolverInteraction smoothPositionSolverInteraction;
@@ -208,6 +214,7 @@ int main(int argc, char** argv)
 	CameraComponent cameraComponent;
 	RenderableMeshComponent renderableMeshComponent;
 	RigidbodyComponent rigidbodyComponent;
+	WorldTransformComponent worldTransformComponent;
 	
 	// Create the player entity...
 
@@ -232,18 +239,23 @@ int main(int argc, char** argv)
 	colliderComponent.collider = myCollider;
 
 	// Finally, create the player!
-	ecs.MakeEntity(transformComponent, cameraComponent, freecamControlComponent);
+	ecs.MakeEntity(transformComponent, worldTransformComponent, cameraComponent,
+		freecamControlComponent);
 
 	renderableMeshComponent.mesh = &vertexArray;
 	renderableMeshComponent.texture = &textureRed;
 
+	// Make all of the spheres at once, then move each of them into place
+	std::vector<EntityHandle> spheres = ecs.MakeEntities(100, transformComponent,
+		worldTransformComponent, colliderComponent, renderableMeshComponent);
+
 	constexpr float spacing = 5.f;
 	for (unsigned int i = 0; i < 10; i++)
 	{
 		for(unsigned int j = 0;j < 10;j++)
 		{
-			transformComponent.transform.SetPosition(glm::vec3(spacing * j + (i%2) * 2.5f, spacing * i, -18.f));
-			ecs.MakeEntity(transformComponent, colliderComponent, renderableMeshComponent);
+			ecs.GetComponent<TransformComponent>(spheres[i * 10 + j])->transform.SetPosition(
+				glm::vec3(spacing * j + (i%2) * 2.5f, spacing * i, -18.f));
 		}
 	}
 
@@ -257,7 +269,8 @@ int main(int argc, char** argv)
 	rigidbodyComponent.staticFriction = 0.f;
 	rigidbodyComponent.restitution = 1.f;
 	renderableMeshComponent.texture = &textureGreen;
-	ecs.MakeEntity(transformComponent, colliderComponent, rigidbodyComponent, renderableMeshComponent);
+	ecs.MakeEntity(transformComponent, worldTransformComponent, colliderComponent, rigidbodyComponent,
+		renderableMeshComponent);
 
 	// Create systems
 	PhysicsWorldSystem physicsWorldSystem;
@@ -267,7 +280,9 @@ int main(int argc, char** argv)
 
 	mainSystems.AddSystem(physicsWorldSystem);
 	mainSystems.AddSystem(freecamControlSystem);
-	mainSystems.AddSystem(cameraSystem);
+	// The camera follows the world transform of the player, so it is updated after the world
+	// transforms, right before rendering
+	renderingPipeline.AddSystem(cameraSystem);
 	renderingPipeline.AddSystem(renderableMeshSystem);
 
 	// Time values used for calculating delta time
@@ -302,7 +317,7 @@ int main(int argc, char** argv)
 		}
 
 		// Update all game logic systems
-		ecs.UpdateSystems(mainSystems, deltaTime);
+		ecs.UpdateSystems(mainSystems, deltaTime, threadPool);
 
 		// Process any interactions (collisions) between entities
 		interactionWorld.ProcessInteractions(deltaTime);
@@ -310,6 +325,10 @@ int main(int argc, char** argv)
 		// Clear the display for rendering the next frame
 		gameRenderContext.Clear(0.6f, 0.8f, 1.0f, 1.0f, true);
 
+		// World matrices are updated right before rendering, so that changes made by interactions
+		// are included
+		transformPropagationSystem.Update();
+
 		// Update the rendering pipeline
 		ecs.UpdateSystems(renderingPipeline, deltaTime);
 
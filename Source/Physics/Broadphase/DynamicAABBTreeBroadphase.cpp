@@ -0,0 +1,111 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#include "DynamicAABBTreeBroadphase.h"
+
+#include <algorithm> // std::remove_if, std::min, std::max
+
+void DynamicAABBTreeBroadphase::Add(EntityHandle handle, const AABB& aabb)
+{
+	int proxy = tree.Insert(handle, aabb);
+	proxies[handle] = proxy;
+
+	MarkMoved(proxy);
+}
+
+void DynamicAABBTreeBroadphase::Remove(EntityHandle handle)
+{
+	auto it = proxies.find(handle);
+	if (it == proxies.end())
+	{
+		return;
+	}
+
+	tree.Remove(it->second);
+
+	// The pairs of the proxy are forgotten by the next call to FindPairs
+	MarkMoved(it->second);
+
+	proxies.erase(it);
+}
+
+void DynamicAABBTreeBroadphase::Update(EntityHandle handle, const AABB& aabb)
+{
+	auto it = proxies.find(handle);
+	if (it == proxies.end())
+	{
+		return;
+	}
+
+	// Nothing changes until the entity leaves it's fat bounding box
+	if (tree.Move(it->second, aabb))
+	{
+		MarkMoved(it->second);
+	}
+}
+
+void DynamicAABBTreeBroadphase::Clear()
+{
+	tree = Algorithm::DynamicAABBTree<EntityHandle>(margin);
+	proxies.clear();
+	proxyPairs.clear();
+	movedProxies.clear();
+	isMoved.clear();
+}
+
+void DynamicAABBTreeBroadphase::FindPairs(std::vector<std::pair<EntityHandle, EntityHandle>>& pairs)
+{
+	if (!movedProxies.empty())
+	{
+		// Forget every pair of a moved proxy; they are found again below
+		proxyPairs.erase(std::remove_if(proxyPairs.begin(), proxyPairs.end(),
+			[this](const std::pair<int, int>& pair)
+			{
+				return IsMoved(pair.first) || IsMoved(pair.second);
+			}), proxyPairs.end());
+
+		for (int proxy : movedProxies)
+		{
+			// The proxy was removed, or reused by a node which is not a leaf
+			if (!tree.IsLeaf(proxy))
+			{
+				continue;
+			}
+
+			tree.Query(tree.GetFatAABB(proxy), [this, proxy](int other)
+			{
+				// Pairs of two moved proxies are found by both of them; only keep one
+				if (other == proxy || (IsMoved(other) && other < proxy))
+				{
+					return;
+				}
+
+				proxyPairs.emplace_back(std::min(proxy, other), std::max(proxy, other));
+			});
+		}
+
+		for (int proxy : movedProxies)
+		{
+			isMoved[proxy] = false;
+		}
+		movedProxies.clear();
+	}
+
+	for (const std::pair<int, int>& pair : proxyPairs)
+	{
+		pairs.emplace_back(tree.GetHandle(pair.first), tree.GetHandle(pair.second));
+	}
+}
+
+void DynamicAABBTreeBroadphase::MarkMoved(int proxy)
+{
+	if (proxy >= (int)isMoved.size())
+	{
+		isMoved.resize(proxy + 1, false);
+	}
+
+	if (!isMoved[proxy])
+	{
+		isMoved[proxy] = true;
+		movedProxies.push_back(proxy);
+	}
+}
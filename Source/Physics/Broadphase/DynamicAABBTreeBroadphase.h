@@ -0,0 +1,73 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#pragma once
+
+#include "IBroadphase.h"
+#include "Algorithm/DynamicAABBTree.h"
+
+#include <unordered_map>
+
+/**
+ * @brief Broadphase which keeps every entity in a persistent dynamic AABB tree.
+ *
+ * Every entity is stored with a fat bounding box, which is larger than it's actual bounding box
+ * by a margin. An entity is only reinserted into the tree once it's bounding box leaves it's fat
+ * bounding box.
+ *
+ * Pairs are found from the fat bounding boxes, and kept between calls to FindPairs. Only entities
+ * which were added, removed or reinserted since the previous call have their pairs found again,
+ * so entities which do not move cost nothing once they have been added.
+ *
+ * @see Algorithm::DynamicAABBTree
+ */
+class DynamicAABBTreeBroadphase : public IBroadphase
+{
+public:
+	/**
+	 * @param margin The distance by which the fat bounding box of every entity is larger than the
+	 *		entity's actual bounding box. Larger margins mean less reinsertions of moving entities,
+	 *		but more pairs whose bounding boxes do not actually intersect.
+	 */
+	DynamicAABBTreeBroadphase(float margin = 0.1f) : IBroadphase(), tree(margin), margin(margin) {}
+
+	/** @see IBroadphase::Add */
+	virtual void Add(EntityHandle handle, const AABB& aabb);
+
+	/** @see IBroadphase::Remove */
+	virtual void Remove(EntityHandle handle);
+
+	/** @see IBroadphase::Update */
+	virtual void Update(EntityHandle handle, const AABB& aabb);
+
+	/** @see IBroadphase::Clear */
+	virtual void Clear();
+
+	/** @see IBroadphase::FindPairs */
+	virtual void FindPairs(std::vector<std::pair<EntityHandle, EntityHandle>>& pairs);
+
+private:
+	Algorithm::DynamicAABBTree<EntityHandle> tree;
+	float margin;
+
+	// map<entity, proxy of the entity in the tree>
+	std::unordered_map<EntityHandle, int> proxies;
+
+	// Every pair of proxies whose fat bounding boxes intersected as of the previous call to
+	// FindPairs; the first proxy of every pair is the smaller one
+	std::vector<std::pair<int, int>> proxyPairs;
+
+	// Proxies which were inserted, reinserted or removed since the previous call to FindPairs
+	std::vector<int> movedProxies;
+
+	// Index corresponds to proxy; if the proxy is in the moved proxies array
+	std::vector<bool> isMoved;
+
+	/** @brief Used internally for determining if a proxy is in the moved proxies array. */
+	inline bool IsMoved(int proxy) const
+	{
+		return proxy < (int)isMoved.size() && isMoved[proxy];
+	}
+
+	/** @brief Adds a proxy to the moved proxies array, if it is not there already. */
+	void MarkMoved(int proxy);
+};
@@ -0,0 +1,66 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#pragma once
+
+#include "ECS/ECSComponent.h"
+#include "AABB.h"
+
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Interface for broadphase collision detection; finding the pairs of entities which may be
+ * colliding, so that only those pairs have their colliders tested against each other.
+ *
+ * The broadphase keeps track of the bounding box of every entity it is given. Entities are added
+ * and removed as they gain and lose the components needed for collision detection, and updated
+ * whenever their bounding box may have changed, so that implementations can keep their data
+ * structures up to date incrementally rather than rebuilding them every frame.
+ */
+class IBroadphase
+{
+public:
+	IBroadphase() {}
+	virtual ~IBroadphase() {}
+
+	/**
+	 * Adds an entity to the broadphase.
+	 *
+	 * @param handle Handle to the entity, which must not already be in the broadphase.
+	 * @param aabb The world space bounding box of the entity.
+	 */
+	virtual void Add(EntityHandle handle, const AABB& aabb) = 0;
+
+	/**
+	 * Removes an entity from the broadphase.
+	 *
+	 * @param handle Handle to the entity, which must be in the broadphase.
+	 */
+	virtual void Remove(EntityHandle handle) = 0;
+
+	/**
+	 * Updates the bounding box of an entity. Only needs to be called for entities whose bounding
+	 * box may have changed since it was last given to the broadphase.
+	 *
+	 * @param handle Handle to the entity, which must be in the broadphase.
+	 * @param aabb The new world space bounding box of the entity.
+	 */
+	virtual void Update(EntityHandle handle, const AABB& aabb) = 0;
+
+	/** @brief Removes every entity from the broadphase. */
+	virtual void Clear() = 0;
+
+	/**
+	 * Finds the pairs of entities which may be colliding. Every pair whose bounding boxes
+	 * intersect is found, though pairs whose bounding boxes do not intersect may be found as well.
+	 *
+	 * @param pairs Array which the pairs are appended to. Every pair is only appended once, in no
+	 *		particular order.
+	 */
+	virtual void FindPairs(std::vector<std::pair<EntityHandle, EntityHandle>>& pairs) = 0;
+
+private:
+	// Disallow copy and assign
+	IBroadphase(const IBroadphase& other) = delete;
+	void operator=(const IBroadphase& other) = delete;
+};
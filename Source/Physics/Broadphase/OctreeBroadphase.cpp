@@ -0,0 +1,54 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#include "OctreeBroadphase.h"
+
+#include <limits>
+
+void OctreeBroadphase::Add(EntityHandle handle, const AABB& aabb)
+{
+	objects[handle] = aabb;
+}
+
+void OctreeBroadphase::Remove(EntityHandle handle)
+{
+	objects.erase(handle);
+}
+
+void OctreeBroadphase::Update(EntityHandle handle, const AABB& aabb)
+{
+	objects[handle] = aabb;
+}
+
+void OctreeBroadphase::Clear()
+{
+	objects.clear();
+}
+
+void OctreeBroadphase::FindPairs(std::vector<std::pair<EntityHandle, EntityHandle>>& pairs)
+{
+	if (objects.empty())
+	{
+		return;
+	}
+
+	// The octree is a cube which fits every bounding box
+	float min =  std::numeric_limits<float>::infinity();
+	float max = -std::numeric_limits<float>::infinity();
+
+	for (const auto& [handle, aabb] : objects)
+	{
+		const glm::vec3 minExtents = aabb.GetMinExtents();
+		const glm::vec3 maxExtents = aabb.GetMaxExtents();
+		min = std::min({ min, minExtents.x, minExtents.y, minExtents.z });
+		max = std::max({ max, maxExtents.x, maxExtents.y, maxExtents.z });
+	}
+
+	octree.Clear(AABB(glm::vec3(min), glm::vec3(max)));
+
+	for (const auto& [handle, aabb] : objects)
+	{
+		octree.Insert(handle, aabb);
+	}
+
+	octree.FindPairs(pairs);
+}
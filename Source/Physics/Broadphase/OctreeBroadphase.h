@@ -0,0 +1,45 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#pragma once
+
+#include "IBroadphase.h"
+#include "Algorithm/Octree.h"
+
+#include <unordered_map>
+
+/**
+ * @brief Broadphase which builds an octree around every entity each time pairs are found.
+ *
+ * The octree is sized to fit the bounding boxes of all entities, so it needs no tuning, but it is
+ * rebuilt from scratch every frame. The same octree is cleared and reused every frame, so that it
+ * does not allocate once it has grown to fit the entities.
+ *
+ * @see Algorithm::Octree
+ */
+class OctreeBroadphase : public IBroadphase
+{
+public:
+	OctreeBroadphase() : IBroadphase(), octree(AABB(glm::vec3(0.0f), glm::vec3(0.0f))) {}
+
+	/** @see IBroadphase::Add */
+	virtual void Add(EntityHandle handle, const AABB& aabb);
+
+	/** @see IBroadphase::Remove */
+	virtual void Remove(EntityHandle handle);
+
+	/** @see IBroadphase::Update */
+	virtual void Update(EntityHandle handle, const AABB& aabb);
+
+	/** @see IBroadphase::Clear */
+	virtual void Clear();
+
+	/** @see IBroadphase::FindPairs */
+	virtual void FindPairs(std::vector<std::pair<EntityHandle, EntityHandle>>& pairs);
+
+private:
+	// The bounding box of every entity in the broadphase
+	std::unordered_map<EntityHandle, AABB> objects;
+
+	// Rebuilt around the entities every time pairs are found
+	Algorithm::Octree<EntityHandle> octree;
+};
@@ -0,0 +1,324 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#include "SpatialHashGridBroadphase.h"
+
+#include <algorithm> // std::find
+
+// The number of slots the hash table starts with once the first cell is added
+static const size_t MIN_SLOTS = 64;
+
+/** @brief Used internally for determining if a cell is within a range of cells, inclusive. */
+static bool IsInRange(const glm::ivec3& coords, const glm::ivec3& min, const glm::ivec3& max)
+{
+	return coords.x >= min.x && coords.x <= max.x &&
+		coords.y >= min.y && coords.y <= max.y &&
+		coords.z >= min.z && coords.z <= max.z;
+}
+
+void SpatialHashGridBroadphase::Add(EntityHandle handle, const AABB& aabb)
+{
+	uint32_t proxy;
+	if (!freeProxies.empty())
+	{
+		proxy = freeProxies.back();
+		freeProxies.pop_back();
+	}
+	else
+	{
+		proxy = (uint32_t)proxies.size();
+		proxies.emplace_back();
+	}
+
+	Proxy& proxyData = proxies[proxy];
+	proxyData.handle = handle;
+	proxyData.aabb = aabb;
+	proxyData.minCell = GetCellCoords(aabb.GetMinExtents());
+	proxyData.maxCell = GetCellCoords(aabb.GetMaxExtents());
+	proxyIDs[handle] = proxy;
+
+	const glm::ivec3 minCell = proxyData.minCell;
+	const glm::ivec3 maxCell = proxyData.maxCell;
+
+	for (int x = minCell.x; x <= maxCell.x; x++)
+	{
+		for (int y = minCell.y; y <= maxCell.y; y++)
+		{
+			for (int z = minCell.z; z <= maxCell.z; z++)
+			{
+				AddToCell(glm::ivec3(x, y, z), proxy);
+			}
+		}
+	}
+}
+
+void SpatialHashGridBroadphase::Remove(EntityHandle handle)
+{
+	auto it = proxyIDs.find(handle);
+	if (it == proxyIDs.end())
+	{
+		return;
+	}
+
+	const uint32_t proxy = it->second;
+	const glm::ivec3 minCell = proxies[proxy].minCell;
+	const glm::ivec3 maxCell = proxies[proxy].maxCell;
+
+	for (int x = minCell.x; x <= maxCell.x; x++)
+	{
+		for (int y = minCell.y; y <= maxCell.y; y++)
+		{
+			for (int z = minCell.z; z <= maxCell.z; z++)
+			{
+				RemoveFromCell(glm::ivec3(x, y, z), proxy);
+			}
+		}
+	}
+
+	freeProxies.push_back(proxy);
+	proxyIDs.erase(it);
+}
+
+void SpatialHashGridBroadphase::Update(EntityHandle handle, const AABB& aabb)
+{
+	auto it = proxyIDs.find(handle);
+	if (it == proxyIDs.end())
+	{
+		return;
+	}
+
+	const uint32_t proxy = it->second;
+	const glm::ivec3 oldMinCell = proxies[proxy].minCell;
+	const glm::ivec3 oldMaxCell = proxies[proxy].maxCell;
+	const glm::ivec3 newMinCell = GetCellCoords(aabb.GetMinExtents());
+	const glm::ivec3 newMaxCell = GetCellCoords(aabb.GetMaxExtents());
+
+	proxies[proxy].aabb = aabb;
+
+	// Most updates leave the entity within the same cells
+	if (oldMinCell == newMinCell && oldMaxCell == newMaxCell)
+	{
+		return;
+	}
+
+	// Leave the cells which are no longer overlapped
+	for (int x = oldMinCell.x; x <= oldMaxCell.x; x++)
+	{
+		for (int y = oldMinCell.y; y <= oldMaxCell.y; y++)
+		{
+			for (int z = oldMinCell.z; z <= oldMaxCell.z; z++)
+			{
+				const glm::ivec3 coords(x, y, z);
+				if (!IsInRange(coords, newMinCell, newMaxCell))
+				{
+					RemoveFromCell(coords, proxy);
+				}
+			}
+		}
+	}
+
+	// Enter the cells which were not overlapped before
+	for (int x = newMinCell.x; x <= newMaxCell.x; x++)
+	{
+		for (int y = newMinCell.y; y <= newMaxCell.y; y++)
+		{
+			for (int z = newMinCell.z; z <= newMaxCell.z; z++)
+			{
+				const glm::ivec3 coords(x, y, z);
+				if (!IsInRange(coords, oldMinCell, oldMaxCell))
+				{
+					AddToCell(coords, proxy);
+				}
+			}
+		}
+	}
+
+	proxies[proxy].minCell = newMinCell;
+	proxies[proxy].maxCell = newMaxCell;
+}
+
+void SpatialHashGridBroadphase::Clear()
+{
+	proxies.clear();
+	proxyIDs.clear();
+	freeProxies.clear();
+	slots.clear();
+	numSlotsUsed = 0;
+	cells.clear();
+	freeCells.clear();
+}
+
+void SpatialHashGridBroadphase::FindPairs(std::vector<std::pair<EntityHandle, EntityHandle>>& pairs)
+{
+	for (const Slot& slot : slots)
+	{
+		if (slot.cell == EMPTY_SLOT)
+		{
+			continue;
+		}
+
+		const std::vector<uint32_t>& cell = cells[slot.cell];
+
+		for (size_t i = 0; i < cell.size(); i++)
+		{
+			const Proxy& a = proxies[cell[i]];
+
+			for (size_t j = i + 1; j < cell.size(); j++)
+			{
+				const Proxy& b = proxies[cell[j]];
+
+				// Two proxies which share several cells are only paired in the first cell they
+				// share, which is the minimum of the cells they both occupy
+				if (glm::max(a.minCell, b.minCell) != slot.coords)
+				{
+					continue;
+				}
+
+				if (a.aabb.Intersects(b.aabb))
+				{
+					pairs.emplace_back(a.handle, b.handle);
+				}
+			}
+		}
+	}
+}
+
+glm::ivec3 SpatialHashGridBroadphase::GetCellCoords(const glm::vec3& position) const
+{
+	return glm::ivec3(glm::floor(position * inverseCellSize));
+}
+
+size_t SpatialHashGridBroadphase::GetHomeSlot(const glm::ivec3& coords) const
+{
+	// Multiplying each coordinate by a different large prime spreads neighbouring cells across the
+	// hash table
+	const uint32_t hash = ((uint32_t)coords.x * 73856093u) ^ ((uint32_t)coords.y * 19349663u) ^
+		((uint32_t)coords.z * 83492791u);
+
+	return hash & (slots.size() - 1);
+}
+
+size_t SpatialHashGridBroadphase::FindSlot(const glm::ivec3& coords) const
+{
+	const size_t mask = slots.size() - 1;
+
+	// At most half of the slots are used, so there is always an empty slot to stop at
+	size_t slot = GetHomeSlot(coords);
+	while (slots[slot].cell != EMPTY_SLOT && slots[slot].coords != coords)
+	{
+		slot = (slot + 1) & mask;
+	}
+
+	return slot;
+}
+
+void SpatialHashGridBroadphase::Rehash(size_t numSlots)
+{
+	std::vector<Slot> oldSlots = std::move(slots);
+	slots.assign(numSlots, { glm::ivec3(0), EMPTY_SLOT });
+
+	for (const Slot& slot : oldSlots)
+	{
+		if (slot.cell != EMPTY_SLOT)
+		{
+			slots[FindSlot(slot.coords)] = slot;
+		}
+	}
+}
+
+void SpatialHashGridBroadphase::AddToCell(const glm::ivec3& coords, uint32_t proxy)
+{
+	// Keep at most half of the slots used, so that probes stay short
+	if ((numSlotsUsed + 1) * 2 > slots.size())
+	{
+		Rehash(std::max(MIN_SLOTS, slots.size() * 2));
+	}
+
+	const size_t slot = FindSlot(coords);
+
+	if (slots[slot].cell == EMPTY_SLOT)
+	{
+		uint32_t cell;
+		if (!freeCells.empty())
+		{
+			cell = freeCells.back();
+			freeCells.pop_back();
+		}
+		else
+		{
+			cell = (uint32_t)cells.size();
+			cells.emplace_back();
+		}
+
+		slots[slot] = { coords, cell };
+		numSlotsUsed++;
+	}
+
+	cells[slots[slot].cell].push_back(proxy);
+}
+
+void SpatialHashGridBroadphase::RemoveFromCell(const glm::ivec3& coords, uint32_t proxy)
+{
+	if (slots.empty())
+	{
+		return;
+	}
+
+	const size_t slot = FindSlot(coords);
+	if (slots[slot].cell == EMPTY_SLOT)
+	{
+		return;
+	}
+
+	const uint32_t cell = slots[slot].cell;
+	std::vector<uint32_t>& cellProxies = cells[cell];
+
+	// The order of proxies within a cell does not matter
+	auto it = std::find(cellProxies.begin(), cellProxies.end(), proxy);
+	if (it != cellProxies.end())
+	{
+		*it = cellProxies.back();
+		cellProxies.pop_back();
+	}
+
+	// Empty cells are removed, so that the hash table only grows with the number of cells which
+	// are actually occupied
+	// The cell keeps it's capacity for when it is reused
+	if (cellProxies.empty())
+	{
+		RemoveSlot(slot);
+		freeCells.push_back(cell);
+	}
+}
+
+void SpatialHashGridBroadphase::RemoveSlot(size_t slot)
+{
+	const size_t mask = slots.size() - 1;
+
+	slots[slot].cell = EMPTY_SLOT;
+	numSlotsUsed--;
+
+	// Linear probing needs every slot between a cell's home slot and the slot it is stored in to
+	// be used, so later slots are moved back into the gap where that would break
+	size_t next = slot;
+	while (true)
+	{
+		next = (next + 1) & mask;
+		if (slots[next].cell == EMPTY_SLOT)
+		{
+			return;
+		}
+
+		const size_t home = GetHomeSlot(slots[next].coords);
+
+		// The cell can stay if it's home slot is cyclically after the gap, up to where it is
+		const bool canStay = slot <= next ? (home > slot && home <= next) :
+			(home > slot || home <= next);
+
+		if (!canStay)
+		{
+			slots[slot] = slots[next];
+			slots[next].cell = EMPTY_SLOT;
+			slot = next;
+		}
+	}
+}
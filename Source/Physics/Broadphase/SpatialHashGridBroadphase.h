@@ -0,0 +1,124 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#pragma once
+
+#include "IBroadphase.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+/**
+ * @brief Broadphase which divides space into a uniform grid of cells, and only tests entities
+ * which share a cell.
+ *
+ * The grid is unbounded and sparse; only the cells which contain an entity are stored, in a hash
+ * table keyed by the coordinates of the cell. Unlike the octree, the grid does not depend on the
+ * bounds of every entity, so a few entities far away from the rest do not make it any slower,
+ * which suits large worlds with dense clusters of entities.
+ *
+ * Each entity occupies every cell it's bounding box overlaps. Updating an entity only touches the
+ * cells it entered or left, so entities which stay within the same cells cost almost nothing.
+ */
+class SpatialHashGridBroadphase : public IBroadphase
+{
+public:
+	/**
+	 * @param cellSize The size of every cell of the grid. Should be around the size of the common
+	 *		entities; entities much larger than a cell occupy many cells, while cells much larger
+	 *		than entities contain many entities which do not intersect.
+	 */
+	SpatialHashGridBroadphase(float cellSize = 4.0f) : IBroadphase(), cellSize(cellSize),
+		inverseCellSize(1.0f / cellSize) {}
+
+	/** @see IBroadphase::Add */
+	virtual void Add(EntityHandle handle, const AABB& aabb);
+
+	/** @see IBroadphase::Remove */
+	virtual void Remove(EntityHandle handle);
+
+	/** @see IBroadphase::Update */
+	virtual void Update(EntityHandle handle, const AABB& aabb);
+
+	/** @see IBroadphase::Clear */
+	virtual void Clear();
+
+	/** @see IBroadphase::FindPairs */
+	virtual void FindPairs(std::vector<std::pair<EntityHandle, EntityHandle>>& pairs);
+
+	/** @brief Gets the size of every cell of the grid. */
+	inline float GetCellSize() const { return cellSize; }
+
+	/** @brief Gets the number of cells which contain at least one entity. */
+	inline size_t GetNumCells() const { return numSlotsUsed; }
+
+private:
+	struct Proxy
+	{
+		EntityHandle handle;
+		AABB aabb;
+
+		// The range of cells the proxy occupies, inclusive
+		glm::ivec3 minCell;
+		glm::ivec3 maxCell;
+	};
+
+	struct Slot
+	{
+		glm::ivec3 coords;
+
+		// Index into the cells array, or EMPTY_SLOT if no cell is stored in this slot
+		uint32_t cell;
+	};
+
+	static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+	float cellSize;
+	float inverseCellSize;
+
+	// Index corresponds to proxy
+	std::vector<Proxy> proxies;
+
+	// map<entity, proxy of the entity>
+	std::unordered_map<EntityHandle, uint32_t> proxyIDs;
+
+	// Proxies which can be reused by newly added entities
+	std::vector<uint32_t> freeProxies;
+
+	// Hash table of every cell which contains a proxy, using open addressing with linear probing
+	// The number of slots is always a power of two, and at most half of them are used
+	std::vector<Slot> slots;
+	size_t numSlotsUsed = 0;
+
+	// The proxies in every cell; cells which are not in the hash table are empty
+	std::vector<std::vector<uint32_t>> cells;
+
+	// Cells which are not in the hash table, and can be reused
+	std::vector<uint32_t> freeCells;
+
+	/** @brief Gets the coordinates of the cell which contains a position. */
+	glm::ivec3 GetCellCoords(const glm::vec3& position) const;
+
+	/** @brief Gets the index of a slot in which a cell would be stored, from it's coordinates. */
+	size_t GetHomeSlot(const glm::ivec3& coords) const;
+
+	/**
+	 * Finds the slot which stores a cell.
+	 *
+	 * @param coords The coordinates of the cell.
+	 * @return The slot which stores the cell, or the empty slot the cell would be stored in if it
+	 *		is not in the hash table.
+	 */
+	size_t FindSlot(const glm::ivec3& coords) const;
+
+	/** @brief Resizes the hash table, reinserting every cell. */
+	void Rehash(size_t numSlots);
+
+	/** @brief Adds a proxy to a cell, adding the cell to the hash table if needed. */
+	void AddToCell(const glm::ivec3& coords, uint32_t proxy);
+
+	/** @brief Removes a proxy from a cell, removing the cell from the hash table if it is empty. */
+	void RemoveFromCell(const glm::ivec3& coords, uint32_t proxy);
+
+	/** @brief Removes a slot from the hash table, moving later slots back to fill the gap. */
+	void RemoveSlot(size_t slot);
+};
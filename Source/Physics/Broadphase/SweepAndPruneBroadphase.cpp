@@ -0,0 +1,264 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#include "SweepAndPruneBroadphase.h"
+
+#include <algorithm> // std::sort, std::remove_if
+#include <limits>
+
+// SSE is always available on x64, and on x86 if the compiler was told it can use it
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SWEEP_AND_PRUNE_SSE
+#include <xmmintrin.h>
+#endif
+
+// The number of proxies tested at once; the packed arrays are padded by this much so that the
+// last proxies can be loaded without reading past the end of the arrays
+static const size_t SIMD_WIDTH = 4;
+
+void SweepAndPruneBroadphase::Add(EntityHandle handle, const AABB& aabb)
+{
+	uint32_t proxy;
+	if (!freeProxies.empty())
+	{
+		proxy = freeProxies.back();
+		freeProxies.pop_back();
+	}
+	else
+	{
+		proxy = (uint32_t)proxies.size();
+		proxies.emplace_back();
+	}
+
+	proxies[proxy].handle = handle;
+	proxies[proxy].aabb = aabb;
+	proxyIDs[handle] = proxy;
+
+	// New proxies go at the end, and are moved into place by the next sort
+	sortedProxies.push_back(proxy);
+	numAdded++;
+}
+
+void SweepAndPruneBroadphase::Remove(EntityHandle handle)
+{
+	auto it = proxyIDs.find(handle);
+	if (it == proxyIDs.end())
+	{
+		return;
+	}
+
+	// Removing from the middle of the sorted proxies array is linear, so every removed proxy is
+	// removed at once by the next call to FindPairs
+	proxies[it->second].isRemoved = true;
+	removedProxies.push_back(it->second);
+
+	proxyIDs.erase(it);
+}
+
+void SweepAndPruneBroadphase::Update(EntityHandle handle, const AABB& aabb)
+{
+	auto it = proxyIDs.find(handle);
+	if (it != proxyIDs.end())
+	{
+		proxies[it->second].aabb = aabb;
+	}
+}
+
+void SweepAndPruneBroadphase::Clear()
+{
+	proxies.clear();
+	proxyIDs.clear();
+	freeProxies.clear();
+	removedProxies.clear();
+	sortedProxies.clear();
+	numAdded = 0;
+}
+
+void SweepAndPruneBroadphase::FindPairs(std::vector<std::pair<EntityHandle, EntityHandle>>& pairs)
+{
+	// Remove the removed proxies from the sorted proxies array, which keeps the array sorted
+	if (!removedProxies.empty())
+	{
+		sortedProxies.erase(std::remove_if(sortedProxies.begin(), sortedProxies.end(),
+			[this](uint32_t proxy) { return proxies[proxy].isRemoved; }), sortedProxies.end());
+
+		for (uint32_t proxy : removedProxies)
+		{
+			proxies[proxy].isRemoved = false;
+			freeProxies.push_back(proxy);
+		}
+		removedProxies.clear();
+	}
+
+	if (sortedProxies.size() < 2)
+	{
+		return;
+	}
+
+	// Find the axis along which the centres of the bounding boxes vary the most, since sorting
+	// along it separates the most proxies
+	glm::vec3 sum(0.0f);
+	glm::vec3 sumSquares(0.0f);
+
+	for (uint32_t proxy : sortedProxies)
+	{
+		const glm::vec3 center = proxies[proxy].aabb.GetCenter();
+		sum += center;
+		sumSquares += center * center;
+	}
+
+	const glm::vec3 mean = sum / (float)sortedProxies.size();
+	const glm::vec3 variance = sumSquares / (float)sortedProxies.size() - mean * mean;
+
+	int axis = 0;
+	if (variance.y > variance[axis])
+	{
+		axis = 1;
+	}
+	if (variance.z > variance[axis])
+	{
+		axis = 2;
+	}
+
+	SortProxies(axis);
+	PackProxies();
+	Sweep(pairs);
+}
+
+void SweepAndPruneBroadphase::SortProxies(int axis)
+{
+	auto getMin = [this, axis](uint32_t proxy)
+	{
+		return proxies[proxy].aabb.GetMinExtents()[axis];
+	};
+
+	// The order along a different axis has nothing to do with the current order, and insertion
+	// sort is quadratic for many proxies out of place, such as when many were just added
+	if (axis != sortAxis || numAdded > sortedProxies.size() / 4)
+	{
+		std::sort(sortedProxies.begin(), sortedProxies.end(),
+			[&getMin](uint32_t a, uint32_t b) { return getMin(a) < getMin(b); });
+	}
+	else
+	{
+		for (size_t i = 1; i < sortedProxies.size(); i++)
+		{
+			const uint32_t proxy = sortedProxies[i];
+			const float min = getMin(proxy);
+
+			size_t j = i;
+			while (j > 0 && getMin(sortedProxies[j - 1]) > min)
+			{
+				sortedProxies[j] = sortedProxies[j - 1];
+				j--;
+			}
+
+			sortedProxies[j] = proxy;
+		}
+	}
+
+	sortAxis = axis;
+	numAdded = 0;
+}
+
+void SweepAndPruneBroadphase::PackProxies()
+{
+	const size_t numProxies = sortedProxies.size();
+
+	for (int i = 0; i < 3; i++)
+	{
+		packedMin[i].resize(numProxies + SIMD_WIDTH - 1);
+		packedMax[i].resize(numProxies + SIMD_WIDTH - 1);
+	}
+
+	// The sort axis comes first
+	const int axes[3] = { sortAxis, (sortAxis + 1) % 3, (sortAxis + 2) % 3 };
+
+	for (size_t i = 0; i < numProxies; i++)
+	{
+		const AABB& aabb = proxies[sortedProxies[i]].aabb;
+		const glm::vec3 min = aabb.GetMinExtents();
+		const glm::vec3 max = aabb.GetMaxExtents();
+
+		for (int j = 0; j < 3; j++)
+		{
+			packedMin[j][i] = min[axes[j]];
+			packedMax[j][i] = max[axes[j]];
+		}
+	}
+
+	// The padding is never reached by the sweep, and never intersects anything
+	for (size_t i = numProxies; i < numProxies + SIMD_WIDTH - 1; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			packedMin[j][i] =  std::numeric_limits<float>::infinity();
+			packedMax[j][i] = -std::numeric_limits<float>::infinity();
+		}
+	}
+}
+
+void SweepAndPruneBroadphase::Sweep(std::vector<std::pair<EntityHandle, EntityHandle>>& pairs) const
+{
+	const size_t numProxies = sortedProxies.size();
+
+	const float* sweepMin = packedMin[0].data();
+	const float* sweepMax = packedMax[0].data();
+	const float* minA = packedMin[1].data();
+	const float* maxA = packedMax[1].data();
+	const float* minB = packedMin[2].data();
+	const float* maxB = packedMax[2].data();
+
+	for (size_t i = 0; i < numProxies; i++)
+	{
+		const EntityHandle handle = proxies[sortedProxies[i]].handle;
+
+		// Every proxy after this one in the order starts after it on the sort axis, so only the
+		// proxies which start before this one ends can intersect it
+#ifdef SWEEP_AND_PRUNE_SSE
+		const __m128 sweepMaxI = _mm_set1_ps(sweepMax[i]);
+		const __m128 minAI = _mm_set1_ps(minA[i]);
+		const __m128 maxAI = _mm_set1_ps(maxA[i]);
+		const __m128 minBI = _mm_set1_ps(minB[i]);
+		const __m128 maxBI = _mm_set1_ps(maxB[i]);
+
+		for (size_t j = i + 1; j < numProxies; j += SIMD_WIDTH)
+		{
+			// Since the proxies are sorted, the proxies still in the sweep are always the first
+			// ones loaded; the padding is never in the sweep
+			const int sweepMask = _mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(sweepMin + j),
+				sweepMaxI));
+
+			const __m128 overlapA = _mm_and_ps(
+				_mm_cmplt_ps(_mm_loadu_ps(minA + j), maxAI),
+				_mm_cmpgt_ps(_mm_loadu_ps(maxA + j), minAI));
+			const __m128 overlapB = _mm_and_ps(
+				_mm_cmplt_ps(_mm_loadu_ps(minB + j), maxBI),
+				_mm_cmpgt_ps(_mm_loadu_ps(maxB + j), minBI));
+
+			const int mask = sweepMask & _mm_movemask_ps(_mm_and_ps(overlapA, overlapB));
+
+			for (size_t lane = 0; mask != 0 && lane < SIMD_WIDTH; lane++)
+			{
+				if (mask & (1 << lane))
+				{
+					pairs.emplace_back(handle, proxies[sortedProxies[j + lane]].handle);
+				}
+			}
+
+			// The sweep ended within these proxies
+			if (sweepMask != (1 << SIMD_WIDTH) - 1)
+			{
+				break;
+			}
+		}
+#else
+		for (size_t j = i + 1; j < numProxies && sweepMin[j] < sweepMax[i]; j++)
+		{
+			if (minA[j] < maxA[i] && maxA[j] > minA[i] && minB[j] < maxB[i] && maxB[j] > minB[i])
+			{
+				pairs.emplace_back(handle, proxies[sortedProxies[j]].handle);
+			}
+		}
+#endif
+	}
+}
@@ -0,0 +1,95 @@
+/** Copyright (c) 2022-2023 Alexander Kaminsky and Maxwell Hunt */
+
+#pragma once
+
+#include "IBroadphase.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+/**
+ * @brief Broadphase which keeps every entity sorted along a single axis, and sweeps along that
+ * axis to find pairs.
+ *
+ * Entities are sorted by the minimum of their bounding box on the axis along which the centres of
+ * the bounding boxes vary the most. Since entities only move a little between frames, the order
+ * is kept with an insertion sort, which is close to linear when the order barely changes. Each
+ * entity is then only tested against the entities after it in the order whose minimum is before
+ * it's maximum, with the other two axes tested four entities at a time using SIMD where
+ * available.
+ *
+ * Works best for many moving entities of similar size. Large entities, or many entities stacked
+ * along the sorted axis, make the sweep test many entities which do not intersect.
+ */
+class SweepAndPruneBroadphase : public IBroadphase
+{
+public:
+	SweepAndPruneBroadphase() : IBroadphase() {}
+
+	/** @see IBroadphase::Add */
+	virtual void Add(EntityHandle handle, const AABB& aabb);
+
+	/** @see IBroadphase::Remove */
+	virtual void Remove(EntityHandle handle);
+
+	/** @see IBroadphase::Update */
+	virtual void Update(EntityHandle handle, const AABB& aabb);
+
+	/** @see IBroadphase::Clear */
+	virtual void Clear();
+
+	/** @see IBroadphase::FindPairs */
+	virtual void FindPairs(std::vector<std::pair<EntityHandle, EntityHandle>>& pairs);
+
+private:
+	struct Proxy
+	{
+		EntityHandle handle;
+		AABB aabb;
+
+		// If the proxy was removed, but is still in the sorted proxies array
+		bool isRemoved = false;
+	};
+
+	// Index corresponds to proxy
+	std::vector<Proxy> proxies;
+
+	// map<entity, proxy of the entity>
+	std::unordered_map<EntityHandle, uint32_t> proxyIDs;
+
+	// Proxies which can be reused by newly added entities
+	std::vector<uint32_t> freeProxies;
+
+	// Proxies which were removed since the previous call to FindPairs; they are only freed once
+	// they have been removed from the sorted proxies array
+	std::vector<uint32_t> removedProxies;
+
+	// Every proxy, sorted by the minimum of it's bounding box on the sort axis
+	std::vector<uint32_t> sortedProxies;
+
+	// The axis which the proxies are sorted along
+	int sortAxis = 0;
+
+	// The number of proxies added since the proxies were last sorted
+	size_t numAdded = 0;
+
+	// The bounding boxes of the sorted proxies, in the same order, packed into an array for each
+	// side of each axis so that they can be loaded four at a time
+	// The sort axis comes first, followed by the other two axes
+	std::vector<float> packedMin[3];
+	std::vector<float> packedMax[3];
+
+	/**
+	 * Sorts the proxies along an axis. Uses insertion sort if the proxies are already mostly
+	 * sorted along the axis, and a full sort otherwise.
+	 *
+	 * @param axis The axis to sort the proxies along.
+	 */
+	void SortProxies(int axis);
+
+	/** @brief Copies the bounding boxes of the sorted proxies into the packed arrays. */
+	void PackProxies();
+
+	/** @brief Appends every pair of sorted proxies whose bounding boxes intersect. */
+	void Sweep(std::vector<std::pair<EntityHandle, EntityHandle>>& pairs) const;
+};
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "ECS/ECS.h"
+#include "ECS/ECSTypedSystem.h"
 #include "GameComponentSystem/TransformComponent.h"
 #include "GameComponentSystem/MotionComponentSystem.h"
 #include "Physics/Components/RigidbodyComponent.h"
@@ -10,26 +11,33 @@
 #include <GLM/glm.hpp>
 #include <iostream> // TODO: remove
 
-class PhysicsWorldSystem : public BaseECSSystem
+/**
+ * @brief System which integrates the velocity and position of every rigidbody.
+ *
+ * Rigidbodies are simulated in world space, directly on their TransformComponent, and so must not
+ * be attached to a parent with a ParentComponent. Unlike rendering, physics cannot read the world
+ * matrix cached in the WorldTransformComponent; it is derived from the transform which physics
+ * writes, and is only brought up to date by the TransformPropagationSystem after physics and
+ * interactions have run.
+ */
+class PhysicsWorldSystem : public TypedSystem<PhysicsWorldSystem, Write<TransformComponent>,
+	Write<RigidbodyComponent>>
 {
 public:
-	PhysicsWorldSystem() : BaseECSSystem()
+	PhysicsWorldSystem()
 	{
-		AddComponentType(TransformComponent::ID);
-		AddComponentType(RigidbodyComponent::ID);
+		// Every rigidbody is integrated independently of the others
+		SetParallel(true);
 	}
 
-	virtual void UpdateComponents(float deltaTime, BaseECSComponent** components)
+	void Update(float deltaTime, TransformComponent& transform, RigidbodyComponent& rigidbody)
 	{
-		const auto transform = (TransformComponent*)components[0];
-		const auto rigidbody = (RigidbodyComponent*)components[1];
+		rigidbody.force += rigidbody.mass * gravity;
 
-		rigidbody->force += rigidbody->mass * gravity;
+		rigidbody.velocity += rigidbody.force / rigidbody.mass * deltaTime;
+		transform.transform.GetPosition() += rigidbody.velocity * deltaTime;
 
-		rigidbody->velocity += rigidbody->force / rigidbody->mass * deltaTime;
-		transform->transform.GetPosition() += rigidbody->velocity * deltaTime;
-
-		rigidbody->force = glm::vec3(0, 0, 0);
+		rigidbody.force = glm::vec3(0, 0, 0);
 	}
 
 private:
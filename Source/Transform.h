@@ -38,21 +38,25 @@ public:
 
 	[[nodiscard]] glm::mat4 GetModel() const
 	{
-		const glm::mat4 positionMatrix = glm::translate(position);
+		// Equivalent to translate * rotateZ * rotateY * rotateX * scale, with the products of the
+		// rotations worked out ahead of time, so that no intermediate matrices are built
+		const float cx = glm::cos(glm::radians(rotation.x));
+		const float sx = glm::sin(glm::radians(rotation.x));
+		const float cy = glm::cos(glm::radians(rotation.y));
+		const float sy = glm::sin(glm::radians(rotation.y));
+		const float cz = glm::cos(glm::radians(rotation.z));
+		const float sz = glm::sin(glm::radians(rotation.z));
 
-		const glm::mat4 rotationXMatrix = glm::rotate(glm::radians(rotation.x), 
-			glm::vec3(1.0, 0.0, 0.0));
-		const glm::mat4 rotationYMatrix = glm::rotate(glm::radians(rotation.y), 
-			glm::vec3(0.0, 1.0, 0.0));
-		const glm::mat4 rotationZMatrix = glm::rotate(glm::radians(rotation.z),
-			glm::vec3(0.0, 0.0, 1.0));
+		// Matrices are column major; each column is an axis of the rotation, scaled
+		glm::mat4 model;
+		model[0] = glm::vec4(cz * cy, sz * cy, -sy, 0.0f) * scale.x;
+		model[1] = glm::vec4(cz * sy * sx - sz * cx, sz * sy * sx + cz * cx, cy * sx, 0.0f) *
+			scale.y;
+		model[2] = glm::vec4(cz * sy * cx + sz * sx, sz * sy * cx - cz * sx, cy * cx, 0.0f) *
+			scale.z;
+		model[3] = glm::vec4(position, 1.0f);
 
-		const glm::mat4 scaleMatrix = glm::scale(scale);
-
-		const glm::mat4 rotationMatrix = rotationZMatrix * rotationYMatrix * rotationXMatrix;
-
-		// Matrix multiplication is applied in reverse order
-		return positionMatrix * rotationMatrix * scaleMatrix;
+		return model;
 	}
 
 	[[nodiscard]] glm::vec3& GetPosition() { return position; }